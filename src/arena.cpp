@@ -0,0 +1,87 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace gfd {
+
+static const uint32_t kMinimumCapacity = 64 * 1024;
+static const uint32_t kMinimumFragments = 1024;
+
+/* Grows *aCapacity (in elements) by doubling until aNeeded fit. */
+static bool grow(void** aData, uint32_t* aCapacity, uint64_t aNeeded,
+                 size_t aElementSize, uint32_t aMinimum) {
+  if (aNeeded <= *aCapacity)
+    return true;
+  if (aNeeded > UINT32_MAX)
+    return false;
+
+  uint64_t capacity = *aCapacity? *aCapacity : aMinimum;
+  while (capacity < aNeeded)
+    capacity *= 2;
+  if (capacity > UINT32_MAX)
+    capacity = UINT32_MAX;
+
+  void* data = realloc(*aData, capacity * aElementSize);
+  if (!data)
+    return false;
+  *aData = data;
+  *aCapacity = uint32_t(capacity);
+  return true;
+}
+
+bool appendText(TextArena* aArena, const char* aText, size_t aLength,
+                bool aTransient) {
+  if (!grow(reinterpret_cast<void**>(&aArena->data), &aArena->capacity,
+            uint64_t(aArena->used) + aLength + 1, 1, kMinimumCapacity) ||
+      !grow(reinterpret_cast<void**>(&aArena->fragments),
+            &aArena->fragmentCapacity, uint64_t(aArena->count) + 1,
+            sizeof(TextFragment), kMinimumFragments))
+    return false;
+
+  TextFragment* fragment = &aArena->fragments[aArena->count++];
+  fragment->offset = aArena->used;
+  fragment->length = uint32_t(aLength);
+  fragment->transient = aTransient;
+  fragment->wordBefore = false;
+  fragment->wordAfter = false;
+
+  memcpy(aArena->data + aArena->used, aText, aLength);
+  aArena->data[aArena->used + aLength] = '\0';
+  aArena->used += uint32_t(aLength) + 1;
+
+  if (aArena->used > aArena->highWater)
+    aArena->highWater = aArena->used;
+  if (aArena->count > aArena->fragmentHighWater)
+    aArena->fragmentHighWater = aArena->count;
+  return true;
+}
+
+void dropLastText(TextArena* aArena) {
+  TextFragment* fragment = &aArena->fragments[aArena->count - 1];
+  aArena->used = fragment->offset + 1;
+  aArena->data[fragment->offset] = '\0';
+  fragment->length = 0;
+  aArena->dropped++;
+}
+
+void clearArena(TextArena* aArena) {
+  free(aArena->data);
+  free(aArena->fragments);
+  memset(aArena, 0, sizeof(TextArena));
+}
+
+}
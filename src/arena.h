@@ -0,0 +1,83 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Storage for the text collected by one page scan.
+ *
+ * All fragments of a page are appended to one contiguous buffer (each one
+ * followed by a NUL byte) and described by offset/length records, so that
+ * collecting a page costs a handful of reallocations instead of one strdup()
+ * and one list node per text node. resetArena() forgets the page in O(1)
+ * and keeps the memory for the next one.
+ *
+ * A transient fragment (a window of a long text) is only kept until it has
+ * been handled: dropLastText() gives its bytes back, so that a long text
+ * never holds more than one window of the arena. The fragment itself stays,
+ * empty, so that fragment indexes don't change.
+ */
+
+#ifndef GFD_ARENA_H
+#define GFD_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfd {
+
+typedef struct _TextFragment {
+  uint32_t offset; /* into TextArena::data */
+  uint32_t length; /* in bytes, without the NUL */
+  bool transient;  /* dropped as soon as it has been handled */
+  /* of a window: whether the characters around it are word characters */
+  bool wordBefore;
+  bool wordAfter;
+} TextFragment;
+
+typedef struct _TextArena {
+  char* data;
+  uint32_t used;
+  uint32_t capacity;
+
+  TextFragment* fragments;
+  uint32_t count;
+  uint32_t fragmentCapacity;
+  uint32_t dropped;  /* fragments */
+
+  /* the most data/fragments ever held at once */
+  uint32_t highWater;
+  uint32_t fragmentHighWater;
+} TextArena;
+
+/* Copies aLength bytes of aText as a new fragment. Returns false on
+ * allocation failure (the arena is left as it was). */
+bool appendText(TextArena* aArena, const char* aText, size_t aLength,
+                bool aTransient = false);
+
+/* Gives back the bytes of the last fragment, which becomes empty. */
+void dropLastText(TextArena* aArena);
+
+inline const char* fragmentText(const TextArena* aArena, uint32_t aIndex) {
+  return aArena->data + aArena->fragments[aIndex].offset;
+}
+
+inline void resetArena(TextArena* aArena) {
+  aArena->used = 0;
+  aArena->count = 0;
+  aArena->dropped = 0;
+}
+
+/* Releases the memory; the arena can be used again afterwards. */
+void clearArena(TextArena* aArena);
+
+}
+
+#endif /* GFD_ARENA_H */
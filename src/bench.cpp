@@ -0,0 +1,524 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+
+/* End-to-end benchmark of great firedaemon:
+ *
+ * $ ./gfd-bench [-g greatfd] [-s gfd-bench-server] [-l censor.lst]
+ *               [-w directory] [server options...]
+ *
+ * It starts a private dbus-daemon, gfd-bench-server on it (with the
+ * options of gfd-bench-server, see src/benchserver.cpp) and greatfd in a
+ * scratch directory, given the keyword of the server or the censor list
+ * -l. Once the server has sent every event and no more requests come, it
+ * stops greatfd and reports from logs/stats:
+ *
+ * >events                100 in 9.904 s, 10.10/s
+ * >event latency         p50 1.2 ms, p99 3.4 ms
+ * >round trips           46.0 per event (4600 requests served)
+ *
+ * events/s is the number of events greatfd handled over the time from the
+ * first signal to the last request; with -r 0 it is the throughput. The
+ * programs default to those next to gfd-bench. The scratch directory is
+ * removed afterwards, unless it was given with -w.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static const char kProductName[] = "gfd-bench";
+
+static const char kServerOptions[] = "d:f:t:k:p:D:r:n:u:cq:H:Z";
+static const uint32_t kMaxServerArguments = 2 * 16;
+
+/* How long greatfd is given to write logs/stats and exit. */
+static const int kStopTimeout = 10 * 1000; /* ms */
+
+/* What logs/stats says. */
+typedef struct _Report {
+  unsigned long long events;
+  unsigned long long roundTrips;
+  unsigned long long latencyCount;
+  unsigned long long truncated; /* scans */
+  unsigned long long timeouts;  /* calls */
+  unsigned long long skipped;   /* events */
+  double p50;   /* ns */
+  double p99;   /* ns */
+} Report;
+
+/* Starts aArguments[0] with aStdout as its standard output (if not -1), in
+ * aDirectory (if not NULL). */
+static pid_t spawn(const char* const* aArguments, int aStdout,
+                   const char* aDirectory) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return -1;
+  }
+  if (pid)
+    return pid;
+
+  if (aStdout >= 0 && aStdout != STDOUT_FILENO) {
+    dup2(aStdout, STDOUT_FILENO);
+    close(aStdout);
+  }
+  if (aDirectory && chdir(aDirectory) < 0) {
+    perror(aDirectory);
+    _exit(127);
+  }
+  execvp(aArguments[0], const_cast<char* const*>(aArguments));
+  perror(aArguments[0]);
+  _exit(127);
+}
+
+/* Sends aSignal and waits up to aTimeout ms, then kills. */
+static int stop(pid_t aPid, int aSignal, int aTimeout) {
+  int status = 0;
+  if (aPid <= 0)
+    return 0;
+
+  kill(aPid, aSignal);
+  int waited;
+  for (waited = 0; waited < aTimeout; waited += 10) {
+    if (waitpid(aPid, &status, WNOHANG) == aPid)
+      return status;
+    usleep(10 * 1000);
+  }
+  kill(aPid, SIGKILL);
+  waitpid(aPid, &status, 0);
+  return status;
+}
+
+/* Reads one line of aFd into aLine, polling every 100 ms whether aWatched
+ * is still running. */
+static bool readLine(int aFd, char* aLine, size_t aSize, pid_t aWatched) {
+  size_t length = 0;
+  for (;;) {
+    struct pollfd fd;
+    fd.fd = aFd;
+    fd.events = POLLIN;
+    int ready = poll(&fd, 1, 100);
+    if (ready < 0 && errno != EINTR) {
+      perror("poll");
+      return false;
+    }
+
+    if (ready > 0) {
+      char c;
+      ssize_t count = read(aFd, &c, 1);
+      if (count <= 0)
+        return false;
+      if (c == '\n') {
+        aLine[length] = '\0';
+        return true;
+      }
+      if (length + 1 < aSize)
+        aLine[length++] = c;
+      continue;
+    }
+
+    int status;
+    if (aWatched > 0 && waitpid(aWatched, &status, WNOHANG) == aWatched) {
+      fprintf(stderr, "%s: greatfd exited early\n", kProductName);
+      return false;
+    }
+  }
+}
+
+/* Starts dbus-daemon and puts its address into DBUS_SESSION_BUS_ADDRESS. */
+static pid_t startBus() {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    perror("pipe");
+    return -1;
+  }
+
+  char printAddress[32];
+  snprintf(printAddress, sizeof(printAddress), "--print-address=%d",
+           fds[1]);
+  const char* const arguments[] = {
+    "dbus-daemon", "--session", "--nofork", printAddress, NULL
+  };
+  pid_t pid = spawn(arguments, -1, NULL);
+  close(fds[1]);
+
+  char address[PATH_MAX];
+  bool succeeded = (pid > 0) &&
+    readLine(fds[0], address, sizeof(address), -1);
+  close(fds[0]);
+  if (!succeeded) {
+    fprintf(stderr, "%s: failed to start dbus-daemon\n", kProductName);
+    stop(pid, SIGTERM, 1000);
+    return -1;
+  }
+
+  setenv("DBUS_SESSION_BUS_ADDRESS", address, 1);
+  return pid;
+}
+
+static bool copyFile(const char* aFrom, const char* aTo) {
+  FILE* from = fopen(aFrom, "rb");
+  if (!from) {
+    perror(aFrom);
+    return false;
+  }
+  FILE* to = fopen(aTo, "wb");
+  if (!to) {
+    perror(aTo);
+    fclose(from);
+    return false;
+  }
+
+  char buffer[64 * 1024];
+  size_t count;
+  bool succeeded(true);
+  while ((count = fread(buffer, 1, sizeof(buffer), from)) > 0) {
+    if (fwrite(buffer, 1, count, to) != count) {
+      succeeded = false;
+      break;
+    }
+  }
+  if (ferror(from))
+    succeeded = false;
+  fclose(from);
+  if (fclose(to) != 0)
+    succeeded = false;
+  if (!succeeded)
+    perror(aTo);
+  return succeeded;
+}
+
+static int removeEntry(const char* aPath, const struct stat*, int,
+                       struct FTW*) {
+  if (remove(aPath) < 0)
+    perror(aPath);
+  return 0;
+}
+
+/* "12.3 ms" and the like, as formatMetrics() writes them; returns ns. */
+static bool parseDuration(const char* aValue, const char* aUnit,
+                          double* aResult) {
+  char* end;
+  double value = strtod(aValue, &end);
+  if (end == aValue || *end)
+    return false;
+
+  static const struct {
+    const char* name;
+    double scale;
+  } units[] = {
+    { "ns", 1 }, { "us", 1e3 }, { "ms", 1e6 }, { "s", 1e9 },
+  };
+  uint32_t u;
+  for (u = 0; u < sizeof(units) / sizeof(units[0]); u++) {
+    if (0 == strcmp(aUnit, units[u].name)) {
+      *aResult = value * units[u].scale;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Names are padded to the first 22 columns of logs/stats. */
+static const char* valueOf(const char* aLine, const char* aName) {
+  const size_t length = strlen(aName);
+  if (strncmp(aLine, aName, length) || strlen(aLine) < 22)
+    return NULL;
+  size_t i;
+  for (i = length; i < 22; i++) {
+    if (aLine[i] != ' ')
+      return NULL;
+  }
+  return aLine + 22;
+}
+
+static bool readReport(const char* aFilename, Report* aReport) {
+  FILE* file = fopen(aFilename, "r");
+  if (!file) {
+    perror(aFilename);
+    return false;
+  }
+
+  memset(aReport, 0, sizeof(Report));
+  char line[1024];
+  while (fgets(line, sizeof(line), file)) {
+    const char* value;
+    if ((value = valueOf(line, "events"))) {
+      aReport->events = strtoull(value, NULL, 10);
+    }
+    else if ((value = valueOf(line, "round trips"))) {
+      aReport->roundTrips = strtoull(value, NULL, 10);
+    }
+    else if ((value = valueOf(line, "truncated scans"))) {
+      aReport->truncated = strtoull(value, NULL, 10);
+    }
+    else if ((value = valueOf(line, "call timeouts"))) {
+      aReport->timeouts = strtoull(value, NULL, 10);
+    }
+    else if ((value = valueOf(line, "skipped events"))) {
+      aReport->skipped = strtoull(value, NULL, 10);
+    }
+    else if ((value = valueOf(line, "event latency"))) {
+      /* count p50 p90 p99 p99.9 max mean, each time with its unit */
+      char fields[13][16];
+      int count = sscanf(value, "%15s %15s %15s %15s %15s %15s %15s %15s "
+                         "%15s %15s %15s %15s %15s",
+                         fields[0], fields[1], fields[2], fields[3],
+                         fields[4], fields[5], fields[6], fields[7],
+                         fields[8], fields[9], fields[10], fields[11],
+                         fields[12]);
+      if (count != 13 ||
+          !parseDuration(fields[1], fields[2], &aReport->p50) ||
+          !parseDuration(fields[5], fields[6], &aReport->p99)) {
+        fprintf(stderr, "%s: can't parse %s", kProductName, line);
+        continue;
+      }
+      aReport->latencyCount = strtoull(fields[0], NULL, 10);
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+static void printDuration(double aNanoseconds) {
+  if (aNanoseconds < 1e3)
+    printf("%.0f ns", aNanoseconds);
+  else if (aNanoseconds < 1e6)
+    printf("%.1f us", aNanoseconds / 1e3);
+  else if (aNanoseconds < 1e9)
+    printf("%.1f ms", aNanoseconds / 1e6);
+  else
+    printf("%.2f s", aNanoseconds / 1e9);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: %s [-g greatfd] [-s gfd-bench-server] [-l censor.lst]\n"
+          "       [-w directory] [server options...]\n", kProductName);
+}
+
+int main(int argc, char* argv[]) {
+  char directory[PATH_MAX];
+  {
+    ssize_t length = readlink("/proc/self/exe", directory,
+                              sizeof(directory) - 1);
+    if (length < 0) {
+      perror("/proc/self/exe");
+      return 1;
+    }
+    directory[length] = '\0';
+    char* slash = strrchr(directory, '/');
+    if (slash)
+      *slash = '\0';
+  }
+
+  /* Room for the longest name, so that a path is never cut short; one
+     that ends up too long fails with ENAMETOOLONG instead. */
+  char greatfdPath[sizeof(directory) + sizeof("/gfd-bench-server")];
+  char serverPath[sizeof(directory) + sizeof("/gfd-bench-server")];
+  snprintf(greatfdPath, sizeof(greatfdPath), "%s/greatfd", directory);
+  snprintf(serverPath, sizeof(serverPath), "%s/gfd-bench-server",
+           directory);
+
+  const char* greatfd = greatfdPath;
+  const char* list(NULL);
+  const char* workDirectory(NULL);
+  const char* keyword = "Voldemort";
+
+  /* Server options are handed over as they are. */
+  const char* serverArguments[1 + kMaxServerArguments + 1];
+  char flags[kMaxServerArguments][3];
+  uint32_t serverArgumentCount = 0;
+  serverArguments[serverArgumentCount++] = serverPath;
+
+  char options[64];
+  snprintf(options, sizeof(options), "g:s:l:w:%s", kServerOptions);
+  int option;
+  while (-1 != (option = getopt(argc, argv, options))) {
+    switch (option) {
+    case 'g': greatfd = optarg; break;
+    case 's': serverArguments[0] = optarg; break;
+    case 'l': list = optarg; break;
+    case 'w': workDirectory = optarg; break;
+    case '?': usage(); return 2;
+    default: {
+      if (option == 'k')
+        keyword = optarg;
+      if (serverArgumentCount + 2 > kMaxServerArguments) {
+        usage();
+        return 2;
+      }
+      char* flag = flags[serverArgumentCount];
+      flag[0] = '-';
+      flag[1] = char(option);
+      flag[2] = '\0';
+      serverArguments[serverArgumentCount++] = flag;
+      /* optarg is left over from the previous option otherwise */
+      const char* spec = strchr(kServerOptions, option);
+      if (spec && spec[1] == ':')
+        serverArguments[serverArgumentCount++] = optarg;
+      break;
+    }
+    }
+  }
+  serverArguments[serverArgumentCount] = NULL;
+  if (optind != argc) {
+    usage();
+    return 2;
+  }
+
+  /* The scratch directory greatfd runs in. */
+  char scratch[PATH_MAX];
+  if (workDirectory) {
+    snprintf(scratch, sizeof(scratch), "%s", workDirectory);
+    if (mkdir(scratch, 0777) < 0 && errno != EEXIST) {
+      perror(scratch);
+      return 1;
+    }
+  }
+  else {
+    snprintf(scratch, sizeof(scratch), "%s/gfd-bench.XXXXXX",
+             getenv("TMPDIR")? getenv("TMPDIR") : "/tmp");
+    if (!mkdtemp(scratch)) {
+      perror(scratch);
+      return 1;
+    }
+  }
+
+  char path[sizeof(scratch) + sizeof("/settings/censor.bin")];
+  snprintf(path, sizeof(path), "%s/logs", scratch);
+  mkdir(path, 0777);
+  snprintf(path, sizeof(path), "%s/settings", scratch);
+  mkdir(path, 0777);
+  /* Starting over, so that logs/stats is that of this run. */
+  snprintf(path, sizeof(path), "%s/logs/stats", scratch);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/settings/censor.bin", scratch);
+  unlink(path);
+  char listPath[sizeof(scratch) + sizeof("/settings/censor.lst")];
+  snprintf(listPath, sizeof(listPath), "%s/settings/censor.lst", scratch);
+  unlink(listPath);
+
+  int result = 1;
+  pid_t bus = -1;
+  pid_t server = -1;
+  pid_t daemon = -1;
+  int serverOutput[2] = { -1, -1 };
+  char line[256];
+  unsigned int sent = 0;
+  unsigned long long requests = 0;
+  double elapsed = 0;
+
+  if (list && !copyFile(list, listPath))
+    goto cleanup;
+
+  bus = startBus();
+  if (bus < 0)
+    goto cleanup;
+
+  if (pipe(serverOutput) < 0) {
+    perror("pipe");
+    goto cleanup;
+  }
+  fcntl(serverOutput[0], F_SETFD, FD_CLOEXEC);
+  server = spawn(serverArguments, serverOutput[1], NULL);
+  close(serverOutput[1]);
+  if (server < 0 ||
+      !readLine(serverOutput[0], line, sizeof(line), -1) ||
+      strcmp(line, "ready")) {
+    fprintf(stderr, "%s: %s did not start\n", kProductName,
+            serverArguments[0]);
+    goto cleanup;
+  }
+
+  {
+    const char* const arguments[] = { greatfd, list? NULL : keyword, NULL };
+    daemon = spawn(arguments, -1, scratch);
+    if (daemon < 0)
+      goto cleanup;
+  }
+
+  if (!readLine(serverOutput[0], line, sizeof(line), daemon) ||
+      sscanf(line, "events=%u requests=%llu elapsed=%lf", &sent, &requests,
+             &elapsed) != 3) {
+    fprintf(stderr, "%s: %s failed\n", kProductName, serverArguments[0]);
+    goto cleanup;
+  }
+
+  /* greatfd writes logs/stats on its way out. */
+  {
+    int status = stop(daemon, SIGTERM, kStopTimeout);
+    daemon = -1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+      fprintf(stderr, "%s: greatfd did not exit cleanly\n", kProductName);
+      goto cleanup;
+    }
+  }
+
+  {
+    Report report;
+    snprintf(path, sizeof(path), "%s/logs/stats", scratch);
+    if (!readReport(path, &report))
+      goto cleanup;
+
+    printf("%-22s %llu in %.3f s, %.2f/s (%u sent)\n", "events",
+           report.events, elapsed,
+           elapsed > 0? report.events / elapsed : 0.0, sent);
+    printf("%-22s ", "event latency");
+    if (report.latencyCount) {
+      printf("p50 ");
+      printDuration(report.p50);
+      printf(", p99 ");
+      printDuration(report.p99);
+      printf("\n");
+    }
+    else {
+      printf("n/a\n");
+    }
+    printf("%-22s %.1f per event (%llu requests served)\n", "round trips",
+           report.events? double(report.roundTrips) / report.events : 0.0,
+           requests);
+    if (report.truncated)
+      printf("%-22s %llu scans\n", "truncated", report.truncated);
+    if (report.timeouts || report.skipped) {
+      printf("%-22s %llu calls timed out, %llu events skipped\n",
+             "unresponsive", report.timeouts, report.skipped);
+    }
+    if (workDirectory)
+      printf("%-22s %s\n", "logs", scratch);
+  }
+  result = 0;
+
+cleanup:
+  stop(daemon, SIGTERM, kStopTimeout);
+  stop(server, SIGTERM, 1000);
+  if (serverOutput[0] >= 0)
+    close(serverOutput[0]);
+  stop(bus, SIGTERM, 1000);
+  if (!workDirectory)
+    nftw(scratch, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+  return result;
+}
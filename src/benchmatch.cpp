@@ -0,0 +1,684 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+
+/* Microbenchmark of the keyword matching stage, apart from D-Bus:
+ *
+ * $ ./gfd-bench-match [-s size] [-f fragment] [-c corpora] [-k counts]
+ *                     [-r repetitions] [-b budget]
+ *
+ * For each corpus (comma separated, "ascii,utf8,repeat" by default) it
+ * generates size KiB (1024) of text in fragments of about fragment bytes
+ * (4096), like the fragments of a page:
+ *
+ *   ascii   English-like prose
+ *   utf8    the same, mixed with accented Latin, Greek, Cyrillic, CJK and
+ *           fullwidth words in both cases
+ *   repeat  long runs of one letter, against keywords that are such runs
+ *           followed by something else, the worst case of naive searches
+ *
+ * and for each keyword count (1,10,100,1000,10000,100000 by default) a set
+ * of keywords, a few of them taken from the corpus and the rest made up.
+ * The corpus is folded once (see casefold.h), timed apart, then scanned by
+ * each implementation, every fragment as a page of its own. The best of
+ * repetitions (3) runs is reported in GB/s and ns/byte, with the number of
+ * (fragment, keyword) hits:
+ *
+ *   matcher     Matcher::scan(), as greatfd does
+ *   censor/...  censor(), keyword by keyword with findCaseInsensitive(),
+ *               once for each of its implementations (avx2, sse2, scalar)
+ *   strcasestr  the same with the C library
+ *
+ * The implementations that search keyword by keyword are left out once
+ * keywords times corpus size exceeds budget MiB (256). Every
+ * implementation must find the same keywords in the same fragments as the
+ * matcher; if one does not, it is said on stderr and the exit status is 1.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "casefold.h"
+#include "matcher.h"
+#include "strsearch.h"
+
+static const char kProductName[] = "gfd-bench-match";
+
+static const char* const kEnglishWords[] = {
+  "the", "of", "and", "to", "in", "is", "was", "that", "for", "on", "as",
+  "with", "by", "his", "at", "from", "he", "it", "an", "were", "are",
+  "which", "this", "be", "or", "has", "had", "first", "one", "their",
+  "its", "new", "after", "who", "they", "two", "her", "she", "been",
+  "other", "when", "time", "during", "there", "into", "school", "more",
+  "may", "years", "over", "only", "year", "most", "would", "world",
+  "city", "some", "where", "between", "later", "three", "state", "such",
+  "then", "national", "used", "made", "known", "under", "many", "university",
+  "united", "while", "part", "season", "team", "these", "american", "than",
+  "film", "second", "born", "south", "became", "states", "war", "through",
+  "being", "including", "both", "before", "north", "high", "however",
+  "people", "family", "early", "history", "album", "area", "them",
+  "series", "against", "until", "since", "district", "county", "name",
+};
+
+/* Both cases of each, so that folding matters. */
+static const char* const kForeignWords[] = {
+  "Straße", "STRASSE", "café", "CAFÉ", "naïve", "Ærø", "œuvre", "ŒUVRE",
+  "École", "ÉCOLE", "Ärger", "ÄRGER", "Ωμέγα", "ΩΜΈΓΑ", "λόγος", "ΛΌΓΟΣ",
+  "Привет", "ПРИВЕТ", "мир", "МИР", "Добрый", "ДОБРЫЙ", "Ёлка", "ЁЛКА",
+  "日本語", "中文", "한국어", "ＡＢＣ", "ａｂｃ", "Ｗｉｋｉ", "ℌilbert",
+  "Ǆemal", "ǆemal", "Ωhm", "Ⅻ", "ⅻ",
+};
+
+/* Syllables of made-up keywords. */
+static const char* const kSyllables[] = {
+  "ka", "ro", "mi", "zen", "tal", "qu", "ex", "vor", "lin", "sa", "dre",
+  "po", "ny", "gh", "wu", "ix", "bel", "tor", "fa", "um",
+};
+static const char* const kForeignSyllables[] = {
+  "ка", "ро", "ми", "зен", "тал", "λο", "γο", "σμα", "ße", "é", "ü",
+  "語", "中", "Ａ", "ｂ",
+};
+
+typedef enum _CorpusKind {
+  eCorpusAscii,
+  eCorpusUtf8,
+  eCorpusRepeat
+} CorpusKind;
+
+static const char* const kCorpusNames[] = { "ascii", "utf8", "repeat" };
+
+/* Fragments are stored one after another, each followed by a NUL so that
+ * strcasestr() can search them. */
+typedef struct _Corpus {
+  char* data;
+  size_t size;           /* bytes of text, NULs left out */
+  size_t* offsets;
+  size_t* lengths;
+  uint32_t count;
+
+  /* some of the words it was made of, to take keywords from */
+  const char* words[64];
+  uint32_t wordCount;
+} Corpus;
+
+typedef struct _KeywordSet {
+  char** keywords;       /* as given to greatfd */
+  char** folded;         /* as censor() searches them */
+  size_t* foldedLengths;
+  uint32_t count;
+} KeywordSet;
+
+/* Finds the keywords of aSet in aLength bytes of folded text, setting
+ * aHits[i] for each keyword i found. */
+typedef void (*Implementation)(const char* aText, size_t aLength,
+                               const KeywordSet* aSet, const void* aData,
+                               uint8_t* aHits);
+
+/* What an implementation found. */
+typedef struct _Result {
+  uint64_t time;         /* ns */
+  uint64_t hits;         /* (fragment, keyword) pairs */
+  uint64_t checksum;     /* of them */
+} Result;
+
+typedef struct _Options {
+  size_t size;
+  size_t fragment;
+  uint32_t repetitions;
+  uint64_t budget;
+} Options;
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+/* xorshift64*; the same corpora every run. */
+static uint64_t nextRandom(uint64_t* aState) {
+  uint64_t x = *aState;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *aState = x;
+  return x * 0x2545f4914f6cdd1dULL;
+}
+
+static uint32_t pick(uint64_t* aRandom, uint32_t aCount) {
+  return uint32_t(nextRandom(aRandom) % aCount);
+}
+
+#define GFD_COUNT_OF(__ARRAY__) (sizeof(__ARRAY__) / sizeof((__ARRAY__)[0]))
+
+/* The next word of a corpus of aKind, and what follows it. */
+static size_t nextWord(CorpusKind aKind, uint64_t* aRandom,
+                       bool aSentenceStart, char* aWord) {
+  if (aKind == eCorpusRepeat) {
+    /* A run of 'a', then a letter that is rarely in the keywords. */
+    size_t run = 16 + pick(aRandom, 512);
+    memset(aWord, 'a', run);
+    aWord[run] = "bz"[pick(aRandom, 2)];
+    aWord[run + 1] = ' ';
+    return run + 2;
+  }
+
+  const char* word;
+  if (aKind == eCorpusUtf8 && pick(aRandom, 4) == 0)
+    word = kForeignWords[pick(aRandom, GFD_COUNT_OF(kForeignWords))];
+  else
+    word = kEnglishWords[pick(aRandom, GFD_COUNT_OF(kEnglishWords))];
+
+  size_t length = strlen(word);
+  memcpy(aWord, word, length);
+  if (aSentenceStart && aWord[0] >= 'a' && aWord[0] <= 'z')
+    aWord[0] -= 'a' - 'A';
+
+  switch (pick(aRandom, 16)) {
+  case 0: aWord[length++] = '.'; break;
+  case 1: aWord[length++] = ','; break;
+  default: break;
+  }
+  aWord[length++] = ' ';
+  return length;
+}
+
+static bool generateCorpus(CorpusKind aKind, const Options* aOptions,
+                           Corpus* aCorpus) {
+  memset(aCorpus, 0, sizeof(Corpus));
+  const uint32_t maxCount = uint32_t(aOptions->size / (aOptions->fragment / 2)
+                                     + 1);
+  aCorpus->data = static_cast<char*>(malloc(aOptions->size + maxCount));
+  aCorpus->offsets = static_cast<size_t*>(malloc(sizeof(size_t) * maxCount));
+  aCorpus->lengths = static_cast<size_t*>(malloc(sizeof(size_t) * maxCount));
+  if (!aCorpus->data || !aCorpus->offsets || !aCorpus->lengths)
+    return false;
+
+  uint64_t random = 0x9e3779b97f4a7c15ULL + aKind;
+  char word[1024];
+  size_t position = 0;
+  while (aCorpus->size < aOptions->size && aCorpus->count < maxCount) {
+    /* Between half and one and a half of the fragment size. */
+    size_t target = aOptions->fragment / 2 + pick(&random,
+                                                  aOptions->fragment + 1);
+    if (target > aOptions->size - aCorpus->size)
+      target = aOptions->size - aCorpus->size;
+
+    size_t length = 0;
+    bool sentenceStart = true;
+    while (length < target) {
+      size_t wordLength = nextWord(aKind, &random, sentenceStart, word);
+      sentenceStart = (word[wordLength - 2] == '.');
+      if (wordLength > target - length)
+        wordLength = target - length;
+      memcpy(aCorpus->data + position + length, word, wordLength);
+      length += wordLength;
+    }
+
+    aCorpus->offsets[aCorpus->count] = position;
+    aCorpus->lengths[aCorpus->count] = length;
+    aCorpus->count++;
+    aCorpus->size += length;
+    position += length;
+    aCorpus->data[position++] = '\0';
+  }
+
+  /* Keywords found in the corpus. */
+  if (aKind == eCorpusRepeat) {
+    aCorpus->words[aCorpus->wordCount++] = "aaaaaaaaaaaaaaab";
+    aCorpus->words[aCorpus->wordCount++] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaz";
+  }
+  else {
+    const char* const* words = (aKind == eCorpusUtf8)?
+      kForeignWords : kEnglishWords;
+    const uint32_t count = (aKind == eCorpusUtf8)?
+      GFD_COUNT_OF(kForeignWords) : GFD_COUNT_OF(kEnglishWords);
+    while (aCorpus->wordCount < GFD_COUNT_OF(aCorpus->words) &&
+           aCorpus->wordCount < count) {
+      aCorpus->words[aCorpus->wordCount] = words[aCorpus->wordCount];
+      aCorpus->wordCount++;
+    }
+  }
+  return true;
+}
+
+static void freeCorpus(Corpus* aCorpus) {
+  free(aCorpus->data);
+  free(aCorpus->offsets);
+  free(aCorpus->lengths);
+  memset(aCorpus, 0, sizeof(Corpus));
+}
+
+/* Folds every fragment of aCorpus into aFolded, as matchFragment() does. */
+static bool foldCorpus(const Corpus* aCorpus, Corpus* aFolded) {
+  *aFolded = *aCorpus;
+  aFolded->data = static_cast<char*>(malloc(aCorpus->size + aCorpus->count));
+  aFolded->offsets =
+    static_cast<size_t*>(malloc(sizeof(size_t) * aCorpus->count));
+  aFolded->lengths =
+    static_cast<size_t*>(malloc(sizeof(size_t) * aCorpus->count));
+  if (!aFolded->data || !aFolded->offsets || !aFolded->lengths)
+    return false;
+
+  gfd::FoldBuffer buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  size_t position = 0;
+  aFolded->size = 0;
+  uint32_t i;
+  for (i = 0; i < aCorpus->count; i++) {
+    size_t length;
+    const char* text = gfd::foldText(&buffer,
+                                     aCorpus->data + aCorpus->offsets[i],
+                                     aCorpus->lengths[i], &length);
+    memcpy(aFolded->data + position, text, length);
+    aFolded->offsets[i] = position;
+    aFolded->lengths[i] = length;
+    aFolded->size += length;
+    position += length;
+    aFolded->data[position++] = '\0';
+  }
+  gfd::clearFoldBuffer(&buffer);
+  return true;
+}
+
+static char* madeUpKeyword(CorpusKind aKind, uint64_t* aRandom) {
+  char keyword[256];
+  size_t length = 0;
+
+  if (aKind == eCorpusRepeat) {
+    /* Runs as long as those of the corpus, ending otherwise. */
+    size_t run = 1 + pick(aRandom, 200);
+    memset(keyword, 'a', run);
+    length = run;
+  }
+
+  const uint32_t syllables = 2 + pick(aRandom, 3);
+  uint32_t s;
+  for (s = 0; s < syllables; s++) {
+    const char* syllable = (aKind == eCorpusUtf8 && pick(aRandom, 3) == 0)?
+      kForeignSyllables[pick(aRandom, GFD_COUNT_OF(kForeignSyllables))] :
+      kSyllables[pick(aRandom, GFD_COUNT_OF(kSyllables))];
+    size_t syllableLength = strlen(syllable);
+    memcpy(keyword + length, syllable, syllableLength);
+    length += syllableLength;
+  }
+  keyword[length] = '\0';
+  if (pick(aRandom, 4) == 0 && keyword[0] >= 'a' && keyword[0] <= 'z')
+    keyword[0] -= 'a' - 'A';
+  return strdup(keyword);
+}
+
+static void freeKeywordSet(KeywordSet* aSet) {
+  uint32_t i;
+  for (i = 0; i < aSet->count; i++) {
+    free(aSet->keywords? aSet->keywords[i] : NULL);
+    free(aSet->folded? aSet->folded[i] : NULL);
+  }
+  free(aSet->keywords);
+  free(aSet->folded);
+  free(aSet->foldedLengths);
+  memset(aSet, 0, sizeof(KeywordSet));
+}
+
+/* About one keyword in 64 (at least one) is a word of the corpus. */
+static bool generateKeywords(CorpusKind aKind, const Corpus* aCorpus,
+                             uint32_t aCount, KeywordSet* aSet) {
+  memset(aSet, 0, sizeof(KeywordSet));
+  aSet->keywords = static_cast<char**>(calloc(aCount, sizeof(char*)));
+  aSet->folded = static_cast<char**>(calloc(aCount, sizeof(char*)));
+  aSet->foldedLengths = static_cast<size_t*>(calloc(aCount, sizeof(size_t)));
+  if (!aSet->keywords || !aSet->folded || !aSet->foldedLengths) {
+    freeKeywordSet(aSet);
+    return false;
+  }
+  aSet->count = aCount;
+
+  uint64_t random = 0x2545f4914f6cdd1dULL + aCount;
+  uint32_t i;
+  for (i = 0; i < aCount; i++) {
+    if (i % 64 == 0 && aCorpus->wordCount) {
+      const char* word = aCorpus->words[pick(&random, aCorpus->wordCount)];
+      aSet->keywords[i] = strdup(word);
+    }
+    else {
+      aSet->keywords[i] = madeUpKeyword(aKind, &random);
+    }
+    if (!aSet->keywords[i]) {
+      freeKeywordSet(aSet);
+      return false;
+    }
+
+    /* What censor() does to them. */
+    const size_t length = strlen(aSet->keywords[i]);
+    aSet->folded[i] = static_cast<char*>(malloc(length + 1));
+    if (!aSet->folded[i]) {
+      freeKeywordSet(aSet);
+      return false;
+    }
+    aSet->foldedLengths[i] = gfd::foldInto(aSet->folded[i],
+                                           aSet->keywords[i], length);
+    aSet->folded[i][aSet->foldedLengths[i]] = '\0';
+  }
+  return true;
+}
+
+static void scanWithMatcher(const char* aText, size_t aLength,
+                            const KeywordSet*, const void* aData,
+                            uint8_t* aHits) {
+  static_cast<const gfd::Matcher*>(aData)->scan(aText, aLength, aHits);
+}
+
+/* censor(), for a page of one fragment. */
+static void searchKeywords(const char* aText, size_t aLength,
+                           const KeywordSet* aSet, const void* aData,
+                           uint8_t* aHits) {
+  gfd::SearchFunction search = reinterpret_cast<gfd::SearchFunction>(
+    const_cast<void*>(aData));
+  uint32_t k;
+  for (k = 0; k < aSet->count; k++) {
+    if (aSet->foldedLengths[k] &&
+        search(aText, aLength, aSet->folded[k], aSet->foldedLengths[k]))
+      aHits[k] = 1;
+  }
+}
+
+static void searchKeywordsWithLibc(const char* aText, size_t,
+                                   const KeywordSet* aSet, const void*,
+                                   uint8_t* aHits) {
+  uint32_t k;
+  for (k = 0; k < aSet->count; k++) {
+    if (aSet->foldedLengths[k] && strcasestr(aText, aSet->folded[k]))
+      aHits[k] = 1;
+  }
+}
+
+static void printRow(const char* aCorpus, uint32_t aKeywords,
+                     const char* aName, double aSetup, size_t aBytes,
+                     uint64_t aTime, int64_t aHits) {
+  char keywords[16] = "-";
+  if (aKeywords)
+    snprintf(keywords, sizeof(keywords), "%u", aKeywords);
+  char hits[sizeof("-9223372036854775808")] = "-"; /* any int64_t */
+  if (aHits >= 0)
+    snprintf(hits, sizeof(hits), "%lld", static_cast<long long>(aHits));
+
+  printf("%-8s %8s  %-14s %9.1f %9.3g %9.3f %8s\n", aCorpus, keywords,
+         aName, aSetup / 1e6, aBytes / double(aTime), double(aTime) / aBytes,
+         hits);
+  fflush(stdout);
+}
+
+/* Runs aImplementation on each fragment of aCorpus as a page of its own,
+ * aOptions->repetitions times. The time is the best of them; only the
+ * calls of aImplementation are timed. aHits is scratch space. */
+static void measure(Implementation aImplementation, const void* aData,
+                    const Corpus* aCorpus, const KeywordSet* aSet,
+                    const Options* aOptions, uint8_t* aHits,
+                    Result* aResult) {
+  memset(aResult, 0, sizeof(Result));
+  aResult->time = UINT64_MAX;
+  uint32_t r;
+  for (r = 0; r < aOptions->repetitions; r++) {
+    uint64_t time = 0;
+    uint64_t hits = 0;
+    uint64_t checksum = 0;
+    uint32_t i;
+    for (i = 0; i < aCorpus->count; i++) {
+      memset(aHits, 0, aSet->count);
+      const uint64_t start = now();
+      aImplementation(aCorpus->data + aCorpus->offsets[i],
+                      aCorpus->lengths[i], aSet, aData, aHits);
+      time += now() - start;
+
+      uint32_t k;
+      for (k = 0; k < aSet->count; k++) {
+        if (aHits[k]) {
+          hits++;
+          checksum += (uint64_t(i) << 32 | k) * 0x9e3779b97f4a7c15ULL;
+        }
+      }
+    }
+    if (time < aResult->time)
+      aResult->time = time? time : 1;
+    aResult->hits = hits;
+    aResult->checksum = checksum;
+  }
+}
+
+/* Returns false if an implementation disagrees with the matcher. */
+static bool benchmark(CorpusKind aKind, const Corpus* aFolded,
+                      uint32_t aCount, const Options* aOptions) {
+  const char* corpusName = kCorpusNames[aKind];
+  KeywordSet set;
+  if (!generateKeywords(aKind, aFolded, aCount, &set)) {
+    fprintf(stderr, "%s: out of memory\n", kProductName);
+    return false;
+  }
+
+  uint8_t* hits = static_cast<uint8_t*>(calloc(aCount? aCount : 1, 1));
+  if (!hits) {
+    fprintf(stderr, "%s: out of memory\n", kProductName);
+    freeKeywordSet(&set);
+    return false;
+  }
+
+  bool succeeded(true);
+  uint64_t start = now();
+  gfd::Matcher* matcher = gfd::Matcher::compile(set.keywords, aCount);
+  const double setup = double(now() - start);
+  Result expected;
+  if (!matcher) {
+    fprintf(stderr, "%s: failed to compile %u keywords\n", kProductName,
+            aCount);
+    succeeded = false;
+  }
+  else {
+    measure(scanWithMatcher, matcher, aFolded, &set, aOptions, hits,
+            &expected);
+    printRow(corpusName, aCount, "matcher", setup, aFolded->size,
+             expected.time, int64_t(expected.hits));
+  }
+
+  static const struct {
+    const char* name;
+    const char* search;   /* NULL for strcasestr() */
+  } searches[] = {
+    { "censor/avx2", "avx2" },
+    { "censor/sse2", "sse2" },
+    { "censor/scalar", "scalar" },
+    { "strcasestr", NULL },
+  };
+  const bool withinBudget =
+    uint64_t(aCount) * aFolded->size <= aOptions->budget;
+  uint32_t s;
+  for (s = 0; matcher && s < GFD_COUNT_OF(searches); s++) {
+    Implementation implementation = searchKeywordsWithLibc;
+    const void* data(NULL);
+    if (searches[s].search) {
+      gfd::SearchFunction search = gfd::searchFunction(searches[s].search);
+      if (!search)
+        continue;
+      implementation = searchKeywords;
+      data = reinterpret_cast<const void*>(search);
+    }
+
+    if (!withinBudget) {
+      printf("%-8s %8u  %-14s %9s %9s %9s %8s\n", corpusName, aCount,
+             searches[s].name, "-", "skipped", "-", "-");
+      continue;
+    }
+
+    Result result;
+    measure(implementation, data, aFolded, &set, aOptions, hits, &result);
+    printRow(corpusName, aCount, searches[s].name, 0, aFolded->size,
+             result.time, int64_t(result.hits));
+
+    if (result.hits != expected.hits ||
+        result.checksum != expected.checksum) {
+      fprintf(stderr, "%s: %s and the matcher disagree on the %s corpus "
+              "with %u keywords\n", kProductName, searches[s].name,
+              corpusName, aCount);
+      succeeded = false;
+    }
+  }
+
+  delete matcher;
+  free(hits);
+  freeKeywordSet(&set);
+  return succeeded;
+}
+
+static bool parseSize(const char* aText, uint64_t* aValue) {
+  char* end;
+  unsigned long long value = strtoull(aText, &end, 10);
+  if (end == aText || *end || !value)
+    return false;
+  *aValue = value;
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: %s [-s size] [-f fragment] [-c corpora] [-k counts]\n"
+          "       [-r repetitions] [-b budget]\n", kProductName);
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  options.size = 1024 * 1024;
+  options.fragment = 4096;
+  options.repetitions = 3;
+  options.budget = uint64_t(256) * 1024 * 1024;
+
+  char corpora[64] = "ascii,utf8,repeat";
+  char counts[256] = "1,10,100,1000,10000,100000";
+
+  int option;
+  while (-1 != (option = getopt(argc, argv, "s:f:c:k:r:b:"))) {
+    uint64_t value(0);
+    switch (option) {
+    case 's':
+      if (!parseSize(optarg, &value)) {
+        usage();
+        return 2;
+      }
+      options.size = value * 1024;
+      break;
+    case 'f':
+      if (!parseSize(optarg, &value) || value < 2) {
+        usage();
+        return 2;
+      }
+      options.fragment = value;
+      break;
+    case 'c':
+      snprintf(corpora, sizeof(corpora), "%s", optarg);
+      break;
+    case 'k':
+      snprintf(counts, sizeof(counts), "%s", optarg);
+      break;
+    case 'r':
+      if (!parseSize(optarg, &value)) {
+        usage();
+        return 2;
+      }
+      options.repetitions = uint32_t(value);
+      break;
+    case 'b':
+      if (!parseSize(optarg, &value)) {
+        usage();
+        return 2;
+      }
+      options.budget = value * 1024 * 1024;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind != argc) {
+    usage();
+    return 2;
+  }
+
+  printf("%-8s %8s  %-14s %9s %9s %9s %8s\n", "corpus", "keywords",
+         "implementation", "setup ms", "GB/s", "ns/byte", "hits");
+
+  bool succeeded(true);
+  char* corpusList(NULL);
+  char* corpusName;
+  for (corpusName = strtok_r(corpora, ",", &corpusList); corpusName;
+       corpusName = strtok_r(NULL, ",", &corpusList)) {
+    uint32_t kind;
+    for (kind = 0; kind < GFD_COUNT_OF(kCorpusNames); kind++) {
+      if (0 == strcmp(corpusName, kCorpusNames[kind]))
+        break;
+    }
+    if (kind == GFD_COUNT_OF(kCorpusNames)) {
+      fprintf(stderr, "%s: no such corpus: %s\n", kProductName, corpusName);
+      return 2;
+    }
+
+    Corpus corpus;
+    Corpus folded;
+    memset(&folded, 0, sizeof(folded));
+    if (!generateCorpus(CorpusKind(kind), &options, &corpus)) {
+      fprintf(stderr, "%s: out of memory\n", kProductName);
+      return 1;
+    }
+
+    /* Folding, done once for all the keywords. */
+    uint64_t best = UINT64_MAX;
+    uint32_t r;
+    for (r = 0; r < options.repetitions; r++) {
+      free(folded.data);
+      free(folded.offsets);
+      free(folded.lengths);
+      const uint64_t start = now();
+      if (!foldCorpus(&corpus, &folded)) {
+        fprintf(stderr, "%s: out of memory\n", kProductName);
+        return 1;
+      }
+      const uint64_t time = now() - start;
+      if (time < best)
+        best = time;
+    }
+    printRow(kCorpusNames[kind], 0, "fold", 0, corpus.size, best? best : 1,
+             -1);
+
+    char countText[sizeof(counts)];
+    memcpy(countText, counts, sizeof(counts));
+    char* countList(NULL);
+    char* count;
+    for (count = strtok_r(countText, ",", &countList); count;
+         count = strtok_r(NULL, ",", &countList)) {
+      uint64_t value;
+      if (!parseSize(count, &value) || value > UINT32_MAX) {
+        fprintf(stderr, "%s: not a keyword count: %s\n", kProductName, count);
+        return 2;
+      }
+      if (!benchmark(CorpusKind(kind), &folded, uint32_t(value), &options))
+        succeeded = false;
+    }
+
+    freeCorpus(&folded);
+    freeCorpus(&corpus);
+  }
+  return succeeded? 0 : 1;
+}
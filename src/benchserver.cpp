@@ -0,0 +1,880 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+
+/* A stand-in AT-SPI application to benchmark great firedaemon against:
+ *
+ * $ ./gfd-bench-server [-d depth] [-f fan-out] [-t text-size]
+ *                      [-k keyword] [-p density] [-D documents]
+ *                      [-r rate] [-n events] [-u urls] [-c] [-q idle]
+ *                      [-H hidden] [-Z]
+ *
+ * It owns org.a11y.Bus and org.a11y.atspi.Registry on the session bus,
+ * whose address it hands out as the AT-SPI bus, so it is meant to run on a
+ * private dbus-daemon (gfd-bench starts one). It serves documents (4) alike,
+ * as a browser would its tabs: trees of the given depth and fan-out (3 and
+ * 4) whose leaves are text nodes of text-size bytes (256) of words, density
+ * per mille of them (0) being the keyword ("Voldemort"). Unless -c is
+ * given, all of them are also served by org.a11y.atspi.Cache. The last
+ * hidden per cent (0) of the children of a document are not showing, with
+ * everything under them, like rows scrolled out of view. With -Z, requests
+ * about the documents are never answered, as by a hung application.
+ *
+ * Once a client has registered for document:load-complete, it emits
+ * events LoadComplete signals (100), rate per second (10; 0 for all at
+ * once), for each document in turn. Each event gives its document a new
+ * DocURL, or one of urls URLs in turn, so that the result cache of greatfd
+ * can be measured too. After the last event it waits until no request has
+ * come for idle milliseconds (1000), prints what it served to stdout and
+ * goes on answering until it is terminated:
+ *
+ * >events=100 requests=4600 elapsed=9.904
+ *
+ * where requests counts the method calls on the documents and elapsed is
+ * the time in seconds from the first signal to the last of them.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include <dbus/dbus.h>
+}
+
+#include "greatfd.h"
+
+static const char kProductName[] = "gfd-bench-server";
+
+static const char kObjectPathPrefix[]  = "/org/a11y/atspi/accessible/";
+static const char kRootPath[]          = "/org/a11y/atspi/accessible/root";
+static const char kLoadCompleteEvent[] = "document:load-complete";
+
+/* Between the registration and the first signal, for the client to finish
+ * starting up. */
+static const uint64_t kSettleTime = 200 * 1000 * 1000; /* ns */
+
+static const uint32_t kMaxObjects = 10 * 1000 * 1000;
+
+/* ATSPI_STATE_SHOWING and ATSPI_STATE_VISIBLE */
+static const uint32_t kStateShowing = 1 << 25;
+static const uint32_t kStateVisible = 1 << 30;
+
+static const char* const kWords[] = {
+  "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+  "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+  "et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam",
+  "quis", "nostrud", "exercitation", "ullamco", "laboris", "nisi",
+  "aliquip", "ex", "ea", "commodo", "consequat",
+};
+
+typedef struct _Options {
+  uint32_t depth;
+  uint32_t fanOut;
+  uint32_t textSize;
+  const char* keyword;
+  double density;      /* per mille of the words */
+  uint32_t documents;
+  double rate;         /* events per second, 0 for all at once */
+  uint32_t events;
+  uint32_t urls;       /* distinct DocURLs, 0 for a new one every event */
+  bool cache;
+  uint32_t idle;       /* ms */
+  uint32_t hidden;     /* per cent of the children of a document */
+  bool hung;           /* never answer about the documents */
+} Options;
+
+/* The tree every document has. Nodes are numbered breadth first from the
+ * document, 0; object n is node n % count of document n / count. */
+typedef struct _Tree {
+  uint32_t count;
+  uint32_t* parents;
+  uint32_t* firstChild;
+  uint32_t* childCounts;
+  char** texts;          /* NULL for a container */
+  uint32_t* textLengths;
+  uint32_t* states;      /* first word of the state set */
+} Tree;
+
+typedef struct _Server {
+  Options options;
+  Tree tree;
+  uint32_t* urls;        /* DocURL number of each document */
+  const char* address;   /* of the bus */
+
+  bool registered;       /* for document:load-complete */
+  uint64_t start;        /* when the first signal is due */
+  uint32_t sent;
+  uint64_t firstSent;
+  uint64_t lastActivity; /* signal or request */
+  uint64_t lastRequest;
+  uint64_t requests;
+} Server;
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+/* xorshift64*; the same text every run. */
+static uint64_t nextRandom(uint64_t* aState) {
+  uint64_t x = *aState;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *aState = x;
+  return x * 0x2545f4914f6cdd1dULL;
+}
+
+static char* newText(const Options* aOptions, uint64_t* aRandom,
+                     uint32_t* aLength) {
+  const uint32_t keywordLength = strlen(aOptions->keyword);
+  const uint32_t wordCount = sizeof(kWords) / sizeof(kWords[0]);
+  char* text = static_cast<char*>(malloc(aOptions->textSize + 1));
+  if (!text)
+    return NULL;
+
+  uint32_t length = 0;
+  while (length < aOptions->textSize) {
+    const char* word;
+    uint32_t wordLength;
+    if (aOptions->density > 0 &&
+        nextRandom(aRandom) % 1000000 < aOptions->density * 1000) {
+      word = aOptions->keyword;
+      wordLength = keywordLength;
+    }
+    else {
+      word = kWords[nextRandom(aRandom) % wordCount];
+      wordLength = strlen(word);
+    }
+
+    if (length) {
+      text[length++] = ' ';
+      if (length == aOptions->textSize)
+        break;
+    }
+    if (wordLength > aOptions->textSize - length)
+      wordLength = aOptions->textSize - length;
+    memcpy(text + length, word, wordLength);
+    length += wordLength;
+  }
+  text[length] = '\0';
+  *aLength = length;
+  return text;
+}
+
+static bool buildTree(const Options* aOptions, Tree* aTree) {
+  uint64_t count = 1;
+  uint64_t level = 1;
+  uint32_t d;
+  for (d = 0; d < aOptions->depth; d++) {
+    level *= aOptions->fanOut;
+    count += level;
+    if (count * aOptions->documents > kMaxObjects) {
+      fprintf(stderr, "%s: too many objects\n", kProductName);
+      return false;
+    }
+  }
+
+  memset(aTree, 0, sizeof(Tree));
+  aTree->count = uint32_t(count);
+  aTree->parents = static_cast<uint32_t*>(calloc(count, sizeof(uint32_t)));
+  aTree->firstChild =
+    static_cast<uint32_t*>(calloc(count, sizeof(uint32_t)));
+  aTree->childCounts =
+    static_cast<uint32_t*>(calloc(count, sizeof(uint32_t)));
+  aTree->texts = static_cast<char**>(calloc(count, sizeof(char*)));
+  aTree->textLengths =
+    static_cast<uint32_t*>(calloc(count, sizeof(uint32_t)));
+  aTree->states = static_cast<uint32_t*>(calloc(count, sizeof(uint32_t)));
+  if (!aTree->parents || !aTree->firstChild || !aTree->childCounts ||
+      !aTree->texts || !aTree->textLengths || !aTree->states)
+    return false;
+
+  uint64_t random = 0x9e3779b97f4a7c15ULL;
+  uint32_t next = 1;
+  uint32_t i;
+  for (i = 0; i < aTree->count; i++) {
+    if (next + aOptions->fanOut <= aTree->count) {
+      aTree->firstChild[i] = next;
+      aTree->childCounts[i] = aOptions->fanOut;
+      uint32_t c;
+      for (c = 0; c < aOptions->fanOut; c++)
+        aTree->parents[next++] = i;
+    }
+    else if (i) {
+      aTree->texts[i] = newText(aOptions, &random, &aTree->textLengths[i]);
+      if (!aTree->texts[i])
+        return false;
+    }
+  }
+
+  /* Parents come before their children. */
+  const uint32_t showing = aTree->childCounts[0] * (100 - aOptions->hidden);
+  aTree->states[0] = kStateShowing | kStateVisible;
+  for (i = 1; i < aTree->count; i++) {
+    if (aTree->parents[i])
+      aTree->states[i] = aTree->states[aTree->parents[i]];
+    else if ((i - aTree->firstChild[0]) * 100 < showing)
+      aTree->states[i] = kStateShowing | kStateVisible;
+    else
+      aTree->states[i] = kStateVisible;
+  }
+  return true;
+}
+
+/* Returns the object aPath names, or UINT32_MAX. */
+static uint32_t findObject(const Server* aServer, const char* aPath) {
+  if (!aPath || strncmp(aPath, kObjectPathPrefix,
+                        sizeof(kObjectPathPrefix) - 1))
+    return UINT32_MAX;
+
+  const char* number = aPath + sizeof(kObjectPathPrefix) - 1;
+  char* end;
+  unsigned long id = strtoul(number, &end, 10);
+  if (end == number || *end ||
+      id >= uint64_t(aServer->tree.count) * aServer->options.documents)
+    return UINT32_MAX;
+  return uint32_t(id);
+}
+
+static void appendReference(DBusMessageIter* aIter, const char* aName,
+                            const char* aPath) {
+  DBusMessageIter reference;
+  dbus_message_iter_open_container(aIter, DBUS_TYPE_STRUCT, NULL,
+                                   &reference);
+  dbus_message_iter_append_basic(&reference, DBUS_TYPE_STRING, &aName);
+  dbus_message_iter_append_basic(&reference, DBUS_TYPE_OBJECT_PATH, &aPath);
+  dbus_message_iter_close_container(aIter, &reference);
+}
+
+static void appendObject(DBusMessageIter* aIter, const char* aName,
+                         uint32_t aId) {
+  char path[sizeof(kObjectPathPrefix) + 16];
+  snprintf(path, sizeof(path), "%s%u", kObjectPathPrefix, aId);
+  appendReference(aIter, aName, path);
+}
+
+static void appendParent(DBusMessageIter* aIter, const Tree* aTree,
+                         const char* aName, uint32_t aId) {
+  const uint32_t node = aId % aTree->count;
+  if (node)
+    appendObject(aIter, aName, aId - node + aTree->parents[node]);
+  else
+    appendReference(aIter, aName, kRootPath);
+}
+
+static void appendInterfaces(DBusMessageIter* aIter, const Tree* aTree,
+                             uint32_t aNode) {
+  DBusMessageIter array;
+  dbus_message_iter_open_container(aIter, DBUS_TYPE_ARRAY, "s", &array);
+  const char* interface = gfd::atspi::interface::kAccessible;
+  dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING, &interface);
+  if (aTree->texts[aNode]) {
+    interface = gfd::atspi::interface::kText;
+    dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING, &interface);
+  }
+  else if (!aNode) {
+    interface = gfd::atspi::interface::kDocument;
+    dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING, &interface);
+  }
+  dbus_message_iter_close_container(aIter, &array);
+}
+
+static void appendInt32Variant(DBusMessageIter* aIter, int32_t aValue) {
+  DBusMessageIter variant;
+  dbus_message_iter_open_container(aIter, DBUS_TYPE_VARIANT, "i", &variant);
+  dbus_message_iter_append_basic(&variant, DBUS_TYPE_INT32, &aValue);
+  dbus_message_iter_close_container(aIter, &variant);
+}
+
+static void appendInt32Property(DBusMessageIter* aIter, const char* aName,
+                                int32_t aValue) {
+  DBusMessageIter entry;
+  dbus_message_iter_open_container(aIter, DBUS_TYPE_DICT_ENTRY, NULL,
+                                   &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &aName);
+  appendInt32Variant(&entry, aValue);
+  dbus_message_iter_close_container(aIter, &entry);
+}
+
+static void appendStates(DBusMessageIter* aIter, const Tree* aTree,
+                         uint32_t aNode) {
+  DBusMessageIter states;
+  dbus_message_iter_open_container(aIter, DBUS_TYPE_ARRAY, "u", &states);
+  const uint32_t words[] = { aTree->states[aNode], 0 };
+  dbus_message_iter_append_basic(&states, DBUS_TYPE_UINT32, &words[0]);
+  dbus_message_iter_append_basic(&states, DBUS_TYPE_UINT32, &words[1]);
+  dbus_message_iter_close_container(aIter, &states);
+}
+
+/* org.a11y.atspi.Cache.GetItems: every object of every document. */
+static DBusMessage* getItems(DBusMessage* aMethod, const Server* aServer,
+                             const char* aName) {
+  const Tree* tree = &aServer->tree;
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  DBusMessageIter array;
+  dbus_message_iter_init_append(reply, &iter);
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+                                   "((so)(so)(so)iiassusau)", &array);
+  const uint32_t count = tree->count * aServer->options.documents;
+  uint32_t id;
+  for (id = 0; id < count; id++) {
+    const uint32_t node = id % tree->count;
+    DBusMessageIter item;
+    dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT, NULL, &item);
+    appendObject(&item, aName, id);
+    appendReference(&item, aName, kRootPath);
+    appendParent(&item, tree, aName, id);
+
+    int32_t index = node?
+      int32_t(node - tree->firstChild[tree->parents[node]]) : -1;
+    int32_t childCount = int32_t(tree->childCounts[node]);
+    dbus_message_iter_append_basic(&item, DBUS_TYPE_INT32, &index);
+    dbus_message_iter_append_basic(&item, DBUS_TYPE_INT32, &childCount);
+    appendInterfaces(&item, tree, node);
+
+    const char* name = "";
+    uint32_t role = 0;
+    dbus_message_iter_append_basic(&item, DBUS_TYPE_STRING, &name);
+    dbus_message_iter_append_basic(&item, DBUS_TYPE_UINT32, &role);
+    dbus_message_iter_append_basic(&item, DBUS_TYPE_STRING, &name);
+
+    appendStates(&item, tree, node);
+
+    dbus_message_iter_close_container(&array, &item);
+  }
+  dbus_message_iter_close_container(&iter, &array);
+  return reply;
+}
+
+/* org.freedesktop.DBus.Properties.Get and GetAll. */
+static DBusMessage* getProperties(DBusMessage* aMethod, const Tree* aTree,
+                                  const char* aName, uint32_t aId,
+                                  bool aAll) {
+  const uint32_t node = aId % aTree->count;
+  const char* interface(NULL);
+  const char* property(NULL);
+  bool succeeded = aAll?
+    dbus_message_get_args(aMethod, NULL,
+                          DBUS_TYPE_STRING, &interface,
+                          DBUS_TYPE_INVALID) :
+    dbus_message_get_args(aMethod, NULL,
+                          DBUS_TYPE_STRING, &interface,
+                          DBUS_TYPE_STRING, &property,
+                          DBUS_TYPE_INVALID);
+  if (!succeeded)
+    return dbus_message_new_error(aMethod, DBUS_ERROR_INVALID_ARGS,
+                                  "Invalid arguments");
+
+  const bool text = (0 == strcmp(interface, gfd::atspi::interface::kText));
+  if ((!text && strcmp(interface, gfd::atspi::interface::kAccessible)) ||
+      (text && !aTree->texts[node]))
+    return dbus_message_new_error(aMethod, DBUS_ERROR_UNKNOWN_INTERFACE,
+                                  interface);
+
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  dbus_message_iter_init_append(reply, &iter);
+
+  if (aAll) {
+    DBusMessageIter array;
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}",
+                                     &array);
+    if (text) {
+      appendInt32Property(&array, "CharacterCount",
+                          int32_t(aTree->textLengths[node]));
+      appendInt32Property(&array, "CaretOffset", 0);
+    }
+    else {
+      appendInt32Property(&array, "ChildCount",
+                          int32_t(aTree->childCounts[node]));
+    }
+    dbus_message_iter_close_container(&iter, &array);
+    return reply;
+  }
+
+  if (text && 0 == strcmp(property, "CharacterCount")) {
+    appendInt32Variant(&iter, int32_t(aTree->textLengths[node]));
+  }
+  else if (!text && 0 == strcmp(property, "ChildCount")) {
+    appendInt32Variant(&iter, int32_t(aTree->childCounts[node]));
+  }
+  else if (!text && 0 == strcmp(property, "Parent")) {
+    DBusMessageIter variant;
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_VARIANT, "(so)",
+                                     &variant);
+    appendParent(&variant, aTree, aName, aId);
+    dbus_message_iter_close_container(&iter, &variant);
+  }
+  else {
+    dbus_message_unref(reply);
+    return dbus_message_new_error(aMethod, DBUS_ERROR_UNKNOWN_PROPERTY,
+                                  property);
+  }
+  return reply;
+}
+
+static DBusMessage* getText(DBusMessage* aMethod, const Tree* aTree,
+                            uint32_t aNode) {
+  int32_t start(0);
+  int32_t end(0);
+  if (!aTree->texts[aNode] ||
+      !dbus_message_get_args(aMethod, NULL,
+                             DBUS_TYPE_INT32, &start,
+                             DBUS_TYPE_INT32, &end,
+                             DBUS_TYPE_INVALID))
+    return dbus_message_new_error(aMethod, DBUS_ERROR_INVALID_ARGS,
+                                  "Invalid arguments");
+
+  /* Offsets are in characters; the text is ASCII. */
+  const int32_t length = int32_t(aTree->textLengths[aNode]);
+  if (end < 0 || end > length)
+    end = length;
+  if (start < 0)
+    start = 0;
+  if (start > end)
+    start = end;
+
+  char* text = strndup(aTree->texts[aNode] + start, end - start);
+  if (!text)
+    return NULL;
+
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (reply)
+    dbus_message_append_args(reply, DBUS_TYPE_STRING, &text,
+                             DBUS_TYPE_INVALID);
+  free(text);
+  return reply;
+}
+
+static DBusMessage* getChildren(DBusMessage* aMethod, const Tree* aTree,
+                                const char* aName, uint32_t aId) {
+  const uint32_t node = aId % aTree->count;
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  DBusMessageIter array;
+  dbus_message_iter_init_append(reply, &iter);
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(so)", &array);
+  uint32_t c;
+  for (c = 0; c < aTree->childCounts[node]; c++)
+    appendObject(&array, aName, aId - node + aTree->firstChild[node] + c);
+  dbus_message_iter_close_container(&iter, &array);
+  return reply;
+}
+
+static DBusMessage* getState(DBusMessage* aMethod, const Tree* aTree,
+                             uint32_t aNode) {
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  dbus_message_iter_init_append(reply, &iter);
+  appendStates(&iter, aTree, aNode);
+  return reply;
+}
+
+static DBusMessage* getChildAtIndex(DBusMessage* aMethod, const Tree* aTree,
+                                    const char* aName, uint32_t aId) {
+  const uint32_t node = aId % aTree->count;
+  int32_t index(-1);
+  if (!dbus_message_get_args(aMethod, NULL,
+                             DBUS_TYPE_INT32, &index,
+                             DBUS_TYPE_INVALID) ||
+      index < 0 || uint32_t(index) >= aTree->childCounts[node])
+    return dbus_message_new_error(aMethod, DBUS_ERROR_INVALID_ARGS,
+                                  "Invalid arguments");
+
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  dbus_message_iter_init_append(reply, &iter);
+  appendObject(&iter, aName, aId - node + aTree->firstChild[node] + index);
+  return reply;
+}
+
+static DBusMessage* getInterfaces(DBusMessage* aMethod, const Tree* aTree,
+                                  uint32_t aNode) {
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  if (!reply)
+    return NULL;
+
+  DBusMessageIter iter;
+  dbus_message_iter_init_append(reply, &iter);
+  appendInterfaces(&iter, aTree, aNode);
+  return reply;
+}
+
+static DBusMessage* getAttributeValue(DBusMessage* aMethod, uint32_t aUrl) {
+  const char* attribute(NULL);
+  if (!dbus_message_get_args(aMethod, NULL,
+                             DBUS_TYPE_STRING, &attribute,
+                             DBUS_TYPE_INVALID))
+    return dbus_message_new_error(aMethod, DBUS_ERROR_INVALID_ARGS,
+                                  "Invalid arguments");
+
+  char url[64] = "";
+  if (0 == strcmp(attribute, "DocURL"))
+    snprintf(url, sizeof(url), "http://bench.invalid/%u", aUrl);
+
+  DBusMessage* reply = dbus_message_new_method_return(aMethod);
+  const char* value = url;
+  if (reply)
+    dbus_message_append_args(reply, DBUS_TYPE_STRING, &value,
+                             DBUS_TYPE_INVALID);
+  return reply;
+}
+
+/* A method of a document or of one of its objects. */
+static DBusMessage* handleObjectMethod(Server* aServer, DBusMessage* aMethod,
+                                       const char* aName) {
+  const Tree* tree = &aServer->tree;
+  const char* interface = dbus_message_get_interface(aMethod);
+  const char* member = dbus_message_get_member(aMethod);
+  const char* path = dbus_message_get_path(aMethod);
+  if (!interface || !member)
+    return dbus_message_new_error(aMethod, DBUS_ERROR_UNKNOWN_METHOD,
+                                  "No interface");
+
+  if (aServer->options.cache &&
+      0 == strcmp(path, GFD_ATSPI_CACHE_PATH) &&
+      0 == strcmp(interface, gfd::atspi::interface::kCache) &&
+      0 == strcmp(member, "GetItems"))
+    return getItems(aMethod, aServer, aName);
+
+  const uint32_t id = findObject(aServer, path);
+  if (id == UINT32_MAX)
+    return dbus_message_new_error(aMethod, DBUS_ERROR_UNKNOWN_OBJECT, path);
+  const uint32_t node = id % tree->count;
+
+  if (0 == strcmp(interface, DBUS_INTERFACE_PROPERTIES)) {
+    if (0 == strcmp(member, "Get"))
+      return getProperties(aMethod, tree, aName, id, false);
+    if (0 == strcmp(member, "GetAll"))
+      return getProperties(aMethod, tree, aName, id, true);
+  }
+  else if (0 == strcmp(interface, gfd::atspi::interface::kAccessible)) {
+    if (0 == strcmp(member, "GetChildren"))
+      return getChildren(aMethod, tree, aName, id);
+    if (0 == strcmp(member, "GetChildAtIndex"))
+      return getChildAtIndex(aMethod, tree, aName, id);
+    if (0 == strcmp(member, "GetInterfaces"))
+      return getInterfaces(aMethod, tree, node);
+    if (0 == strcmp(member, "GetState"))
+      return getState(aMethod, tree, node);
+  }
+  else if (0 == strcmp(interface, gfd::atspi::interface::kText)) {
+    if (0 == strcmp(member, "GetText"))
+      return getText(aMethod, tree, node);
+  }
+  else if (0 == strcmp(interface, gfd::atspi::interface::kDocument)) {
+    if (0 == strcmp(member, "GetAttributeValue") && !node)
+      return getAttributeValue(aMethod, aServer->urls[id / tree->count]);
+  }
+  return dbus_message_new_error(aMethod, DBUS_ERROR_UNKNOWN_METHOD, member);
+}
+
+static DBusHandlerResult handleMessage(DBusConnection* aConnection,
+                                       DBusMessage* aMessage,
+                                       void* aData) {
+  if (DBUS_MESSAGE_TYPE_METHOD_CALL != dbus_message_get_type(aMessage))
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  Server* server = static_cast<Server*>(aData);
+  DBusMessage* reply(NULL);
+
+  if (dbus_message_is_method_call(aMessage, GFD_A11Y_INTERFACE,
+                                  "GetAddress")) {
+    reply = dbus_message_new_method_return(aMessage);
+    if (reply)
+      dbus_message_append_args(reply, DBUS_TYPE_STRING, &server->address,
+                               DBUS_TYPE_INVALID);
+  }
+  else if (dbus_message_is_method_call(aMessage,
+                                       GFD_ATSPI_REGISTRY_INTERFACE,
+                                       "RegisterEvent")) {
+    const char* event(NULL);
+    if (dbus_message_get_args(aMessage, NULL,
+                              DBUS_TYPE_STRING, &event,
+                              DBUS_TYPE_INVALID) &&
+        0 == strcmp(event, kLoadCompleteEvent) && !server->registered) {
+      server->registered = true;
+      server->start = now() + kSettleTime;
+    }
+    reply = dbus_message_new_method_return(aMessage);
+  }
+  else if (dbus_message_is_method_call(aMessage,
+                                       GFD_ATSPI_REGISTRY_INTERFACE,
+                                       "DeregisterEvent")) {
+    reply = dbus_message_new_method_return(aMessage);
+  }
+  else {
+    server->requests++;
+    server->lastRequest = server->lastActivity = now();
+    if (server->options.hung)
+      return DBUS_HANDLER_RESULT_HANDLED;
+    reply = handleObjectMethod(server, aMessage,
+                               dbus_bus_get_unique_name(aConnection));
+  }
+
+  if (!reply)
+    return DBUS_HANDLER_RESULT_NEED_MEMORY;
+
+  dbus_connection_send(aConnection, reply, NULL);
+  dbus_message_unref(reply);
+  return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static bool sendLoadComplete(DBusConnection* aConnection, Server* aServer) {
+  const Options* options = &aServer->options;
+  const uint32_t document = aServer->sent % options->documents;
+  const uint32_t url = options->urls?
+    aServer->sent % options->urls : aServer->sent;
+  aServer->urls[document] = url;
+
+  char path[sizeof(kObjectPathPrefix) + 16];
+  snprintf(path, sizeof(path), "%s%u", kObjectPathPrefix,
+           document * aServer->tree.count);
+  DBusMessage* signal =
+    dbus_message_new_signal(path, gfd::atspi::interface::kEventDocument,
+                            "LoadComplete");
+  if (!signal)
+    return false;
+
+  /* (detail, detail1, detail2, any_data); the title is in any_data. */
+  char title[64];
+  snprintf(title, sizeof(title), "Synthetic document %u", url);
+  const char* detail = "";
+  const char* value = title;
+  int32_t zero = 0;
+  DBusMessageIter iter;
+  DBusMessageIter variant;
+  dbus_message_iter_init_append(signal, &iter);
+  dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &detail);
+  dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &zero);
+  dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &zero);
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_VARIANT, "s", &variant);
+  dbus_message_iter_append_basic(&variant, DBUS_TYPE_STRING, &value);
+  dbus_message_iter_close_container(&iter, &variant);
+
+  bool succeeded = dbus_connection_send(aConnection, signal, NULL);
+  dbus_message_unref(signal);
+
+  const uint64_t sent = now();
+  if (!aServer->sent)
+    aServer->firstSent = sent;
+  aServer->lastActivity = sent;
+  aServer->sent++;
+  return succeeded;
+}
+
+/* When the next signal is due; -1 if none is. */
+static int64_t nextDue(const Server* aServer) {
+  const Options* options = &aServer->options;
+  if (!aServer->registered || aServer->sent == options->events)
+    return -1;
+  if (options->rate <= 0)
+    return int64_t(aServer->start);
+  return int64_t(aServer->start + uint64_t(aServer->sent * 1e9 /
+                                           options->rate));
+}
+
+static bool parseNumber(const char* aText, uint32_t* aValue) {
+  char* end;
+  unsigned long value = strtoul(aText, &end, 10);
+  if (end == aText || *end || value > UINT32_MAX)
+    return false;
+  *aValue = uint32_t(value);
+  return true;
+}
+
+static bool parseReal(const char* aText, double* aValue) {
+  char* end;
+  *aValue = strtod(aText, &end);
+  return end != aText && !*end && *aValue >= 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: %s [-d depth] [-f fan-out] [-t text-size] [-k keyword]\n"
+          "       [-p density] [-D documents] [-r rate] [-n events] "
+          "[-u urls]\n"
+          "       [-c] [-q idle] [-H hidden] [-Z]\n", kProductName);
+}
+
+int main(int argc, char* argv[]) {
+  Server server;
+  memset(&server, 0, sizeof(server));
+  Options* options = &server.options;
+  options->depth = 3;
+  options->fanOut = 4;
+  options->textSize = 256;
+  options->keyword = "Voldemort";
+  options->density = 0;
+  options->documents = 4;
+  options->rate = 10;
+  options->events = 100;
+  options->urls = 0;
+  options->cache = true;
+  options->idle = 1000;
+  options->hidden = 0;
+  options->hung = false;
+
+  int option;
+  while (-1 != (option = getopt(argc, argv, "d:f:t:k:p:D:r:n:u:cq:H:Z"))) {
+    bool succeeded(true);
+    switch (option) {
+    case 'd': succeeded = parseNumber(optarg, &options->depth); break;
+    case 'f': succeeded = parseNumber(optarg, &options->fanOut); break;
+    case 't': succeeded = parseNumber(optarg, &options->textSize); break;
+    case 'k': options->keyword = optarg; break;
+    case 'p': succeeded = parseReal(optarg, &options->density); break;
+    case 'D': succeeded = parseNumber(optarg, &options->documents); break;
+    case 'r': succeeded = parseReal(optarg, &options->rate); break;
+    case 'n': succeeded = parseNumber(optarg, &options->events); break;
+    case 'u': succeeded = parseNumber(optarg, &options->urls); break;
+    case 'c': options->cache = false; break;
+    case 'q': succeeded = parseNumber(optarg, &options->idle); break;
+    case 'H': succeeded = parseNumber(optarg, &options->hidden); break;
+    case 'Z': options->hung = true; break;
+    default: succeeded = false; break;
+    }
+    if (!succeeded) {
+      usage();
+      return 2;
+    }
+  }
+  if (optind != argc || !options->fanOut || !options->documents ||
+      !*options->keyword || options->hidden > 100) {
+    usage();
+    return 2;
+  }
+
+  server.urls =
+    static_cast<uint32_t*>(calloc(options->documents, sizeof(uint32_t)));
+  if (!server.urls || !buildTree(options, &server.tree)) {
+    fprintf(stderr, "%s: failed to build the documents\n", kProductName);
+    return 1;
+  }
+
+  server.address = getenv("DBUS_SESSION_BUS_ADDRESS");
+  if (!server.address) {
+    fprintf(stderr, "%s: DBUS_SESSION_BUS_ADDRESS is not set\n",
+            kProductName);
+    return 1;
+  }
+
+  DBusError error;
+  dbus_error_init(&error);
+
+  DBusConnection* connection = dbus_bus_get(DBUS_BUS_SESSION, &error);
+  if (!connection) {
+    fprintf(stderr, "%s: %s\n", kProductName, error.message);
+    dbus_error_free(&error);
+    return 1;
+  }
+
+  static const char* const names[] = {
+    GFD_A11Y_DESTINATION,
+    GFD_ATSPI_REGISTRY_DESTINATION,
+  };
+  uint32_t n;
+  for (n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+    int result = dbus_bus_request_name(connection, names[n],
+                                       DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+    if (result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+      fprintf(stderr, "%s: can't own %s%s%s\n", kProductName, names[n],
+              dbus_error_is_set(&error)? ": " : "",
+              dbus_error_is_set(&error)? error.message : "");
+      dbus_error_free(&error);
+      dbus_connection_unref(connection);
+      return 1;
+    }
+  }
+
+  if (!dbus_connection_add_filter(connection, handleMessage, &server,
+                                  NULL)) {
+    dbus_connection_unref(connection);
+    return 1;
+  }
+
+  uint32_t texts = 0;
+  uint32_t i;
+  for (i = 0; i < server.tree.count; i++) {
+    if (server.tree.texts[i])
+      texts++;
+  }
+  fprintf(stderr, "%s: %u documents of %u objects, %u texts of %u bytes\n",
+          kProductName, options->documents, server.tree.count, texts,
+          options->textSize);
+
+  /* Tells gfd-bench that the names are owned. */
+  printf("ready\n");
+  fflush(stdout);
+
+  for (;;) {
+    int64_t due = nextDue(&server);
+    uint64_t current = now();
+    while (due >= 0 && uint64_t(due) <= current) {
+      if (!sendLoadComplete(connection, &server)) {
+        fprintf(stderr, "%s: failed to send a signal\n", kProductName);
+        break;
+      }
+      due = nextDue(&server);
+      current = now();
+    }
+
+    if (server.registered && server.sent == options->events &&
+        current - server.lastActivity >= uint64_t(options->idle) * 1000000)
+      break;
+
+    /* Wake up for the next signal, or to see whether it is idle. */
+    int timeout = int(options->idle);
+    if (due >= 0)
+      timeout = int((uint64_t(due) - current + 999999) / 1000000);
+    if (!dbus_connection_read_write_dispatch(connection, timeout))
+      break;
+  }
+
+  const double elapsed = (server.lastRequest > server.firstSent)?
+    (server.lastRequest - server.firstSent) / 1e9 : 0;
+  printf("events=%u requests=%llu elapsed=%.3f\n", server.sent,
+         static_cast<unsigned long long>(server.requests), elapsed);
+  fflush(stdout);
+
+  /* Until terminated, so that the client can deregister. */
+  while (dbus_connection_read_write_dispatch(connection, -1))
+    ;
+
+  dbus_connection_unref(connection);
+  return 0;
+}
@@ -0,0 +1,173 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "breaker.h"
+
+#include "metrics.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Unique names (":1.42") are much shorter. */
+#define GFD_BREAKER_NAME_SIZE 64
+
+namespace gfd {
+
+typedef enum {
+  eBreakerFree,     /* slot unused */
+  eBreakerClosed,   /* some timeouts, events go through */
+  eBreakerOpen,     /* events are skipped until `until' */
+  eBreakerProbing   /* an event let through after the cool-down */
+} BreakerState;
+
+typedef struct _Breaker {
+  char sender[GFD_BREAKER_NAME_SIZE];
+  BreakerState state;
+  uint32_t failures; /* events in a row with a timeout */
+  uint64_t until;    /* end of the cool-down, or of the probe */
+  uint64_t last;     /* last event */
+} Breaker;
+
+struct _BreakerTable {
+  pthread_mutex_t lock;
+  Breaker slots[GFD_BREAKER_SLOTS];
+  uint32_t trips;
+  uint32_t skipped;
+};
+
+static Breaker* findBreaker(BreakerTable* aTable, const char* aSender) {
+  uint32_t i;
+  for (i = 0; i < GFD_BREAKER_SLOTS; i++) {
+    Breaker* breaker = &aTable->slots[i];
+    if (breaker->state != eBreakerFree &&
+        0 == strcmp(breaker->sender, aSender))
+      return breaker;
+  }
+  return NULL;
+}
+
+/* A free slot, or the one least worth keeping: closed, or open with its
+ * cool-down over, and quiet the longest. NULL if every breaker is open. */
+static Breaker* takeSlot(BreakerTable* aTable, uint64_t aNow) {
+  Breaker* oldest(NULL);
+  uint32_t i;
+  for (i = 0; i < GFD_BREAKER_SLOTS; i++) {
+    Breaker* breaker = &aTable->slots[i];
+    if (breaker->state == eBreakerFree)
+      return breaker;
+    bool idle = breaker->state == eBreakerClosed || aNow >= breaker->until;
+    if (idle && (!oldest || breaker->last < oldest->last))
+      oldest = breaker;
+  }
+  return oldest;
+}
+
+static void trip(BreakerTable* aTable, Breaker* aBreaker, uint64_t aNow) {
+  aBreaker->state = eBreakerOpen;
+  aBreaker->until = aNow + GFD_BREAKER_COOLDOWN;
+  aTable->trips++;
+  addCounter(eCounterBreakerTrips, 1);
+}
+
+BreakerTable* newBreakerTable() {
+  BreakerTable* table =
+    static_cast<BreakerTable*>(calloc(1, sizeof(BreakerTable)));
+  if (!table)
+    return NULL;
+  pthread_mutex_init(&table->lock, NULL);
+  return table;
+}
+
+void freeBreakerTable(BreakerTable* aTable) {
+  if (!aTable)
+    return;
+  pthread_mutex_destroy(&aTable->lock);
+  free(aTable);
+}
+
+bool admitSender(BreakerTable* aTable, const char* aSender, uint64_t aNow) {
+  bool admitted = true;
+
+  pthread_mutex_lock(&aTable->lock);
+  Breaker* breaker = findBreaker(aTable, aSender);
+  if (breaker) {
+    breaker->last = aNow;
+    if (breaker->state != eBreakerClosed && aNow >= breaker->until) {
+      /* A probe that isn't reported in as long counts as open. */
+      breaker->state = eBreakerProbing;
+      breaker->until = aNow + GFD_BREAKER_COOLDOWN;
+    }
+    else if (breaker->state == eBreakerOpen) {
+      admitted = false;
+    }
+  }
+  if (!admitted) {
+    aTable->skipped++;
+    addCounter(eCounterSkipped, 1);
+  }
+  pthread_mutex_unlock(&aTable->lock);
+  return admitted;
+}
+
+void reportSender(BreakerTable* aTable, const char* aSender, bool aTimedOut,
+                  uint64_t aNow) {
+  if (GFD_BREAKER_THRESHOLD <= 0 ||
+      strlen(aSender) >= GFD_BREAKER_NAME_SIZE)
+    return;
+
+  pthread_mutex_lock(&aTable->lock);
+  Breaker* breaker = findBreaker(aTable, aSender);
+  if (!aTimedOut) {
+    /* Answered: forgotten. */
+    if (breaker)
+      breaker->state = eBreakerFree;
+  }
+  else {
+    if (!breaker) {
+      breaker = takeSlot(aTable, aNow);
+      if (breaker) {
+        strcpy(breaker->sender, aSender);
+        breaker->state = eBreakerClosed;
+        breaker->failures = 0;
+      }
+    }
+    if (breaker) {
+      breaker->last = aNow;
+      breaker->failures++;
+      if (breaker->state == eBreakerProbing ||
+          (breaker->state == eBreakerClosed &&
+           breaker->failures >= GFD_BREAKER_THRESHOLD))
+        trip(aTable, breaker, aNow);
+    }
+  }
+  pthread_mutex_unlock(&aTable->lock);
+}
+
+void getBreakerStatistics(BreakerTable* aTable, uint64_t aNow,
+                          BreakerStatistics* aStatistics) {
+  pthread_mutex_lock(&aTable->lock);
+  aStatistics->trips = aTable->trips;
+  aStatistics->skipped = aTable->skipped;
+  aStatistics->open = 0;
+  uint32_t i;
+  for (i = 0; i < GFD_BREAKER_SLOTS; i++) {
+    const Breaker* breaker = &aTable->slots[i];
+    if (breaker->state != eBreakerFree &&
+        breaker->state != eBreakerClosed && aNow < breaker->until)
+      aStatistics->open++;
+  }
+  pthread_mutex_unlock(&aTable->lock);
+}
+
+}
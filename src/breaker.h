@@ -0,0 +1,73 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Circuit breakers, one per sender.
+ *
+ * An application that has stopped answering makes each of its events
+ * cost GFD_CALL_TIMEOUT, or the whole deadline, before anything else can
+ * be scanned. Once GFD_BREAKER_THRESHOLD events of a sender in a row have had
+ * a call time out, its breaker opens: its events are skipped for
+ * GFD_BREAKER_COOLDOWN milliseconds. The first event after that is let
+ * through as a probe; the breaker closes if it is answered and opens again
+ * at once if it isn't.
+ *
+ * Only senders with recent timeouts are remembered, in a table of
+ * GFD_BREAKER_SLOTS bus names; when it is full, the one that has been
+ * quiet the longest is forgotten first. It can be used from any thread.
+ */
+
+#ifndef GFD_BREAKER_H
+#define GFD_BREAKER_H
+
+#include <stdint.h>
+
+/* 0 never opens a breaker. */
+#ifndef GFD_BREAKER_THRESHOLD
+#define GFD_BREAKER_THRESHOLD 3
+#endif
+
+#ifndef GFD_BREAKER_COOLDOWN
+#define GFD_BREAKER_COOLDOWN (30 * 1000)
+#endif
+
+#ifndef GFD_BREAKER_SLOTS
+#define GFD_BREAKER_SLOTS 64
+#endif
+
+namespace gfd {
+
+typedef struct _BreakerTable BreakerTable;
+
+typedef struct _BreakerStatistics {
+  uint32_t trips;   /* times a breaker opened */
+  uint32_t skipped; /* events not let through */
+  uint32_t open;    /* breakers open now */
+} BreakerStatistics;
+
+BreakerTable* newBreakerTable();
+void freeBreakerTable(BreakerTable* aTable);
+
+/* Whether an event of aSender is to be scanned at aNow (in milliseconds of
+ * CLOCK_MONOTONIC). */
+bool admitSender(BreakerTable* aTable, const char* aSender, uint64_t aNow);
+
+/* Records how an event of aSender that was admitted went. */
+void reportSender(BreakerTable* aTable, const char* aSender, bool aTimedOut,
+                  uint64_t aNow);
+
+void getBreakerStatistics(BreakerTable* aTable, uint64_t aNow,
+                          BreakerStatistics* aStatistics);
+
+}
+
+#endif /* GFD_BREAKER_H */
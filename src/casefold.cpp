@@ -0,0 +1,249 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "casefold.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#define GFD_CASEFOLD_SSE2 1
+#include <emmintrin.h>
+#else
+#define GFD_CASEFOLD_SSE2 0
+#endif
+
+namespace gfd {
+
+static inline uint8_t fold(uint8_t aByte) {
+  return (aByte >= 'A' && aByte <= 'Z')? uint8_t(aByte + ('a' - 'A')) : aByte;
+}
+
+typedef struct _FoldRange {
+  uint32_t first;
+  uint32_t last;
+  int32_t delta;
+  bool alternate; /* only every other code point, from first */
+} FoldRange;
+
+/* kFoldDeltas, for the code points of two bytes, and kFoldRanges (sorted
+ * and disjoint) with kFoldBlocks, an index of them, for the others. */
+#include "casefoldtable.h"
+
+static const uint32_t kFoldRangeCount =
+  sizeof(kFoldRanges) / sizeof(kFoldRanges[0]);
+
+static uint32_t foldCodePoint(uint32_t aCodePoint) {
+  if (aCodePoint < GFD_FOLD_DENSE_END)
+    return uint32_t(int32_t(aCodePoint) + kFoldDeltas[aCodePoint - 0x80]);
+
+  /* CJK and most of the rest have no case. */
+  if (aCodePoint > kFoldRanges[kFoldRangeCount - 1].last)
+    return aCodePoint;
+
+  /* The first range that doesn't end before aCodePoint, looked for among
+     those of its block. */
+  const uint32_t block = aCodePoint >> GFD_FOLD_BLOCK_BITS;
+  uint32_t low = kFoldBlocks[block];
+  uint32_t high = (block + 1 < sizeof(kFoldBlocks))?
+                  kFoldBlocks[block + 1] + 1u : kFoldRangeCount;
+  while (low < high) {
+    uint32_t middle = (low + high) / 2;
+    if (kFoldRanges[middle].last < aCodePoint)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  const FoldRange* range = &kFoldRanges[low];
+  if (aCodePoint < range->first ||
+      (range->alternate && ((aCodePoint - range->first) & 1)))
+    return aCodePoint;
+  return uint32_t(int32_t(aCodePoint) + range->delta);
+}
+
+/* Decodes the sequence at aText; returns its length, or 0 if it isn't
+ * valid UTF-8. */
+static inline size_t decode(const uint8_t* aText, size_t aLength,
+                            uint32_t* aCodePoint) {
+  const uint8_t lead = aText[0];
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    if (aLength < 2 || (aText[1] & 0xc0) != 0x80)
+      return 0;
+    *aCodePoint = (uint32_t(lead & 0x1f) << 6) | (aText[1] & 0x3f);
+    return 2;
+  }
+  if (lead >= 0xe0 && lead <= 0xef) {
+    if (aLength < 3 || (aText[1] & 0xc0) != 0x80 ||
+        (aText[2] & 0xc0) != 0x80)
+      return 0;
+    uint32_t codePoint = (uint32_t(lead & 0x0f) << 12) |
+                         (uint32_t(aText[1] & 0x3f) << 6) | (aText[2] & 0x3f);
+    if (codePoint < 0x800 || (codePoint >= 0xd800 && codePoint <= 0xdfff))
+      return 0;
+    *aCodePoint = codePoint;
+    return 3;
+  }
+  if (lead >= 0xf0 && lead <= 0xf4) {
+    if (aLength < 4 || (aText[1] & 0xc0) != 0x80 ||
+        (aText[2] & 0xc0) != 0x80 || (aText[3] & 0xc0) != 0x80)
+      return 0;
+    uint32_t codePoint = (uint32_t(lead & 0x07) << 18) |
+                         (uint32_t(aText[1] & 0x3f) << 12) |
+                         (uint32_t(aText[2] & 0x3f) << 6) | (aText[3] & 0x3f);
+    if (codePoint < 0x10000 || codePoint > 0x10ffff)
+      return 0;
+    *aCodePoint = codePoint;
+    return 4;
+  }
+  return 0;
+}
+
+static inline size_t encode(uint32_t aCodePoint, uint8_t* aOut) {
+  if (aCodePoint < 0x80) {
+    aOut[0] = uint8_t(aCodePoint);
+    return 1;
+  }
+  if (aCodePoint < 0x800) {
+    aOut[0] = uint8_t(0xc0 | (aCodePoint >> 6));
+    aOut[1] = uint8_t(0x80 | (aCodePoint & 0x3f));
+    return 2;
+  }
+  if (aCodePoint < 0x10000) {
+    aOut[0] = uint8_t(0xe0 | (aCodePoint >> 12));
+    aOut[1] = uint8_t(0x80 | ((aCodePoint >> 6) & 0x3f));
+    aOut[2] = uint8_t(0x80 | (aCodePoint & 0x3f));
+    return 3;
+  }
+  aOut[0] = uint8_t(0xf0 | (aCodePoint >> 18));
+  aOut[1] = uint8_t(0x80 | ((aCodePoint >> 12) & 0x3f));
+  aOut[2] = uint8_t(0x80 | ((aCodePoint >> 6) & 0x3f));
+  aOut[3] = uint8_t(0x80 | (aCodePoint & 0x3f));
+  return 4;
+}
+
+#if GFD_CASEFOLD_SSE2
+
+static inline __m128i fold128(__m128i aBytes) {
+  /* Bytes >= 0x80 are negative as signed chars, so they never match. */
+  __m128i upper =
+    _mm_and_si128(_mm_cmpgt_epi8(aBytes, _mm_set1_epi8('A' - 1)),
+                  _mm_cmplt_epi8(aBytes, _mm_set1_epi8('Z' + 1)));
+  return _mm_or_si128(aBytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+#endif /* GFD_CASEFOLD_SSE2 */
+
+static bool isAscii(const uint8_t* aText, size_t aLength) {
+  size_t i = 0;
+#if GFD_CASEFOLD_SSE2
+  __m128i high = _mm_setzero_si128();
+  for (; i + 64 <= aLength; i += 64) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(aText + i);
+    high = _mm_or_si128(high,
+                        _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p),
+                                                  _mm_loadu_si128(p + 1)),
+                                     _mm_or_si128(_mm_loadu_si128(p + 2),
+                                                  _mm_loadu_si128(p + 3))));
+    if (_mm_movemask_epi8(high))
+      return false;
+  }
+  for (; i + 16 <= aLength; i += 16) {
+    high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aText + i));
+    if (_mm_movemask_epi8(high))
+      return false;
+  }
+#endif
+  uint8_t high8 = 0;
+  for (; i < aLength; i++)
+    high8 |= aText[i];
+  return !(high8 & 0x80);
+}
+
+size_t foldInto(char* aOut, const char* aText, size_t aLength) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(aText);
+  const uint8_t* end = in + aLength;
+  uint8_t* out = reinterpret_cast<uint8_t*>(aOut);
+
+  while (in < end) {
+#if GFD_CASEFOLD_SSE2
+    /* ASCII runs. Folding never lengthens the text, so out is never ahead
+       of in, and 16 bytes can be stored wherever 16 can be loaded. */
+    while (end - in >= 16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), fold128(bytes));
+      int high = _mm_movemask_epi8(bytes);
+      if (high) {
+        int ascii = __builtin_ctz(high);
+        in += ascii;
+        out += ascii;
+        break;
+      }
+      in += 16;
+      out += 16;
+    }
+    if (in == end)
+      break;
+#endif
+    if (*in < 0x80) {
+      *out++ = fold(*in++);
+      continue;
+    }
+
+    uint32_t codePoint;
+    size_t length = decode(in, end - in, &codePoint);
+    if (!length) {
+      *out++ = *in++;
+      continue;
+    }
+    uint32_t folded = foldCodePoint(codePoint);
+    if (folded == codePoint) {
+      memcpy(out, in, length);
+      out += length;
+    }
+    else {
+      out += encode(folded, out);
+    }
+    in += length;
+  }
+  return out - reinterpret_cast<uint8_t*>(aOut);
+}
+
+void clearFoldBuffer(FoldBuffer* aBuffer) {
+  free(aBuffer->data);
+  aBuffer->data = NULL;
+  aBuffer->capacity = 0;
+}
+
+const char* foldText(FoldBuffer* aBuffer, const char* aText, size_t aLength,
+                     size_t* aFoldedLength) {
+  *aFoldedLength = aLength;
+  if (isAscii(reinterpret_cast<const uint8_t*>(aText), aLength))
+    return aText;
+
+  if (aLength > aBuffer->capacity) {
+    size_t capacity = aBuffer->capacity? aBuffer->capacity : 4096;
+    while (capacity < aLength)
+      capacity *= 2;
+    char* data = static_cast<char*>(realloc(aBuffer->data, capacity));
+    if (!data)
+      return aText;
+    aBuffer->data = data;
+    aBuffer->capacity = capacity;
+  }
+
+  *aFoldedLength = foldInto(aBuffer->data, aText, aLength);
+  return aBuffer->data;
+}
+
+}
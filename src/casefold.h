@@ -0,0 +1,55 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Case folding of UTF-8 text.
+ *
+ * Keywords and page text are compared after folding both, once: the
+ * matchers then compare bytes. Folding is Unicode simple case folding
+ * (CaseFolding.txt, statuses C and S; the table is generated by
+ * mkcasefold.py), except for U+023A and U+023E, whose folding is longer in
+ * UTF-8. The Turkish dotted I, which has no simple folding, and invalid
+ * UTF-8 are left as is. A folded text is never longer than the original.
+ *
+ * Pure ASCII is the common case: it is checked and folded 16 bytes at a
+ * time, and the matchers fold ASCII letters on their own anyway, so
+ * foldText() hands pure ASCII text back untouched, without copying it.
+ */
+
+#ifndef GFD_CASEFOLD_H
+#define GFD_CASEFOLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfd {
+
+typedef struct _FoldBuffer {
+  char* data;
+  size_t capacity;
+} FoldBuffer;
+
+void clearFoldBuffer(FoldBuffer* aBuffer);
+
+/* Folds aLength bytes of aText into aOut, which must have room for as many.
+ * Returns the folded length. */
+size_t foldInto(char* aOut, const char* aText, size_t aLength);
+
+/* Returns aText folded in aBuffer (grown as needed), and its length in
+ * *aFoldedLength; or aText itself if it is pure ASCII, or if aBuffer can't
+ * grow. */
+const char* foldText(FoldBuffer* aBuffer, const char* aText, size_t aLength,
+                     size_t* aFoldedLength);
+
+}
+
+#endif /* GFD_CASEFOLD_H */
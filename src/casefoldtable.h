@@ -0,0 +1,375 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Generated by mkcasefold.py from CaseFolding-14.0.0.txt; do not edit.
+ * Left out, folding to longer UTF-8: U+023A, U+023E. */
+
+#define GFD_FOLD_DENSE_END 0x0800
+
+static const int16_t kFoldDeltas[] = {
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,  775,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,   32,   32,   32,   32,   32,   32,   32,   32,
+    32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+    32,   32,   32,    0,   32,   32,   32,   32,   32,   32,   32,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    0,    0,    1,    0,
+     1,    0,    1,    0,    0,    1,    0,    1,    0,    1,    0,    1,
+     0,    1,    0,    1,    0,    1,    0,    1,    0,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0, -121,    1,    0,    1,
+     0,    1,    0, -268,    0,  210,    1,    0,    1,    0,  206,    1,
+     0,  205,  205,    1,    0,    0,   79,  202,  203,    1,    0,  205,
+   207,    0,  211,  209,    1,    0,    0,    0,  211,  213,    0,  214,
+     1,    0,    1,    0,    1,    0,  218,    1,    0,  218,    0,    0,
+     1,    0,  218,    1,    0,  217,  217,    1,    0,    1,    0,  219,
+     1,    0,    0,    0,    1,    0,    0,    0,    0,    0,    0,    0,
+     2,    1,    0,    2,    1,    0,    2,    1,    0,    1,    0,    1,
+     0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,
+     0,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    0,    2,    1,    0,
+     1,    0,  -97,  -56,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0, -130,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    0,    0,    0,    0,    0,    0,    0,    1,
+     0, -163,    0,    0,    0,    1,    0, -195,   69,   71,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,  116,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    1,    0,    1,    0,
+     0,    0,    1,    0,    0,    0,    0,    0,    0,    0,    0,  116,
+     0,    0,    0,    0,    0,    0,   38,    0,   37,   37,   37,    0,
+    64,    0,   63,   63,    0,   32,   32,   32,   32,   32,   32,   32,
+    32,   32,   32,   32,   32,   32,   32,   32,   32,   32,    0,   32,
+    32,   32,   32,   32,   32,   32,   32,   32,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    1,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    8,  -30,  -25,    0,    0,
+     0,  -15,  -22,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,  -54,  -48,    0,    0,  -60,  -64,    0,    1,
+     0,   -7,    1,    0,    0, -130, -130, -130,   80,   80,   80,   80,
+    80,   80,   80,   80,   80,   80,   80,   80,   80,   80,   80,   80,
+    32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+    32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+    32,   32,   32,   32,   32,   32,   32,   32,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,   15,    1,    0,    1,
+     0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+     0,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,
+    48,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,
+    48,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,   48,
+    48,   48,   48,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+};
+
+static const FoldRange kFoldRanges[] = {
+  { 0x10a0, 0x10c5, 7264, false },
+  { 0x10c7, 0x10c7, 7264, false },
+  { 0x10cd, 0x10cd, 7264, false },
+  { 0x13f8, 0x13fd, -8, false },
+  { 0x1c80, 0x1c80, -6222, false },
+  { 0x1c81, 0x1c81, -6221, false },
+  { 0x1c82, 0x1c82, -6212, false },
+  { 0x1c83, 0x1c84, -6210, false },
+  { 0x1c85, 0x1c85, -6211, false },
+  { 0x1c86, 0x1c86, -6204, false },
+  { 0x1c87, 0x1c87, -6180, false },
+  { 0x1c88, 0x1c88, 35267, false },
+  { 0x1c90, 0x1cba, -3008, false },
+  { 0x1cbd, 0x1cbf, -3008, false },
+  { 0x1e00, 0x1e94, 1, true },
+  { 0x1e9b, 0x1e9b, -58, false },
+  { 0x1e9e, 0x1e9e, -7615, false },
+  { 0x1ea0, 0x1efe, 1, true },
+  { 0x1f08, 0x1f0f, -8, false },
+  { 0x1f18, 0x1f1d, -8, false },
+  { 0x1f28, 0x1f2f, -8, false },
+  { 0x1f38, 0x1f3f, -8, false },
+  { 0x1f48, 0x1f4d, -8, false },
+  { 0x1f59, 0x1f5f, -8, true },
+  { 0x1f68, 0x1f6f, -8, false },
+  { 0x1f88, 0x1f8f, -8, false },
+  { 0x1f98, 0x1f9f, -8, false },
+  { 0x1fa8, 0x1faf, -8, false },
+  { 0x1fb8, 0x1fb9, -8, false },
+  { 0x1fba, 0x1fbb, -74, false },
+  { 0x1fbc, 0x1fbc, -9, false },
+  { 0x1fbe, 0x1fbe, -7173, false },
+  { 0x1fc8, 0x1fcb, -86, false },
+  { 0x1fcc, 0x1fcc, -9, false },
+  { 0x1fd8, 0x1fd9, -8, false },
+  { 0x1fda, 0x1fdb, -100, false },
+  { 0x1fe8, 0x1fe9, -8, false },
+  { 0x1fea, 0x1feb, -112, false },
+  { 0x1fec, 0x1fec, -7, false },
+  { 0x1ff8, 0x1ff9, -128, false },
+  { 0x1ffa, 0x1ffb, -126, false },
+  { 0x1ffc, 0x1ffc, -9, false },
+  { 0x2126, 0x2126, -7517, false },
+  { 0x212a, 0x212a, -8383, false },
+  { 0x212b, 0x212b, -8262, false },
+  { 0x2132, 0x2132, 28, false },
+  { 0x2160, 0x216f, 16, false },
+  { 0x2183, 0x2183, 1, false },
+  { 0x24b6, 0x24cf, 26, false },
+  { 0x2c00, 0x2c2f, 48, false },
+  { 0x2c60, 0x2c60, 1, false },
+  { 0x2c62, 0x2c62, -10743, false },
+  { 0x2c63, 0x2c63, -3814, false },
+  { 0x2c64, 0x2c64, -10727, false },
+  { 0x2c67, 0x2c6b, 1, true },
+  { 0x2c6d, 0x2c6d, -10780, false },
+  { 0x2c6e, 0x2c6e, -10749, false },
+  { 0x2c6f, 0x2c6f, -10783, false },
+  { 0x2c70, 0x2c70, -10782, false },
+  { 0x2c72, 0x2c72, 1, false },
+  { 0x2c75, 0x2c75, 1, false },
+  { 0x2c7e, 0x2c7f, -10815, false },
+  { 0x2c80, 0x2ce2, 1, true },
+  { 0x2ceb, 0x2ced, 1, true },
+  { 0x2cf2, 0x2cf2, 1, false },
+  { 0xa640, 0xa66c, 1, true },
+  { 0xa680, 0xa69a, 1, true },
+  { 0xa722, 0xa72e, 1, true },
+  { 0xa732, 0xa76e, 1, true },
+  { 0xa779, 0xa77b, 1, true },
+  { 0xa77d, 0xa77d, -35332, false },
+  { 0xa77e, 0xa786, 1, true },
+  { 0xa78b, 0xa78b, 1, false },
+  { 0xa78d, 0xa78d, -42280, false },
+  { 0xa790, 0xa792, 1, true },
+  { 0xa796, 0xa7a8, 1, true },
+  { 0xa7aa, 0xa7aa, -42308, false },
+  { 0xa7ab, 0xa7ab, -42319, false },
+  { 0xa7ac, 0xa7ac, -42315, false },
+  { 0xa7ad, 0xa7ad, -42305, false },
+  { 0xa7ae, 0xa7ae, -42308, false },
+  { 0xa7b0, 0xa7b0, -42258, false },
+  { 0xa7b1, 0xa7b1, -42282, false },
+  { 0xa7b2, 0xa7b2, -42261, false },
+  { 0xa7b3, 0xa7b3, 928, false },
+  { 0xa7b4, 0xa7c2, 1, true },
+  { 0xa7c4, 0xa7c4, -48, false },
+  { 0xa7c5, 0xa7c5, -42307, false },
+  { 0xa7c6, 0xa7c6, -35384, false },
+  { 0xa7c7, 0xa7c9, 1, true },
+  { 0xa7d0, 0xa7d0, 1, false },
+  { 0xa7d6, 0xa7d8, 1, true },
+  { 0xa7f5, 0xa7f5, 1, false },
+  { 0xab70, 0xabbf, -38864, false },
+  { 0xff21, 0xff3a, 32, false },
+  { 0x10400, 0x10427, 40, false },
+  { 0x104b0, 0x104d3, 40, false },
+  { 0x10570, 0x1057a, 39, false },
+  { 0x1057c, 0x1058a, 39, false },
+  { 0x1058c, 0x10592, 39, false },
+  { 0x10594, 0x10595, 39, false },
+  { 0x10c80, 0x10cb2, 64, false },
+  { 0x118a0, 0x118bf, 32, false },
+  { 0x16e40, 0x16e5f, 32, false },
+  { 0x1e900, 0x1e921, 34, false }
+};
+
+#define GFD_FOLD_BLOCK_BITS 7
+
+static const uint8_t kFoldBlocks[] = {
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   3,   3,
+    3,   3,   3,   3,   4,   4,   4,   4,   4,   4,   4,   4,
+    4,   4,   4,   4,   4,   4,   4,   4,   4,   4,  14,  14,
+   14,  14,  18,  25,  42,  42,  42,  47,  48,  48,  48,  48,
+   48,  48,  49,  49,  49,  49,  49,  49,  49,  49,  49,  49,
+   49,  49,  49,  49,  49,  62,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,  65,
+   65,  65,  65,  65,  65,  65,  65,  65,  65,  66,  67,  71,
+   93,  93,  93,  93,  93,  93,  93,  93,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,  94,
+   94,  94,  94,  94,  94,  94,  94,  95,  95,  95,  95,  95,
+   95,  95,  95,  95,  95,  96,  97,  98, 101, 101, 101, 101,
+  101, 101, 101, 101, 101, 101, 101, 101, 101, 101, 102, 102,
+  102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+  102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+  103, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+  104, 104, 104, 104, 104, 104, 104
+};
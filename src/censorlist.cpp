@@ -0,0 +1,433 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "censorlist.h"
+
+#include "hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace gfd {
+
+/* A hazard pointer per cache line, so that readers don't share lines. */
+typedef struct _Hazard {
+  const CensorList* list;
+  char padding[64 - sizeof(const CensorList*)];
+} Hazard;
+
+static Hazard sHazards[GFD_CENSOR_LIST_READERS] __attribute__((aligned(64)));
+static CensorList* sCurrent(NULL);
+static uint32_t sGeneration(0);
+
+static const char* sFilename(NULL);
+static const char* sImage(NULL);    /* or NULL */
+static const char* sSkipList(NULL); /* or NULL */
+static const char* const* sExtra(NULL);
+static uint32_t sExtraCount(0);
+
+/* Owned by the loader thread once it runs. */
+static CensorList* sRetired(NULL);
+static char* sDirectory(NULL);
+static const char* sBasename(NULL);
+static const char* sImageBasename(NULL);
+static const char* sSkipBasename(NULL);
+static int sInotifyFd(-1);
+static int sStopFd(-1);
+static bool sWatching(false);
+static pthread_t sLoader;
+
+static void freeList(CensorList* aList) {
+  delete aList->matcher;
+  freeSkipList(aList->skip);
+  free(aList->keywords);
+  free(aList->text);
+  delete aList;
+}
+
+/* Returns the contents of aFilename, NUL-terminated; "" if the file does
+ * not exist. */
+static char* readFile(const char* aFilename) {
+  FILE* fp = fopen(aFilename, "rb");
+  if (!fp)
+    return (errno == ENOENT)? strdup("") : NULL;
+
+  char* text(NULL);
+  long size = -1;
+  if (0 == fseek(fp, 0, SEEK_END))
+    size = ftell(fp);
+  if (size >= 0) {
+    rewind(fp);
+    text = static_cast<char*>(malloc(size + 1));
+  }
+  if (text) {
+    size_t read = fread(text, 1, size, fp);
+    text[read] = '\0';
+    if (size_t(size) != read) {
+      free(text);
+      text = NULL;
+    }
+  }
+  if (!text)
+    perror(aFilename);
+  fclose(fp);
+  return text;
+}
+
+static const char* baseName(const char* aFilename) {
+  const char* name = strrchr(aFilename, '/');
+  return name? name + 1 : aFilename;
+}
+
+/* Keeps the generation of the current list if the keywords are the same,
+ * so that what has been found with them stays valid when only the skip list
+ * has changed. */
+static uint32_t generationOf(const CensorList* aList) {
+  const CensorList* current = __atomic_load_n(&sCurrent, __ATOMIC_ACQUIRE);
+  if (current && current->sourceHash == aList->sourceHash)
+    return current->generation;
+  return __atomic_add_fetch(&sGeneration, 1, __ATOMIC_RELAXED);
+}
+
+/* The keywords are in the order the daemon has always used: the command
+ * line backwards, then the file backwards. */
+static CensorList* newList(bool aMapImage) {
+  CensorList* list = new CensorList();
+  memset(list, 0, sizeof(CensorList));
+
+  if (sSkipList) {
+    char* text = readFile(sSkipList);
+    if (text)
+      list->skip = newSkipList(text);
+    free(text);
+    if (!list->skip) {
+      delete list;
+      return NULL;
+    }
+  }
+
+  list->text = readFile(sFilename);
+  if (!list->text) {
+    freeList(list);
+    return NULL;
+  }
+
+  /* Hashing the text is much cheaper than splitting it, let alone
+     compiling it. */
+  list->sourceHash = hash64(list->text, strlen(list->text));
+  uint32_t i;
+  for (i = 0; i < sExtraCount; i++) {
+    if (*sExtra[i])
+      list->sourceHash = hash64(sExtra[i], strlen(sExtra[i]) + 1,
+                                list->sourceHash);
+  }
+
+  if (aMapImage && sImage) {
+    list->matcher = Matcher::map(sImage, list->sourceHash);
+    if (list->matcher) {
+      free(list->text);
+      list->text = NULL;
+      list->generation = generationOf(list);
+      return list;
+    }
+  }
+
+  uint32_t lines = 0;
+  const char* c;
+  for (c = list->text; *c; c++)
+    lines += (*c == '\n');
+  list->keywords = static_cast<const char**>(
+    malloc(sizeof(const char*) * (sExtraCount + lines + 1)));
+  if (!list->keywords) {
+    freeList(list);
+    return NULL;
+  }
+
+  uint32_t count = 0;
+  for (i = sExtraCount; i > 0; i--) {
+    if (*sExtra[i - 1])
+      list->keywords[count++] = sExtra[i - 1];
+  }
+
+  const uint32_t fileStart = count;
+  char* next;
+  const char* line = strtok_r(list->text, "\n", &next);
+  while (line) {
+    list->keywords[count++] = line;
+    line = strtok_r(NULL, "\n", &next);
+  }
+  for (i = 0; i < (count - fileStart) / 2; i++) {
+    const char* keyword = list->keywords[fileStart + i];
+    list->keywords[fileStart + i] = list->keywords[count - 1 - i];
+    list->keywords[count - 1 - i] = keyword;
+  }
+
+  if (count) {
+    list->matcher = Matcher::compile(list->keywords, count);
+    if (!list->matcher) {
+      freeList(list);
+      return NULL;
+    }
+  }
+  list->generation = generationOf(list);
+  return list;
+}
+
+static bool inUse(const CensorList* aList) {
+  uint32_t i;
+  for (i = 0; i < GFD_CENSOR_LIST_READERS; i++) {
+    if (__atomic_load_n(&sHazards[i].list, __ATOMIC_SEQ_CST) == aList)
+      return true;
+  }
+  return false;
+}
+
+/* Frees the replaced lists that no reader refers to any more. A reader that
+ * acquires a list after it has been replaced sees the new pointer when it
+ * checks, so it can't pick up a retired list again. */
+static void reclaim() {
+  CensorList** link = &sRetired;
+  while (*link) {
+    CensorList* list = *link;
+    if (inUse(list)) {
+      link = &list->next;
+      continue;
+    }
+    *link = list->next;
+    freeList(list);
+  }
+}
+
+static void reload() {
+  CensorList* list = newList(true);
+  if (!list) {
+    fprintf(stderr, "%s: keeping the previous keywords\n", sFilename);
+    return;
+  }
+
+  CensorList* old = __atomic_exchange_n(&sCurrent, list, __ATOMIC_SEQ_CST);
+  old->next = sRetired;
+  sRetired = old;
+  fprintf(stderr, "%s: reloaded, %u keywords, %u sites skipped\n",
+          sFilename, list->matcher? list->matcher->count() : 0,
+          list->skip? skipListCount(list->skip) : 0);
+}
+
+/* Drains the inotify queue. Returns true if one of the files was among the
+ * names. */
+static bool fileChanged() {
+  bool changed = false;
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t length = read(sInotifyFd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      if (length < 0 && errno == EINTR)
+        continue;
+      break;
+    }
+
+    const char* event = buffer;
+    while (event < buffer + length) {
+      const struct inotify_event* notification =
+        reinterpret_cast<const struct inotify_event*>(event);
+      if (notification->len &&
+          (0 == strcmp(notification->name, sBasename) ||
+           (sImageBasename &&
+            0 == strcmp(notification->name, sImageBasename)) ||
+           (sSkipBasename &&
+            0 == strcmp(notification->name, sSkipBasename))))
+        changed = true;
+      event += sizeof(struct inotify_event) + notification->len;
+    }
+  }
+  return changed;
+}
+
+static void* loaderMain(void*) {
+  for (;;) {
+    struct pollfd fds[2];
+    fds[0].fd = sInotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = sStopFd;
+    fds[1].events = POLLIN;
+    int ready = poll(fds, 2, sRetired? GFD_CENSOR_LIST_RECLAIM_INTERVAL : -1);
+    if (ready < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
+      break;
+    }
+    if (fds[1].revents)
+      break;
+
+    if ((fds[0].revents & POLLIN) && fileChanged())
+      reload();
+    reclaim();
+  }
+  return NULL;
+}
+
+static void startWatching() {
+  sDirectory = strdup(sFilename);
+  if (!sDirectory)
+    return;
+  /* The image and the skip list are expected next to the list. dirname()
+     may modify its argument. */
+  sBasename = baseName(sFilename);
+  sImageBasename = sImage? baseName(sImage) : NULL;
+  sSkipBasename = sSkipList? baseName(sSkipList) : NULL;
+  const char* directory = dirname(sDirectory);
+
+  sInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (sInotifyFd < 0) {
+    perror("inotify_init1");
+    return;
+  }
+  if (inotify_add_watch(sInotifyFd, directory,
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                        IN_DELETE) < 0) {
+    perror(directory);
+    return;
+  }
+
+  sStopFd = eventfd(0, EFD_CLOEXEC);
+  if (sStopFd < 0) {
+    perror("eventfd");
+    return;
+  }
+  sWatching = (0 == pthread_create(&sLoader, NULL, loaderMain, NULL));
+}
+
+bool startCensorList(const char* aFilename, const char* aImage,
+                     const char* aSkipList,
+                     const char* const* aExtra, uint32_t aExtraCount) {
+  sFilename = aFilename;
+  sImage = aImage;
+  sSkipList = aSkipList;
+  sExtra = aExtra;
+  sExtraCount = aExtraCount;
+
+  sCurrent = newList(true);
+  if (!sCurrent)
+    return false;
+
+  startWatching();
+  return true;
+}
+
+void stopCensorList() {
+  if (sWatching) {
+    uint64_t one = 1;
+    if (write(sStopFd, &one, sizeof(one)) < 0)
+      perror("eventfd");
+    pthread_join(sLoader, NULL);
+    sWatching = false;
+  }
+  if (sStopFd >= 0)
+    close(sStopFd);
+  if (sInotifyFd >= 0)
+    close(sInotifyFd);
+  sStopFd = sInotifyFd = -1;
+  free(sDirectory);
+  sDirectory = NULL;
+
+  while (sRetired) {
+    CensorList* list = sRetired;
+    sRetired = list->next;
+    freeList(list);
+  }
+  if (sCurrent)
+    freeList(sCurrent);
+  sCurrent = NULL;
+}
+
+const CensorList* acquireCensorList(uint32_t aReader) {
+  Hazard* hazard = &sHazards[aReader];
+  const CensorList* list = __atomic_load_n(&sCurrent, __ATOMIC_SEQ_CST);
+  for (;;) {
+    __atomic_store_n(&hazard->list, list, __ATOMIC_SEQ_CST);
+    const CensorList* current = __atomic_load_n(&sCurrent, __ATOMIC_SEQ_CST);
+    if (current == list)
+      return list;
+    list = current;
+  }
+}
+
+void releaseCensorList(uint32_t aReader) {
+  __atomic_store_n(&sHazards[aReader].list, NULL, __ATOMIC_RELEASE);
+}
+
+bool compileCensorList(const char* aFilename, const char* aImage,
+                       const char* const* aExtra, uint32_t aExtraCount) {
+  sFilename = aFilename;
+  sImage = NULL;
+  sSkipList = NULL;
+  sExtra = aExtra;
+  sExtraCount = aExtraCount;
+
+  CensorList* list = newList(false);
+  if (!list)
+    return false;
+  if (!list->matcher) {
+    fprintf(stderr, "%s: no keywords\n", aFilename);
+    freeList(list);
+    return false;
+  }
+
+  size_t length = strlen(aImage);
+  char* temporary = static_cast<char*>(malloc(length + sizeof(".tmp")));
+  if (!temporary) {
+    freeList(list);
+    return false;
+  }
+  memcpy(temporary, aImage, length);
+  memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+  bool succeeded = false;
+  int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(temporary);
+  }
+  else {
+    /* save() doesn't always leave errno set (it may fail to allocate). */
+    succeeded = list->matcher->save(fd, list->sourceHash);
+    if (!succeeded)
+      fprintf(stderr, "%s: failed to write the image\n", temporary);
+    if (0 != close(fd)) {
+      if (succeeded)
+        perror(temporary);
+      succeeded = false;
+    }
+    if (succeeded && 0 != rename(temporary, aImage)) {
+      perror(aImage);
+      succeeded = false;
+    }
+    if (!succeeded)
+      unlink(temporary);
+  }
+
+  free(temporary);
+  freeList(list);
+  return succeeded;
+}
+
+}
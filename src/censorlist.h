@@ -0,0 +1,92 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* The censor list, reloaded whenever its file changes.
+ *
+ * The keywords are read from the list file, one per line, and from the
+ * command line, and compiled into a Matcher. If an image of the same
+ * keywords compiled by gfd-compile-list sits next to the list, it is mapped
+ * instead, so that even a huge list is ready at once; a stale image is
+ * ignored. The skip list (see skiplist.h), also next to it, comes with the
+ * keywords. A thread of its own watches the directory of the files with
+ * inotify; when any of them is written, moved into place or removed, it
+ * builds a new list and publishes it with an atomic pointer swap.
+ *
+ * Readers never wait for a reload: acquireCensorList() announces the list
+ * it is going to use in a hazard pointer of its own, and a list that has
+ * been replaced is freed only once no hazard pointer refers to it. A reader
+ * keeps the list it acquired, e.g. for a whole event, until it calls
+ * releaseCensorList().
+ */
+
+#ifndef GFD_CENSORLIST_H
+#define GFD_CENSORLIST_H
+
+#include <stdint.h>
+
+#include "matcher.h"
+#include "skiplist.h"
+#include "workers.h"
+
+/* One per worker. */
+#ifndef GFD_CENSOR_LIST_READERS
+#define GFD_CENSOR_LIST_READERS GFD_WORKER_COUNT_MAX
+#endif
+
+/* How often (in milliseconds) replaced lists that are still in use are
+ * checked again. */
+#ifndef GFD_CENSOR_LIST_RECLAIM_INTERVAL
+#define GFD_CENSOR_LIST_RECLAIM_INTERVAL 100
+#endif
+
+namespace gfd {
+
+typedef struct _CensorList {
+  Matcher* matcher;    /* NULL: no keyword */
+  SkipList* skip;      /* NULL: nothing is skipped */
+  uint32_t generation; /* never the same for two sets of keywords */
+
+  /* private */
+  uint64_t sourceHash; /* of the file and the extra keywords */
+  char* text;          /* of the file; the keywords point into it */
+  const char** keywords;
+  _CensorList* next;   /* replaced lists */
+} CensorList;
+
+/* Loads aFilename (which need not exist) and aExtra, or maps aImage (which
+ * need not exist either) if it holds the same keywords, loads aSkipList
+ * (nor does it; NULL for none), and starts watching the files. The
+ * arguments must outlive the list. Returns false if the keywords can't be
+ * read or compiled. */
+bool startCensorList(const char* aFilename, const char* aImage,
+                     const char* aSkipList,
+                     const char* const* aExtra, uint32_t aExtraCount);
+
+/* Stops watching and frees every list. There must be no reader left. */
+void stopCensorList();
+
+/* Returns the current list, which stays valid until releaseCensorList() is
+ * called with the same aReader (0 <= aReader < GFD_CENSOR_LIST_READERS). A
+ * reader is used by one thread at a time. */
+const CensorList* acquireCensorList(uint32_t aReader);
+void releaseCensorList(uint32_t aReader);
+
+/* Compiles aFilename and aExtra, as startCensorList() would, into an image
+ * at aImage. The image is replaced atomically, so that daemons that have
+ * mapped the previous one are not disturbed. */
+bool compileCensorList(const char* aFilename, const char* aImage,
+                       const char* const* aExtra, uint32_t aExtraCount);
+
+}
+
+#endif /* GFD_CENSORLIST_H */
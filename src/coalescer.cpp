@@ -0,0 +1,370 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "coalescer.h"
+
+#include "greatfd.h"
+#include "metrics.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace gfd {
+
+struct _Burst;
+
+typedef struct _HeldEvent {
+  DBusMessage* event;
+  const char* path;    /* of event */
+  bool nested;
+
+  /* While its burst is being resolved: the Parent call in flight. */
+  _Burst* burst;
+  DBusPendingCall* pending;
+  uint64_t sent;       /* metricsClock() */
+  uint32_t depth;      /* ancestors asked for so far */
+
+  _HeldEvent* next;
+} HeldEvent;
+
+/* The burst of one sender. */
+typedef struct _Burst {
+  Coalescer* coalescer;
+  char* sender;
+  uint64_t first;      /* CLOCK_MONOTONIC, in milliseconds */
+  uint64_t last;
+  HeldEvent* events;   /* in the order they arrived */
+  HeldEvent** tail;
+  uint32_t count;
+
+  uint64_t deadline;   /* of the Parent calls, see eventDeadline() */
+  uint32_t pending;    /* Parent calls in flight */
+
+  _Burst* next;
+} Burst;
+
+struct _Coalescer {
+  EventLoop* loop;
+  DBusConnection* connection;
+  EventSink sink;
+  void* closure;
+  CoalescerStatistics* statistics;
+
+  EventTimer* timer;
+  Burst* bursts;
+  Burst* resolving;    /* due, waiting for Parent replies */
+};
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+static inline uint64_t dueTime(const Burst* aBurst) {
+  uint64_t quiet = aBurst->last + GFD_COALESCE_WINDOW;
+  uint64_t latest = aBurst->first + GFD_COALESCE_MAX_DELAY;
+  return (quiet < latest)? quiet : latest;
+}
+
+static void freeBurst(Burst* aBurst) {
+  while (aBurst->events) {
+    HeldEvent* held = aBurst->events;
+    aBurst->events = held->next;
+    if (held->pending) {
+      dbus_pending_call_cancel(held->pending);
+      dbus_pending_call_unref(held->pending);
+    }
+    dbus_message_unref(held->event);
+    delete held;
+  }
+  free(aBurst->sender);
+  delete aBurst;
+}
+
+static HeldEvent* findHeld(Burst* aBurst, const char* aPath) {
+  HeldEvent* held;
+  for (held = aBurst->events; held; held = held->next) {
+    if (0 == strcmp(held->path, aPath))
+      return held;
+  }
+  return NULL;
+}
+
+static void passBurst(Coalescer* aCoalescer, Burst* aBurst) {
+  HeldEvent* held;
+  for (held = aBurst->events; held; held = held->next) {
+    if (held->nested) {
+      aCoalescer->statistics->nested++;
+      continue;
+    }
+    aCoalescer->statistics->passed++;
+    aCoalescer->sink(held->event, aCoalescer->closure);
+  }
+  freeBurst(aBurst);
+}
+
+/* Whether a burst of aSender is waiting for Parent replies; the next one
+ * of the same sender waits for it, so that signals are passed on in the
+ * order they came. */
+static bool isResolving(const Coalescer* aCoalescer, const char* aSender) {
+  const Burst* burst;
+  for (burst = aCoalescer->resolving; burst; burst = burst->next) {
+    if (0 == strcmp(burst->sender, aSender))
+      return true;
+  }
+  return false;
+}
+
+static void passDueBursts(void* aCoalescer);
+static void parentArrived(DBusPendingCall* aPending, void* aHeld);
+
+/* Sends the Parent call about aPath for aHeld, without waiting. */
+static bool askParent(HeldEvent* aHeld, const char* aPath) {
+  Burst* burst = aHeld->burst;
+  Coalescer* coalescer = burst->coalescer;
+  DBusMessage* method = newGetParent(burst->sender, aPath);
+  if (!method)
+    return false;
+
+  DBusPendingCall* pending(NULL);
+  bool sent = dbus_connection_send_with_reply(coalescer->connection, method,
+                                              &pending,
+                                              callTimeout(burst->deadline));
+  dbus_message_unref(method);
+  if (!sent || !pending)
+    return false;
+
+  aHeld->pending = pending;
+  aHeld->sent = metricsClock();
+  burst->pending++;
+  if (!dbus_pending_call_set_notify(pending, parentArrived, aHeld, NULL)) {
+    dbus_pending_call_cancel(pending);
+    dbus_pending_call_unref(pending);
+    aHeld->pending = NULL;
+    burst->pending--;
+    return false;
+  }
+  coalescer->statistics->roundTrips++;
+  return true;
+}
+
+/* Passes a resolved burst on, then whatever waited for it. */
+static void finishResolving(Coalescer* aCoalescer, Burst* aBurst) {
+  Burst** link = &aCoalescer->resolving;
+  while (*link != aBurst)
+    link = &(*link)->next;
+  *link = aBurst->next;
+
+  passBurst(aCoalescer, aBurst);
+  passDueBursts(aCoalescer);
+}
+
+/* One more ancestor of a held document: if it is held too, the document is
+ * nested; otherwise its parent is asked for in turn. A document whose
+ * ancestors can't be found out (no reply in time, another application, the
+ * root) is not nested. */
+static void parentArrived(DBusPendingCall* aPending, void* aHeld) {
+  HeldEvent* held = static_cast<HeldEvent*>(aHeld);
+  Burst* burst = held->burst;
+  recordValue(eHistogramGetParent, metricsClock() - held->sent);
+
+  DBusMessage* reply = dbus_pending_call_steal_reply(aPending);
+  dbus_pending_call_unref(held->pending);
+  held->pending = NULL;
+  burst->pending--;
+  held->depth++;
+
+  char* parentSender(NULL);
+  char* parentPath(NULL);
+  if (reply && readParent(reply, &parentSender, &parentPath)) {
+    if (0 == strcmp(parentSender, burst->sender)) {
+      HeldEvent* ancestor = findHeld(burst, parentPath);
+      if (ancestor && ancestor != held)
+        held->nested = true;
+      else if (held->depth < GFD_COALESCE_MAX_DEPTH)
+        askParent(held, parentPath);
+    }
+    free(parentSender);
+    free(parentPath);
+  }
+  if (reply)
+    dbus_message_unref(reply);
+
+  if (!burst->pending)
+    finishResolving(burst->coalescer, burst);
+}
+
+/* Passes a due burst on. One with more than one path first has its
+ * documents' ancestors asked for, all of them at once, and is passed on
+ * from parentArrived() once the last reply is in. */
+static void resolveBurst(Coalescer* aCoalescer, Burst* aBurst) {
+  if (aBurst->count < 2) {
+    passBurst(aCoalescer, aBurst);
+    return;
+  }
+
+  aBurst->coalescer = aCoalescer;
+  aBurst->deadline = eventDeadline();
+  aBurst->next = aCoalescer->resolving;
+  aCoalescer->resolving = aBurst;
+
+  HeldEvent* held;
+  for (held = aBurst->events; held; held = held->next) {
+    held->burst = aBurst;
+    askParent(held, held->path);
+  }
+  if (!aBurst->pending)
+    finishResolving(aCoalescer, aBurst);
+}
+
+/* Has the timer fire when the next burst is due. */
+static void schedule(Coalescer* aCoalescer) {
+  if (!aCoalescer->bursts) {
+    setTimer(aCoalescer->timer, -1);
+    return;
+  }
+
+  /* Bursts waiting for another one of their sender are left to
+     finishResolving(). */
+  uint64_t due = UINT64_MAX;
+  Burst* burst;
+  for (burst = aCoalescer->bursts; burst; burst = burst->next) {
+    if (dueTime(burst) < due && !isResolving(aCoalescer, burst->sender))
+      due = dueTime(burst);
+  }
+  if (due == UINT64_MAX) {
+    setTimer(aCoalescer->timer, -1);
+    return;
+  }
+  uint64_t time = now();
+  setTimer(aCoalescer->timer, (due > time)? int(due - time) : 0);
+}
+
+static void passDueBursts(void* aCoalescer) {
+  Coalescer* coalescer = static_cast<Coalescer*>(aCoalescer);
+  const uint64_t time = now();
+
+  /* The sink may block for a while; bursts that become due meanwhile wait
+     for the next round. */
+  Burst* due(NULL);
+  Burst** link = &coalescer->bursts;
+  while (*link) {
+    Burst* burst = *link;
+    if (dueTime(burst) <= time && !isResolving(coalescer, burst->sender)) {
+      *link = burst->next;
+      burst->next = due;
+      due = burst;
+    }
+    else {
+      link = &burst->next;
+    }
+  }
+
+  while (due) {
+    Burst* burst = due;
+    due = burst->next;
+    resolveBurst(coalescer, burst);
+  }
+  schedule(coalescer);
+}
+
+Coalescer* newCoalescer(EventLoop* aLoop, DBusConnection* aConnection,
+                        EventSink aSink, void* aClosure,
+                        CoalescerStatistics* aStatistics) {
+  Coalescer* coalescer = new Coalescer();
+  memset(coalescer, 0, sizeof(Coalescer));
+  coalescer->loop = aLoop;
+  coalescer->connection = aConnection;
+  coalescer->sink = aSink;
+  coalescer->closure = aClosure;
+  coalescer->statistics = aStatistics;
+  coalescer->timer = addTimer(aLoop, GFD_COALESCE_WINDOW, passDueBursts,
+                              coalescer);
+  setTimer(coalescer->timer, -1);
+  return coalescer;
+}
+
+void freeCoalescer(Coalescer* aCoalescer) {
+  if (!aCoalescer)
+    return;
+
+  while (aCoalescer->bursts) {
+    Burst* burst = aCoalescer->bursts;
+    aCoalescer->bursts = burst->next;
+    freeBurst(burst);
+  }
+  while (aCoalescer->resolving) {
+    Burst* burst = aCoalescer->resolving;
+    aCoalescer->resolving = burst->next;
+    freeBurst(burst);
+  }
+  removeTimer(aCoalescer->loop, aCoalescer->timer);
+  delete aCoalescer;
+}
+
+void queueEvent(Coalescer* aCoalescer, DBusMessage* aEvent) {
+  aCoalescer->statistics->received++;
+
+  const char* sender = dbus_message_get_sender(aEvent);
+  const char* path = dbus_message_get_path(aEvent);
+  if (GFD_COALESCE_WINDOW <= 0 || !sender || !path) {
+    aCoalescer->statistics->passed++;
+    aCoalescer->sink(aEvent, aCoalescer->closure);
+    return;
+  }
+
+  const uint64_t time = now();
+  Burst* burst;
+  for (burst = aCoalescer->bursts; burst; burst = burst->next) {
+    if (0 == strcmp(burst->sender, sender))
+      break;
+  }
+  if (!burst) {
+    burst = new Burst();
+    memset(burst, 0, sizeof(Burst));
+    burst->sender = strdup(sender);
+    if (!burst->sender) {
+      delete burst;
+      aCoalescer->statistics->passed++;
+      aCoalescer->sink(aEvent, aCoalescer->closure);
+      return;
+    }
+    burst->first = time;
+    burst->tail = &burst->events;
+    burst->next = aCoalescer->bursts;
+    aCoalescer->bursts = burst;
+  }
+  burst->last = time;
+
+  /* The latest signal for a path wins: its title is the current one. */
+  HeldEvent* held = findHeld(burst, path);
+  if (held) {
+    aCoalescer->statistics->merged++;
+    dbus_message_unref(held->event);
+  }
+  else {
+    held = new HeldEvent();
+    memset(held, 0, sizeof(HeldEvent));
+    *burst->tail = held;
+    burst->tail = &held->next;
+    burst->count++;
+  }
+  held->event = dbus_message_ref(aEvent);
+  held->path = path;
+
+  schedule(aCoalescer);
+}
+
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Coalescing of LoadComplete signals.
+ *
+ * A page with many frames, or a quick succession of navigations, makes an
+ * application send a burst of LoadComplete signals for documents that
+ * overlap. Signals are held per sender until none has come from it for
+ * GFD_COALESCE_WINDOW milliseconds, but no longer than
+ * GFD_COALESCE_MAX_DELAY after the first one. They are then passed on once
+ * per path, the latest signal of each, leaving out the documents that lie
+ * inside another document of the same burst: scanning the outer one covers
+ * them. Finding that out takes a few Parent round trips, and only when a
+ * burst has more than one path. They are pending calls, the ancestors of
+ * all the paths of a burst asked for side by side while the event loop
+ * goes on; the burst is passed on when the last reply (or timeout) is in,
+ * and the next burst of that sender is held until then.
+ *
+ * A coalescer is used from the thread of its event loop only, whose
+ * connection it sends Parent calls on.
+ */
+
+#ifndef GFD_COALESCER_H
+#define GFD_COALESCER_H
+
+#include <stdint.h>
+
+extern "C" {
+#include <dbus/dbus.h>
+}
+
+#include "eventloop.h"
+
+/* 0 passes every signal on at once. */
+#ifndef GFD_COALESCE_WINDOW
+#define GFD_COALESCE_WINDOW 100
+#endif
+
+#ifndef GFD_COALESCE_MAX_DELAY
+#define GFD_COALESCE_MAX_DELAY 1000
+#endif
+
+/* How many ancestors of a document are asked for at most. */
+#ifndef GFD_COALESCE_MAX_DEPTH
+#define GFD_COALESCE_MAX_DEPTH 64
+#endif
+
+namespace gfd {
+
+typedef struct _Coalescer Coalescer;
+
+typedef struct _CoalescerStatistics {
+  uint32_t received;
+  uint32_t passed;
+  uint32_t merged;     /* into a later signal for the same path */
+  uint32_t nested;     /* inside another document of the burst */
+  uint32_t roundTrips;
+} CoalescerStatistics;
+
+/* Called for every signal passed on; the coalescer keeps its reference. */
+typedef void (*EventSink)(DBusMessage* aEvent, void* aClosure);
+
+/* Parents are asked for on aConnection, which must be served by aLoop.
+ * Counts go to aStatistics. */
+Coalescer* newCoalescer(EventLoop* aLoop, DBusConnection* aConnection,
+                        EventSink aSink, void* aClosure,
+                        CoalescerStatistics* aStatistics);
+
+/* Drops the signals still held. */
+void freeCoalescer(Coalescer* aCoalescer);
+
+/* Holds aEvent (a reference is taken). */
+void queueEvent(Coalescer* aCoalescer, DBusMessage* aEvent);
+
+}
+
+#endif /* GFD_COALESCER_H */
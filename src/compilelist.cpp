@@ -0,0 +1,52 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Compiles the censor list into an image that greatfd maps at startup
+ * instead of compiling the list itself:
+ *
+ * $ ./gfd-compile-list [censor.lst [censor.bin [keyword...]]]
+ *
+ * The defaults are settings/censor.lst and settings/censor.bin. Keywords
+ * are those greatfd is given on its command line: the image is used only
+ * as long as both the list and those keywords are the same.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "censorlist.h"
+
+static const char kProductName[] = "gfd-compile-list";
+
+int main(int argc, char* argv[]) {
+  const char* list = (argc > 1)? argv[1] : "settings/censor.lst";
+  const char* image = (argc > 2)? argv[2] : "settings/censor.bin";
+  const char* const* extra = (argc > 3)? argv + 3 : NULL;
+  const int extraCount = (argc > 3)? argc - 3 : 0;
+
+  struct timespec start;
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  if (!gfd::compileCensorList(list, image, extra, extraCount)) {
+    fprintf(stderr, "%s: failed to compile %s\n", kProductName, list);
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fprintf(stderr, "%s: %s compiled into %s in %.1f ms\n", kProductName,
+          list, image,
+          (end.tv_sec - start.tv_sec) * 1e3 +
+          (end.tv_nsec - start.tv_nsec) / 1e6);
+  return 0;
+}
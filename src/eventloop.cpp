@@ -0,0 +1,482 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "eventloop.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GFD_EVENTLOOP_MAX_EVENTS 32
+
+namespace gfd {
+
+/* A registered file descriptor; either a user one or one that carries
+ * libdbus watches. */
+typedef struct _EventSource {
+  int fd;
+  bool dbus;
+  bool removed;     /* freed at the end of the current iteration */
+  uint32_t events;  /* registered with epoll; 0 when not registered */
+  FdHandler handler;
+  void* closure;
+  _EventSource* next;
+} EventSource;
+
+typedef struct _EventWatch {
+  DBusWatch* watch;
+  uint32_t handled; /* iteration it was last handled in */
+  _EventWatch* next;
+} EventWatch;
+
+struct _EventTimer {
+  int interval;
+  bool enabled;
+  uint64_t deadline; /* CLOCK_MONOTONIC, in milliseconds */
+  TimerHandler handler;
+  void* closure;
+  DBusTimeout* timeout; /* or NULL for addTimer() timers */
+  _EventTimer* next;
+};
+
+typedef struct _EventConnection {
+  DBusConnection* connection;
+  _EventConnection* next;
+} EventConnection;
+
+struct _EventLoop {
+  int epollFd;
+  bool quit;
+  uint32_t iteration;
+  EventSource* sources;
+  EventSource* removedSources;
+  EventWatch* watches;
+  EventTimer* timers;
+  EventConnection* connections;
+};
+
+static uint64_t now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+static EventSource* findSource(EventLoop* aLoop, int aFd) {
+  EventSource* source;
+  for (source = aLoop->sources; source; source = source->next) {
+    if (source->fd == aFd)
+      return source;
+  }
+  return NULL;
+}
+
+static EventSource* newSource(EventLoop* aLoop, int aFd) {
+  EventSource* source = new EventSource();
+  memset(source, 0, sizeof(EventSource));
+  source->fd = aFd;
+  source->next = aLoop->sources;
+  aLoop->sources = source;
+  return source;
+}
+
+/* Unlinks aSource; it is freed once the events already returned by
+ * epoll_wait() have been handled. */
+static void dropSource(EventLoop* aLoop, EventSource* aSource) {
+  EventSource** link = &aLoop->sources;
+  while (*link != aSource)
+    link = &(*link)->next;
+  *link = aSource->next;
+
+  aSource->removed = true;
+  aSource->next = aLoop->removedSources;
+  aLoop->removedSources = aSource;
+}
+
+/* Registers aEvents for aSource, or unregisters it if aEvents is 0. */
+static bool setEvents(EventLoop* aLoop, EventSource* aSource,
+                      uint32_t aEvents) {
+  if (aSource->events == aEvents)
+    return true;
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = aEvents;
+  event.data.ptr = aSource;
+
+  int operation = !aEvents? EPOLL_CTL_DEL :
+                  !aSource->events? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (epoll_ctl(aLoop->epollFd, operation, aSource->fd, &event) < 0) {
+    perror("epoll_ctl");
+    return false;
+  }
+  aSource->events = aEvents;
+  return true;
+}
+
+/* Registers the union of the enabled watches of aFd. */
+static bool updateWatches(EventLoop* aLoop, int aFd) {
+  uint32_t events = 0;
+  bool watched = false;
+  EventWatch* entry;
+  for (entry = aLoop->watches; entry; entry = entry->next) {
+    if (dbus_watch_get_unix_fd(entry->watch) != aFd)
+      continue;
+    watched = true;
+    if (!dbus_watch_get_enabled(entry->watch))
+      continue;
+
+    unsigned int flags = dbus_watch_get_flags(entry->watch);
+    if (flags & DBUS_WATCH_READABLE)
+      events |= EPOLLIN;
+    if (flags & DBUS_WATCH_WRITABLE)
+      events |= EPOLLOUT;
+  }
+
+  EventSource* source = findSource(aLoop, aFd);
+  if (!source) {
+    if (!watched)
+      return true;
+    source = newSource(aLoop, aFd);
+    source->dbus = true;
+  }
+
+  bool succeeded = setEvents(aLoop, source, events);
+  if (!watched)
+    dropSource(aLoop, source);
+  return succeeded;
+}
+
+static dbus_bool_t addWatch(DBusWatch* aWatch, void* aLoop) {
+  EventLoop* loop = static_cast<EventLoop*>(aLoop);
+  EventWatch* entry = new EventWatch();
+  entry->watch = aWatch;
+  entry->handled = 0;
+  entry->next = loop->watches;
+  loop->watches = entry;
+  return updateWatches(loop, dbus_watch_get_unix_fd(aWatch));
+}
+
+static void removeWatch(DBusWatch* aWatch, void* aLoop) {
+  EventLoop* loop = static_cast<EventLoop*>(aLoop);
+  EventWatch** link = &loop->watches;
+  while (*link && (*link)->watch != aWatch)
+    link = &(*link)->next;
+  if (!*link)
+    return;
+
+  EventWatch* entry = *link;
+  *link = entry->next;
+  delete entry;
+  updateWatches(loop, dbus_watch_get_unix_fd(aWatch));
+}
+
+static void toggleWatch(DBusWatch* aWatch, void* aLoop) {
+  updateWatches(static_cast<EventLoop*>(aLoop),
+                dbus_watch_get_unix_fd(aWatch));
+}
+
+/* Handling a watch may add or remove others, so the list is searched again
+ * from the start after each one. */
+static void handleWatches(EventLoop* aLoop, int aFd, uint32_t aEvents) {
+  EventWatch* entry = aLoop->watches;
+  while (entry) {
+    if (entry->handled == aLoop->iteration ||
+        dbus_watch_get_unix_fd(entry->watch) != aFd ||
+        !dbus_watch_get_enabled(entry->watch)) {
+      entry = entry->next;
+      continue;
+    }
+    entry->handled = aLoop->iteration;
+
+    unsigned int wanted = dbus_watch_get_flags(entry->watch);
+    unsigned int flags = 0;
+    if ((aEvents & EPOLLIN) && (wanted & DBUS_WATCH_READABLE))
+      flags |= DBUS_WATCH_READABLE;
+    if ((aEvents & EPOLLOUT) && (wanted & DBUS_WATCH_WRITABLE))
+      flags |= DBUS_WATCH_WRITABLE;
+    if (aEvents & EPOLLERR)
+      flags |= DBUS_WATCH_ERROR;
+    if (aEvents & EPOLLHUP)
+      flags |= DBUS_WATCH_HANGUP;
+
+    if (flags)
+      dbus_watch_handle(entry->watch, flags);
+    entry = aLoop->watches;
+  }
+}
+
+static void armTimer(EventTimer* aTimer) {
+  aTimer->deadline = now() + aTimer->interval;
+}
+
+static EventTimer* newTimer(EventLoop* aLoop, int aInterval) {
+  EventTimer* timer = new EventTimer();
+  memset(timer, 0, sizeof(EventTimer));
+  timer->interval = aInterval;
+  timer->enabled = true;
+  armTimer(timer);
+  timer->next = aLoop->timers;
+  aLoop->timers = timer;
+  return timer;
+}
+
+static dbus_bool_t addTimeout(DBusTimeout* aTimeout, void* aLoop) {
+  EventTimer* timer = newTimer(static_cast<EventLoop*>(aLoop),
+                               dbus_timeout_get_interval(aTimeout));
+  timer->timeout = aTimeout;
+  timer->enabled = dbus_timeout_get_enabled(aTimeout);
+  return TRUE;
+}
+
+static EventTimer* findTimeout(EventLoop* aLoop, DBusTimeout* aTimeout) {
+  EventTimer* timer;
+  for (timer = aLoop->timers; timer; timer = timer->next) {
+    if (timer->timeout == aTimeout)
+      return timer;
+  }
+  return NULL;
+}
+
+static void removeTimeout(DBusTimeout* aTimeout, void* aLoop) {
+  EventLoop* loop = static_cast<EventLoop*>(aLoop);
+  EventTimer* timer = findTimeout(loop, aTimeout);
+  if (timer)
+    removeTimer(loop, timer);
+}
+
+static void toggleTimeout(DBusTimeout* aTimeout, void* aLoop) {
+  EventTimer* timer = findTimeout(static_cast<EventLoop*>(aLoop), aTimeout);
+  if (!timer)
+    return;
+  timer->interval = dbus_timeout_get_interval(aTimeout);
+  timer->enabled = dbus_timeout_get_enabled(aTimeout);
+  armTimer(timer);
+}
+
+/* Runs the due timers. A handler may add or remove timers, so the list is
+ * searched again from the start after each one; a timer is rearmed before
+ * its handler runs, so it is not run twice. */
+static void runTimers(EventLoop* aLoop) {
+  const uint64_t time = now();
+  EventTimer* timer = aLoop->timers;
+  while (timer) {
+    if (!timer->enabled || timer->deadline > time) {
+      timer = timer->next;
+      continue;
+    }
+
+    timer->deadline = time + timer->interval;
+    if (timer->timeout)
+      dbus_timeout_handle(timer->timeout);
+    else
+      timer->handler(timer->closure);
+    timer = aLoop->timers;
+  }
+}
+
+/* Milliseconds until the nearest timer is due, or -1. */
+static int nextTimeout(EventLoop* aLoop) {
+  const uint64_t time = now();
+  int64_t timeout = -1;
+  EventTimer* timer;
+  for (timer = aLoop->timers; timer; timer = timer->next) {
+    if (!timer->enabled)
+      continue;
+    int64_t left = (timer->deadline > time)? timer->deadline - time : 0;
+    if (timeout < 0 || left < timeout)
+      timeout = left;
+  }
+  return int(timeout);
+}
+
+/* Dispatches every connection until none has messages queued. */
+static void dispatch(EventLoop* aLoop) {
+  EventConnection* entry;
+  for (entry = aLoop->connections; entry && !aLoop->quit;
+       entry = entry->next) {
+    while (!aLoop->quit &&
+           dbus_connection_get_dispatch_status(entry->connection) ==
+           DBUS_DISPATCH_DATA_REMAINS)
+      dbus_connection_dispatch(entry->connection);
+  }
+}
+
+EventLoop* newEventLoop() {
+  EventLoop* loop = new EventLoop();
+  memset(loop, 0, sizeof(EventLoop));
+  loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epollFd < 0) {
+    perror("epoll_create1");
+    delete loop;
+    return NULL;
+  }
+  return loop;
+}
+
+void freeEventLoop(EventLoop* aLoop) {
+  if (!aLoop)
+    return;
+
+  while (aLoop->connections)
+    removeConnection(aLoop, aLoop->connections->connection);
+  while (aLoop->timers)
+    removeTimer(aLoop, aLoop->timers);
+  while (aLoop->sources)
+    dropSource(aLoop, aLoop->sources);
+  while (aLoop->removedSources) {
+    EventSource* source = aLoop->removedSources;
+    aLoop->removedSources = source->next;
+    delete source;
+  }
+  close(aLoop->epollFd);
+  delete aLoop;
+}
+
+bool addConnection(EventLoop* aLoop, DBusConnection* aConnection) {
+  EventConnection* entry = new EventConnection();
+  entry->connection = aConnection;
+  entry->next = aLoop->connections;
+  aLoop->connections = entry;
+
+  if (!dbus_connection_set_watch_functions(aConnection, addWatch, removeWatch,
+                                           toggleWatch, aLoop, NULL) ||
+      !dbus_connection_set_timeout_functions(aConnection, addTimeout,
+                                             removeTimeout, toggleTimeout,
+                                             aLoop, NULL)) {
+    removeConnection(aLoop, aConnection);
+    return false;
+  }
+  return true;
+}
+
+void removeConnection(EventLoop* aLoop, DBusConnection* aConnection) {
+  EventConnection** link = &aLoop->connections;
+  while (*link && (*link)->connection != aConnection)
+    link = &(*link)->next;
+  if (!*link)
+    return;
+
+  EventConnection* entry = *link;
+  *link = entry->next;
+  delete entry;
+
+  dbus_connection_set_watch_functions(aConnection, NULL, NULL, NULL, NULL,
+                                      NULL);
+  dbus_connection_set_timeout_functions(aConnection, NULL, NULL, NULL, NULL,
+                                        NULL);
+}
+
+bool addFd(EventLoop* aLoop, int aFd, uint32_t aEvents,
+           FdHandler aHandler, void* aClosure) {
+  if (findSource(aLoop, aFd))
+    return false;
+
+  EventSource* source = newSource(aLoop, aFd);
+  source->handler = aHandler;
+  source->closure = aClosure;
+  if (!setEvents(aLoop, source, aEvents)) {
+    dropSource(aLoop, source);
+    return false;
+  }
+  return true;
+}
+
+void removeFd(EventLoop* aLoop, int aFd) {
+  EventSource* source = findSource(aLoop, aFd);
+  if (!source || source->dbus)
+    return;
+  setEvents(aLoop, source, 0);
+  dropSource(aLoop, source);
+}
+
+EventTimer* addTimer(EventLoop* aLoop, int aInterval,
+                     TimerHandler aHandler, void* aClosure) {
+  EventTimer* timer = newTimer(aLoop, aInterval);
+  timer->handler = aHandler;
+  timer->closure = aClosure;
+  return timer;
+}
+
+void removeTimer(EventLoop* aLoop, EventTimer* aTimer) {
+  EventTimer** link = &aLoop->timers;
+  while (*link && *link != aTimer)
+    link = &(*link)->next;
+  if (!*link)
+    return;
+
+  *link = aTimer->next;
+  delete aTimer;
+}
+
+void setTimer(EventTimer* aTimer, int aInterval) {
+  aTimer->enabled = aInterval >= 0;
+  if (aTimer->enabled) {
+    aTimer->interval = aInterval;
+    armTimer(aTimer);
+  }
+}
+
+bool runEventLoop(EventLoop* aLoop) {
+  struct epoll_event events[GFD_EVENTLOOP_MAX_EVENTS];
+
+  aLoop->quit = false;
+  while (!aLoop->quit) {
+    /* Messages may also have been queued outside of any watch, e.g. while
+     * a handler was blocked waiting for a reply. */
+    dispatch(aLoop);
+    if (aLoop->quit)
+      break;
+
+    int count = epoll_wait(aLoop->epollFd, events, GFD_EVENTLOOP_MAX_EVENTS,
+                           nextTimeout(aLoop));
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("epoll_wait");
+      return false;
+    }
+
+    /* Never 0, so that no watch looks handled already. */
+    if (++aLoop->iteration == 0)
+      aLoop->iteration = 1;
+
+    int i;
+    for (i = 0; i < count; i++) {
+      EventSource* source = static_cast<EventSource*>(events[i].data.ptr);
+      if (source->removed)
+        continue;
+      if (source->dbus)
+        handleWatches(aLoop, source->fd, events[i].events);
+      else
+        source->handler(source->fd, events[i].events, source->closure);
+    }
+
+    while (aLoop->removedSources) {
+      EventSource* source = aLoop->removedSources;
+      aLoop->removedSources = source->next;
+      delete source;
+    }
+
+    runTimers(aLoop);
+  }
+  return true;
+}
+
+void quitEventLoop(EventLoop* aLoop) {
+  aLoop->quit = true;
+}
+
+}
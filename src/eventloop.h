@@ -0,0 +1,70 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* epoll based main loop.
+ *
+ * libdbus is driven through its watch and timeout functions: every watch
+ * becomes an epoll registration of its file descriptor, every timeout a
+ * timer of the loop, and a connection is dispatched whenever it has
+ * messages queued. Other file descriptors and periodic timers can be added
+ * beside them. Nothing sleeps for a fixed time: epoll_wait() returns as soon
+ * as a descriptor is ready or the nearest timer is due.
+ */
+
+#ifndef GFD_EVENTLOOP_H
+#define GFD_EVENTLOOP_H
+
+#include <stdint.h>
+
+extern "C" {
+#include <dbus/dbus.h>
+}
+
+namespace gfd {
+
+typedef struct _EventLoop EventLoop;
+typedef struct _EventTimer EventTimer;
+
+/* aEvents are epoll events (EPOLLIN, ...). */
+typedef void (*FdHandler)(int aFd, uint32_t aEvents, void* aClosure);
+typedef void (*TimerHandler)(void* aClosure);
+
+EventLoop* newEventLoop();
+void freeEventLoop(EventLoop* aLoop);
+
+/* Serves aConnection from aLoop until removeConnection(). Messages are
+ * handed to the connection's filters and object paths as usual. */
+bool addConnection(EventLoop* aLoop, DBusConnection* aConnection);
+void removeConnection(EventLoop* aLoop, DBusConnection* aConnection);
+
+bool addFd(EventLoop* aLoop, int aFd, uint32_t aEvents,
+           FdHandler aHandler, void* aClosure);
+void removeFd(EventLoop* aLoop, int aFd);
+
+/* Calls aHandler every aInterval milliseconds. */
+EventTimer* addTimer(EventLoop* aLoop, int aInterval,
+                     TimerHandler aHandler, void* aClosure);
+void removeTimer(EventLoop* aLoop, EventTimer* aTimer);
+
+/* Makes aTimer due aInterval milliseconds from now, and every aInterval
+ * milliseconds after that; a negative aInterval stops it until the next
+ * call. May be called from the timer's own handler. */
+void setTimer(EventTimer* aTimer, int aInterval);
+
+/* Runs until quitEventLoop() is called. Returns false if epoll failed. */
+bool runEventLoop(EventLoop* aLoop);
+void quitEventLoop(EventLoop* aLoop);
+
+}
+
+#endif /* GFD_EVENTLOOP_H */
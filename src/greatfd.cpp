@@ -23,7 +23,8 @@
  *
  * When censoring-mode is enabled (enabled by default), it also watches the
  * document so as to check if the website contains specific words, which
- * is listed in "censor.lst".
+ * is listed in "censor.lst" or given on the command line. The list is
+ * reloaded whenever the file changes, without restarting.
  *
  * If one of them matches, it will leave a message in "censor.log".
  *
@@ -37,19 +38,82 @@
  * improperly contains (or at least contained at that time) the phrase
  * "Voldemort".
  *
+ * Pages of the sites listed in "skip.lst" (URL prefixes, and host suffixes
+ * starting with '.'; see skiplist.h) are not scanned, only monitored. That
+ * list is reloaded along with "censor.lst".
+ *
+ * A page too big to be walked within the budgets of greatfd.h (nodes, bytes
+ * of text, depth and time) is scanned only as far as the walk went, and
+ * that is recorded too, with the budgets that ran out ("timeout" if the
+ * application stopped answering, "memory" if greatfd couldn't allocate the
+ * rest of the walk):
+ *
+ * >x=truncated: nodes, deadline
+ * >d=2012-04-18T11:27:40+0000
+ * >t=Twitter
+ * >u=https://twitter.com/
+ *
+ * An application whose calls keep timing out is given up on for a while
+ * (see breaker.h); the pages it loads meanwhile are still monitored, with
+ * their URL if it comes within GFD_SKIPPED_URL_TIMEOUT, but not scanned.
+ * How many were skipped is in the statistics below.
+ *
  * As a result, "monitor.log" usually becomes much larger than "censor.log".
  *
  * The biggest merit of this application is that it should work with HTTPS
  * nonetheless, unlike other network monitoring software. Besides this is
  * not a browsers' addon. There's no direct dependency on their versions.
  *
- * Note: The way to exit is not implemented yet. Type Ctrl-C, ps & kill or
- *       gnome-system-monitor instead.
+ * Where the time goes is kept in "logs/stats", rewritten every
+ * GFD_METRICS_INTERVAL milliseconds: event latency, round trips, nodes and
+ * bytes per event, the latency of each AT-SPI method, matcher throughput and
+ * log flush latency. The same text is returned by the GetStatistics method
+ * of org.goldenpanopticon.GreatFiredaemon, on the connection of the daemon
+ * to the AT-SPI bus:
+ *
+ * >$ dbus-send --bus=$AT_SPI_BUS --print-reply --dest=:1.23 \
+ * >    /org/goldenpanopticon/GreatFiredaemon \
+ * >    org.goldenpanopticon.GreatFiredaemon.GetStatistics
+ *
+ * Note: Type Ctrl-C (or send SIGTERM) to exit. Pending log records are
+ *       written out first.
  */
 
-#define GFD_READ_CENSOR_LIST 0
 #define GFD_STOP_MONITOR_LOG 0
 
+/* Stop scanning a page as soon as the first fragment containing a keyword
+ * has been seen, instead of once every keyword has been seen. censor.log
+ * then lists only the keywords of that fragment. */
+#ifndef GFD_CENSOR_FIRST_HIT
+#define GFD_CENSOR_FIRST_HIT 0
+#endif
+
+/* How often (in milliseconds) the scan statistics are printed to stderr,
+ * if there were new scans. */
+#ifndef GFD_STATS_INTERVAL
+#define GFD_STATS_INTERVAL (60 * 1000)
+#endif
+
+/* How often (in milliseconds) logs/stats is rewritten. */
+#ifndef GFD_METRICS_INTERVAL
+#define GFD_METRICS_INTERVAL (10 * 1000)
+#endif
+
+/* Also follow object:text-changed and object:children-changed events of the
+ * documents that have been scanned, and scan only what changed. Off unless
+ * a deployment opts in (cmake -DGFD_WATCH_CHANGES=ON): the match rules take
+ * these signals from every application on the bus, most of them about
+ * objects that are not in any scanned document. */
+#ifndef GFD_WATCH_CHANGES
+#define GFD_WATCH_CHANGES 0
+#endif
+
+/* How many ancestors of a changed object are asked for at most, looking for
+ * the document it belongs to. */
+#ifndef GFD_WATCH_MAX_DEPTH
+#define GFD_WATCH_MAX_DEPTH 64
+#endif
+
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -59,12 +123,32 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <mcheck.h>
+#include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 
 extern "C" {
 #include <dbus/dbus.h> 
 }
 
+#include "breaker.h"
+#include "casefold.h"
+#include "censorlist.h"
+#include "coalescer.h"
+#include "eventloop.h"
+#include "greatfd.h"
+#include "hash.h"
+#include "logger.h"
+#include "matcher.h"
+#include "metrics.h"
+#include "model.h"
+#include "pattern.h"
+#include "resultcache.h"
+#include "strsearch.h"
+#include "workers.h"
+
 static const char kProductName[]    = "great firedaemon";
 
 #if GFD_STOP_MONITOR_LOG
@@ -74,32 +158,128 @@ static const char kMonitorLogFile[] = "logs/monitor.log";
 #endif
 
 static const char kCensorList[]     = "settings/censor.lst";
+static const char kCensorImage[]    = "settings/censor.bin";
+static const char kSkipList[]       = "settings/skip.lst";
 static const char kCensorLogFile[]  = "logs/censor.log";
-
-/* singly linked list */
-typedef struct _CensorWordList {
-  const char* data;
-  const _CensorWordList* next;
-} CensorWordList;
-
-typedef struct _TextFragmentList {
-  char* data;
-  _TextFragmentList* next;
-} TextFragmentList;
+static const char kStatsFile[]      = "logs/stats";
+
+static const char kStatsPath[]      = "/org/goldenpanopticon/GreatFiredaemon";
+static const char kStatsInterface[] = "org.goldenpanopticon.GreatFiredaemon";
+
+static gfd::LogFile* gMonitorLog(NULL);
+static gfd::LogFile* gCensorLog(NULL);
+
+/* Sum of all page scans so far. */
+static WalkStatistics gWalkTotals;
+static uint32_t gScanCount(0);
+static uint32_t gTruncatedCount(0); /* of scans and changes */
+static uint32_t gReportedScanCount(0);
+
+/* Pages whose previous result could be reused, or not. */
+static gfd::ResultCache* gResultCache(NULL);
+static uint32_t gResultCacheHits(0);
+static uint32_t gResultCacheMisses(0);
+
+/* Senders that stopped answering. */
+static gfd::BreakerTable* gBreakers(NULL);
+
+/* LoadComplete signals held back and merged. */
+static gfd::CoalescerStatistics gCoalescerStatistics;
+
+/* When each signal arrived (a uint64_t of metricsClock()). */
+static dbus_int32_t gArrivalSlot(-1);
+
+/* Change events handled, and what rescanning them took. */
+static WalkStatistics gChangeTotals;
+static uint32_t gChangeCount(0);
+static uint32_t gReportedChangeCount(0);
+
+/* What each worker keeps between events. */
+typedef struct _Scanner {
+  gfd::TextArena texts;    /* of the page being scanned */
+  gfd::ScanResult cached;  /* of the previous scan of the same URL */
+  gfd::ScanResult current; /* of this scan, to be cached */
+  gfd::DocumentModel* model; /* of the documents of its senders */
+  gfd::FoldBuffer folded;  /* of the fragment being matched */
+} Scanner;
+
+static Scanner gScanners[GFD_WORKER_COUNT_MAX];
+
+/* Matching state of one page, carried from fragment to fragment. */
+typedef struct _PageScan {
+  const gfd::Matcher* matcher;
+  gfd::FoldBuffer* folded;
+  uint8_t* hits;
+  uint32_t found;
+  bool stopped;                  /* by scanFragment() */
+
+  gfd::ScanResult* current;      /* NULL if the result isn't cached */
+  /* While the page is the same as when it was cached, matching is
+     deferred; NULL once it isn't. */
+  const gfd::ScanResult* cached;
+
+  /* The document whose objects the fragments are recorded in, if any. */
+  gfd::DocumentModel* model;
+  gfd::Document* document;
+  const char* sender;
+  bool changesOnly;              /* skip objects whose text is unchanged */
+} PageScan;
+
+/* What handleMessage() needs. */
+typedef struct _FilterContext {
+  gfd::EventLoop* loop;
+  DBusConnection* connection;
+  gfd::Coalescer* coalescer;
+  gfd::WorkerPool* workers; /* NULL: scan on the main thread */
+} FilterContext;
 
+DBusHandlerResult
+handleMessage(DBusConnection* aConnection, DBusMessage* aMessage,
+              void* aContext);
 DBusHandlerResult
 filter(DBusConnection* aConnection, DBusMessage* aMessage,
-       const CensorWordList* aCensorWordList);
+       const gfd::CensorList* aList, Scanner* aScanner);
+DBusHandlerResult
+rescan(DBusConnection* aConnection, DBusMessage* aEvent,
+       const gfd::CensorList* aList, Scanner* aScanner);
+gfd::Document*
+findDocument(DBusConnection* aConnection, gfd::DocumentModel* aModel,
+             const char* aSender, const char* aPath, uint64_t aDeadline,
+             WalkStatistics* aStatistics);
+void
+passEvent(DBusMessage* aEvent, void* aContext);
+void
+scanEvent(DBusConnection* aConnection, DBusMessage* aEvent, uint32_t aWorker,
+          void* aClosure);
+void
+handleSignal(int aFd, uint32_t aEvents, void* aLoop);
+void
+flushLogs(void*);
+void
+printStatistics(void*);
+void
+writeStatistics(void*);
+void
+replyStatistics(DBusConnection* aConnection, DBusMessage* aCall);
+void
+sampleGauges();
+void
+recordArrival(DBusMessage* aEvent);
+void
+recordEvent(DBusMessage* aEvent, const WalkStatistics* aStatistics);
+void
+formatDatetime(char* aDatetime, size_t aSize);
+void
+logTruncation(const char* aDatetime, const char* aTitle, const char* aUrl,
+              uint32_t aTruncated);
 bool
-censor(const TextFragmentList* aFragment, const char* aKeyword);
-
-inline void
-flogf(const char* aFilename, const char* aFormat, ...);
-
-TextFragmentList* copyTexts(DBusConnection* aConnection,
-                            const char* aDestination,
-                            const char* aPath,
-                            TextFragmentList* aLatestNode);
+scanFragment(const gfd::TextArena* aTexts, uint32_t aIndex, const char* aPath,
+             void* aScan);
+bool
+matchFragment(PageScan* aScan, const gfd::TextArena* aTexts,
+              uint32_t aIndex);
+bool
+censor(const gfd::TextArena* aTexts, const char* aKeyword);
 
 #ifndef NDEBUG
 void gfdDumpIter(DBusMessageIter* aIter, int aIndent) {
@@ -195,8 +375,7 @@ void gfdDumpIter(DBusMessageIter* aIter, int aIndent) {
   }
 }
 
-void gfdDumpMessage(DBusMessage* aMessage,
-                    int aLine = 0, const char* aFile = NULL) {
+void gfdDumpMessage(DBusMessage* aMessage, int aLine, const char* aFile) {
   const char* type =
     dbus_message_type_to_string(dbus_message_get_type(aMessage));
   dbus_uint32_t serial = dbus_message_get_serial(aMessage);
@@ -223,7 +402,7 @@ void gfdDumpMessage(DBusMessage* aMessage,
 }
 
 void gfdDumpConnection(DBusConnection* aConnection,
-                       int aLine = 0, const char* aFile = NULL) {
+                       int aLine, const char* aFile) {
   DBusError error;
   dbus_error_init(&error);
 
@@ -283,16 +462,6 @@ void gfdDumpConnection(DBusConnection* aConnection,
          dbus_connection_get_is_anonymous(aConnection)?     "yes":" no"
         );
 }
-
-#define GFD_DUMP_DBUS_MESSAGE(__DBUSMESSAGE__) \
-  (gfdDumpMessage((__DBUSMESSAGE__), (__LINE__), (__FILE__)))
-
-#define GFD_DUMP_DBUS_CONNECTION(__DBUSCONNECTION__) \
-  (gfdDumpConnection((__DBUSCONNECTION__), (__LINE__), (__FILE__)))
-
-#else
-#define GFD_DUMP_DBUS_MESSAGE(ignore)((void) 0)
-#define GFD_DUMP_DBUS_CONNECTION(ignore)((void) 0)
 #endif
 
 void checkDBusError(DBusError* aError, int aLine, const char* aFile) {
@@ -305,99 +474,9 @@ void checkDBusError(DBusError* aError, int aLine, const char* aFile) {
   dbus_error_free(aError);
 }
 
-#define GFD_CHECK_DBUS_ERROR(__DBUSERROR__) \
-  (checkDBusError((__DBUSERROR__), (__LINE__), (__FILE__)))
-
-#define GFD_A11Y_DESTINATION           "org.a11y.Bus"
-#define GFD_A11Y_PATH                  "/org/a11y/bus"
-#define GFD_A11Y_INTERFACE             "org.a11y.Bus"
-
-#define GFD_ATSPI_REGISTRY_DESTINATION "org.a11y.atspi.Registry"
-#define GFD_ATSPI_REGISTRY_PATH        "/org/a11y/atspi/registry"
-#define GFD_ATSPI_REGISTRY_INTERFACE   "org.a11y.atspi.Registry"
-
-#define GFD_ATSPI_INTERFACE_BASE_      "org.a11y.atspi."
-#define GFD_ATSPI_INTERFACE_ACCESSIBLE GFD_ATSPI_INTERFACE_BASE_ "Accessible"
-#define GFD_ATSPI_INTERFACE_TEXT       GFD_ATSPI_INTERFACE_BASE_ "Text"
-
-namespace gfd {
-namespace atspi {
-namespace interface {
-static const char* const kAccessible = GFD_ATSPI_INTERFACE_ACCESSIBLE;
-static const char* const kDocument   = GFD_ATSPI_INTERFACE_BASE_ "Document";
-static const char* const kText       = GFD_ATSPI_INTERFACE_TEXT;
-}
-}
-}
-
 int main(int argc, char* argv[]) {
-#if GFD_READ_CENSOR_LIST
-  /*
-     Note that the life time of this buffer equals to that of
-     this application.
-   */
-  char* buff(NULL);
-  {
-    FILE* fp = fopen(kCensorList, "rb"); 
-    if (!fp) {
-      perror(kCensorList);
-      return 1;
-    }
-
-    if (0 != fseek(fp, 0, SEEK_END)) {
-      perror(kCensorList);
-      fclose(fp);
-      return 1;
-    }
-
-    long size1 = ftell(fp);
-    if (size1 < 0) {
-      perror(kCensorList);
-      fclose(fp);
-      return 1;
-    }
-    else if (size1 == 0) {
-      return 1;
-    }
-
-    rewind(fp);
-
-    buff = new char[size1];
-    size_t size2 = fread(buff, 1, size1, fp);
-    if (size_t(size1) != size2) {
-      perror(kCensorList);
-    }
-
-    fclose(fp);
-  }
-#endif
-
-  const CensorWordList* latestNode(NULL);
-  {
-#if GFD_READ_CENSOR_LIST
-    char* next;
-    const char* line = strtok_r(buff, "\n", &next);
-
-    while (line) {
-      if (char(line[0]) != '\0') {
-        CensorWordList* node = new CensorWordList();
-        node->data = line;
-        node->next = latestNode;
-        latestNode = node;
-      }
-      line = strtok_r(NULL, "\n", &next);
-    }
-#endif
-    int i;
-    for(i = 1; i < argc; i++) {
-      if (char(*argv[i]) != '\0') {
-        CensorWordList* node = new CensorWordList();
-        node->data = argv[i];
-        node->next = latestNode;
-        latestNode = node;
-      }
-    }
-  }
+  /* Worker threads use their own connections, but messages are shared. */
+  dbus_threads_init_default();
 
   DBusError error;
   dbus_error_init(&error);
@@ -409,6 +488,7 @@ int main(int argc, char* argv[]) {
   GFD_DUMP_DBUS_CONNECTION(connection);
 
   /* Query AT-SPI DBUS address */
+  char* atspiAddress(NULL);
   {
     DBusMessage* method = dbus_message_new_method_call(GFD_A11Y_DESTINATION,
                                                        GFD_A11Y_PATH,
@@ -451,6 +531,8 @@ int main(int argc, char* argv[]) {
 
     GFD_DUMP_DBUS_CONNECTION(connection);
 
+    /* for the workers' connections */
+    atspiAddress = strdup(atspiBusAddress);
     dbus_message_unref(response);
 
     GFD_CHECK_DBUS_ERROR(&error);
@@ -468,20 +550,41 @@ int main(int argc, char* argv[]) {
     GFD_DUMP_DBUS_CONNECTION(connection);
   }
 
-  dbus_bus_add_match(connection,
-                     "type='signal',"
-                     "interface='org.a11y.atspi.Event.Document',"
-                     "member='LoadComplete'",
-                     &error);
-  if (dbus_error_is_set(&error)) {
-    fprintf(stderr, "%s:%s\n", kProductName, error.message); 
-    dbus_error_free(&error);
-    dbus_connection_unref(connection);
-    return 1;
+  static const char* const rules[] = {
+    "type='signal',"
+    "interface='org.a11y.atspi.Event.Document',"
+    "member='LoadComplete'",
+#if GFD_WATCH_CHANGES
+    "type='signal',"
+    "interface='org.a11y.atspi.Event.Object',"
+    "member='TextChanged'",
+    "type='signal',"
+    "interface='org.a11y.atspi.Event.Object',"
+    "member='ChildrenChanged'",
+#endif
+  };
+  uint32_t r;
+  for (r = 0; r < sizeof(rules) / sizeof(rules[0]); r++) {
+    dbus_bus_add_match(connection, rules[r], &error);
+    if (dbus_error_is_set(&error)) {
+      fprintf(stderr, "%s:%s\n", kProductName, error.message); 
+      dbus_error_free(&error);
+      dbus_connection_unref(connection);
+      return 1;
+    }
   }
 
-  static const char* event = "document:load-complete";
-  {
+  static const char* const events[] = {
+    "document:load-complete",
+#if GFD_WATCH_CHANGES
+    "object:text-changed",
+    "object:children-changed",
+#endif
+  };
+  const uint32_t eventCount = sizeof(events) / sizeof(events[0]);
+  uint32_t e;
+  for (e = 0; e < eventCount; e++) {
+    const char* event = events[e];
     DBusMessage* method =
       dbus_message_new_method_call(GFD_ATSPI_REGISTRY_DESTINATION,
                                    GFD_ATSPI_REGISTRY_PATH,
@@ -519,29 +622,120 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  for (;;) {
-    dbus_connection_read_write_dispatch(connection, -1);
-    DBusMessage* signal = dbus_connection_pop_message(connection);
+  /* Exit through the event loop, so that everything after it still
+     happens. Blocked before the writer thread starts, which inherits the
+     mask. */
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  /* Scans use the list that is current when they start; it is replaced,
+     off the event loop, whenever censor.lst changes. */
+  if (!gfd::startCensorList(kCensorList, kCensorImage, kSkipList, argv + 1,
+                            argc - 1)) {
+    fprintf(stderr, "%s: failed to load the censor list\n", kProductName);
+    dbus_connection_unref(connection);
+    return 1;
+  }
+
+  gMonitorLog = gfd::openLog(kMonitorLogFile);
+  gCensorLog = gfd::openLog(kCensorLogFile);
+  if (!gfd::startLogger())
+    fprintf(stderr, "%s: writing logs synchronously\n", kProductName);
+
+  gfd::EventLoop* loop = gfd::newEventLoop();
+  if (!loop) {
+    gfd::stopLogger();
+    dbus_connection_unref(connection);
+    return 1;
+  }
 
-    if (!signal) {
-      static int life = 20;
-      if ((life--) < 0)
-        break;
+  int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+  if (signalFd < 0)
+    perror("signalfd");
+  else
+    gfd::addFd(loop, signalFd, EPOLLIN, handleSignal, loop);
+
+  if (!dbus_message_allocate_data_slot(&gArrivalSlot))
+    fprintf(stderr, "%s: not measuring event latency\n", kProductName);
+
+  FilterContext context;
+  context.loop = loop;
+  context.connection = connection;
+  context.coalescer = gfd::newCoalescer(loop, connection, passEvent, &context,
+                                        &gCoalescerStatistics);
+  context.workers = NULL;
+  gResultCache = gfd::newResultCache(GFD_RESULT_CACHE_SIZE);
+  gBreakers = gfd::newBreakerTable();
+  if (atspiAddress) {
+    context.workers = gfd::startWorkers(atspiAddress, GFD_WORKER_COUNT,
+                                        scanEvent, NULL);
+  }
+  if (!context.workers)
+    fprintf(stderr, "%s: scanning on the main thread\n", kProductName);
+  if (!dbus_connection_add_filter(connection, handleMessage, &context,
+                                  NULL) ||
+      !gfd::addConnection(loop, connection)) {
+    fprintf(stderr, "%s: out of memory\n", kProductName);
+    gfd::quitEventLoop(loop);
+  }
 
-      sleep(1);
-      continue;
-    }
+  gfd::addTimer(loop, GFD_LOG_FLUSH_INTERVAL, flushLogs, NULL);
+  gfd::addTimer(loop, GFD_STATS_INTERVAL, printStatistics, NULL);
+  gfd::addTimer(loop, GFD_METRICS_INTERVAL, writeStatistics, NULL);
 
-    DBusHandlerResult result = filter(connection, signal, latestNode);
+  gfd::runEventLoop(loop);
 
-    dbus_message_unref(signal);
+  gfd::freeCoalescer(context.coalescer);
+  if (context.workers)
+    gfd::stopWorkers(context.workers);
+  free(atspiAddress);
+  gfd::stopCensorList();
 
-    if (result != DBUS_HANDLER_RESULT_HANDLED) {
-      break;
+  gfd::removeConnection(loop, connection);
+  dbus_connection_remove_filter(connection, handleMessage, &context);
+  gfd::freeEventLoop(loop);
+  if (signalFd >= 0)
+    close(signalFd);
+
+  gfd::stopLogger();
+
+  printStatistics(NULL);
+  writeStatistics(NULL);
+  dbus_message_free_data_slot(&gArrivalSlot);
+  {
+    uint32_t highWater = 0;
+    uint32_t fragmentHighWater = 0;
+    uint32_t i;
+    for (i = 0; i < GFD_WORKER_COUNT_MAX; i++) {
+      Scanner* scanner = &gScanners[i];
+      if (scanner->texts.highWater > highWater)
+        highWater = scanner->texts.highWater;
+      if (scanner->texts.fragmentHighWater > fragmentHighWater)
+        fragmentHighWater = scanner->texts.fragmentHighWater;
+      gfd::clearArena(&scanner->texts);
+      gfd::clearResult(&scanner->cached);
+      gfd::clearResult(&scanner->current);
+      gfd::clearFoldBuffer(&scanner->folded);
+      if (scanner->model)
+        gfd::freeDocumentModel(scanner->model);
+      scanner->model = NULL;
+    }
+    if (gScanCount) {
+      fprintf(stderr,
+              "%s: text arena high-water mark %u bytes, %u fragments\n",
+              kProductName, highWater, fragmentHighWater);
     }
   }
+  gfd::freeResultCache(gResultCache);
+  gResultCache = NULL;
+  gfd::freeBreakerTable(gBreakers);
+  gBreakers = NULL;
 
-  {
+  for (e = 0; e < eventCount; e++) {
+    const char* event = events[e];
     DBusMessage* method =
       dbus_message_new_method_call(GFD_ATSPI_REGISTRY_DESTINATION,
                                    GFD_ATSPI_REGISTRY_PATH,
@@ -581,28 +775,242 @@ int main(int argc, char* argv[]) {
   return 0;
 }
 
+DBusHandlerResult handleMessage(DBusConnection* aConnection,
+                                DBusMessage* aMessage,
+                                void* aContext) {
+  FilterContext* context = static_cast<FilterContext*>(aContext);
+
+  if (dbus_message_is_signal(aMessage, DBUS_INTERFACE_LOCAL,
+                             "Disconnected")) {
+    fprintf(stderr, "%s: disconnected from the AT-SPI bus\n", kProductName);
+    gfd::quitEventLoop(context->loop);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
+  if (dbus_message_is_method_call(aMessage, kStatsInterface,
+                                  "GetStatistics") &&
+      dbus_message_has_path(aMessage, kStatsPath)) {
+    replyStatistics(aConnection, aMessage);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
+  bool changed = false;
+#if GFD_WATCH_CHANGES
+  const char* const object = gfd::atspi::interface::kEventObject;
+  changed = dbus_message_is_signal(aMessage, object, "TextChanged") ||
+            dbus_message_is_signal(aMessage, object, "ChildrenChanged");
+#endif
+
+  if (dbus_message_is_signal(aMessage, gfd::atspi::interface::kEventDocument,
+                             "LoadComplete")) {
+    recordArrival(aMessage);
+    gfd::queueEvent(context->coalescer, aMessage);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
+  if (changed) {
+    recordArrival(aMessage);
+    passEvent(aMessage, context);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
+  /* Documents are only ever scanned by the workers. */
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+void passEvent(DBusMessage* aEvent, void* aContext) {
+  FilterContext* context = static_cast<FilterContext*>(aContext);
+
+  /* Events of one sender always go to the same worker, which knows its
+     documents. */
+  if (context->workers)
+    gfd::submitEvent(context->workers, aEvent);
+  else
+    scanEvent(context->connection, aEvent, 0, NULL);
+}
+
+void scanEvent(DBusConnection* aConnection, DBusMessage* aEvent,
+               uint32_t aWorker, void*) {
+  const gfd::CensorList* list = gfd::acquireCensorList(aWorker);
+  if (dbus_message_has_interface(aEvent, gfd::atspi::interface::kEventObject))
+    rescan(aConnection, aEvent, list, &gScanners[aWorker]);
+  else
+    filter(aConnection, aEvent, list, &gScanners[aWorker]);
+  gfd::releaseCensorList(aWorker);
+}
+
+void handleSignal(int aFd, uint32_t, void* aLoop) {
+  struct signalfd_siginfo info;
+  if (read(aFd, &info, sizeof(info)) == sizeof(info))
+    gfd::quitEventLoop(static_cast<gfd::EventLoop*>(aLoop));
+}
+
+void flushLogs(void*) {
+  gfd::flushLogs();
+}
+
+void writeStatistics(void*) {
+  sampleGauges();
+  gfd::writeMetrics(kStatsFile);
+}
+
+void replyStatistics(DBusConnection* aConnection, DBusMessage* aCall) {
+  sampleGauges();
+  char* text = gfd::formatMetrics();
+  DBusMessage* reply =
+    text? dbus_message_new_method_return(aCall) :
+          dbus_message_new_error(aCall, DBUS_ERROR_NO_MEMORY, NULL);
+  if (reply && text &&
+      !dbus_message_append_args(reply, DBUS_TYPE_STRING, &text,
+                                DBUS_TYPE_INVALID)) {
+    dbus_message_unref(reply);
+    reply = NULL;
+  }
+  if (reply) {
+    dbus_connection_send(aConnection, reply, NULL);
+    dbus_message_unref(reply);
+  }
+  free(text);
+}
+
+void sampleGauges() {
+  if (!gBreakers)
+    return;
+  gfd::BreakerStatistics breakers;
+  gfd::getBreakerStatistics(gBreakers, monotonicMilliseconds(), &breakers);
+  gfd::setGauge(gfd::eGaugeOpenBreakers, breakers.open);
+}
+
+void recordArrival(DBusMessage* aEvent) {
+  if (gArrivalSlot < 0)
+    return;
+  uint64_t* arrival = static_cast<uint64_t*>(malloc(sizeof(uint64_t)));
+  if (!arrival)
+    return;
+  *arrival = gfd::metricsClock();
+  if (!dbus_message_set_data(aEvent, gArrivalSlot, arrival, free))
+    free(arrival);
+}
+
+/* Adds what one event cost to the metrics; aStatistics is NULL if it was
+ * dropped without a walk. */
+void recordEvent(DBusMessage* aEvent, const WalkStatistics* aStatistics) {
+  if (aStatistics) {
+    gfd::addCounter(gfd::eCounterEvents, 1);
+    gfd::addCounter(gfd::eCounterRoundTrips, aStatistics->roundTrips);
+    gfd::addCounter(gfd::eCounterNodes, aStatistics->nodes);
+    gfd::addCounter(gfd::eCounterTexts, aStatistics->texts);
+    gfd::addCounter(gfd::eCounterCallTimeouts, aStatistics->timeouts);
+    gfd::recordValue(gfd::eHistogramEventRoundTrips,
+                     aStatistics->roundTrips);
+    gfd::recordValue(gfd::eHistogramEventNodes, aStatistics->nodes);
+    gfd::recordValue(gfd::eHistogramEventBytes, aStatistics->bytes);
+
+    const uint32_t truncated = aStatistics->truncated;
+    if (truncated) {
+      gfd::addCounter(gfd::eCounterTruncated, 1);
+      gfd::addCounter(gfd::eCounterTruncatedNodes,
+                      (truncated & eTruncatedNodes)? 1 : 0);
+      gfd::addCounter(gfd::eCounterTruncatedBytes,
+                      (truncated & eTruncatedBytes)? 1 : 0);
+      gfd::addCounter(gfd::eCounterTruncatedDepth,
+                      (truncated & eTruncatedDepth)? 1 : 0);
+      gfd::addCounter(gfd::eCounterTruncatedDeadline,
+                      (truncated & eTruncatedDeadline)? 1 : 0);
+      gfd::addCounter(gfd::eCounterTruncatedTimeout,
+                      (truncated & eTruncatedTimeout)? 1 : 0);
+      gfd::addCounter(gfd::eCounterTruncatedMemory,
+                      (truncated & eTruncatedMemory)? 1 : 0);
+    }
+  }
+
+  if (gArrivalSlot < 0)
+    return;
+  const uint64_t* arrival =
+    static_cast<const uint64_t*>(dbus_message_get_data(aEvent, gArrivalSlot));
+  if (arrival)
+    gfd::recordValue(gfd::eHistogramEventLatency,
+                     gfd::metricsClock() - *arrival);
+}
+
+void printStatistics(void*) {
+  uint32_t scanCount = __atomic_load_n(&gScanCount, __ATOMIC_RELAXED);
+  uint32_t changeCount = __atomic_load_n(&gChangeCount, __ATOMIC_RELAXED);
+  if (scanCount == gReportedScanCount && changeCount == gReportedChangeCount)
+    return;
+  gReportedScanCount = scanCount;
+  gReportedChangeCount = changeCount;
+
+  fprintf(stderr,
+          "%s: %u scans, %u round trips, %u nodes, %u texts, "
+          "%u cancelled, %u truncated\n",
+          kProductName, scanCount,
+          __atomic_load_n(&gWalkTotals.roundTrips, __ATOMIC_RELAXED),
+          __atomic_load_n(&gWalkTotals.nodes, __ATOMIC_RELAXED),
+          __atomic_load_n(&gWalkTotals.texts, __ATOMIC_RELAXED),
+          __atomic_load_n(&gWalkTotals.cancelled, __ATOMIC_RELAXED),
+          __atomic_load_n(&gTruncatedCount, __ATOMIC_RELAXED));
+  if (gResultCache) {
+    fprintf(stderr, "%s: result cache %u hits, %u misses\n", kProductName,
+            __atomic_load_n(&gResultCacheHits, __ATOMIC_RELAXED),
+            __atomic_load_n(&gResultCacheMisses, __ATOMIC_RELAXED));
+  }
+  if (gCoalescerStatistics.merged || gCoalescerStatistics.nested) {
+    fprintf(stderr,
+            "%s: %u of %u LoadComplete signals coalesced (%u repeated, "
+            "%u nested), %u round trips\n",
+            kProductName,
+            gCoalescerStatistics.merged + gCoalescerStatistics.nested,
+            gCoalescerStatistics.received, gCoalescerStatistics.merged,
+            gCoalescerStatistics.nested, gCoalescerStatistics.roundTrips);
+  }
+  if (changeCount) {
+    fprintf(stderr,
+            "%s: %u changes, %u round trips, %u nodes, %u texts\n",
+            kProductName, changeCount,
+            __atomic_load_n(&gChangeTotals.roundTrips, __ATOMIC_RELAXED),
+            __atomic_load_n(&gChangeTotals.nodes, __ATOMIC_RELAXED),
+            __atomic_load_n(&gChangeTotals.texts, __ATOMIC_RELAXED));
+  }
+  if (gBreakers) {
+    gfd::BreakerStatistics breakers;
+    gfd::getBreakerStatistics(gBreakers, monotonicMilliseconds(), &breakers);
+    uint32_t timeouts =
+      __atomic_load_n(&gWalkTotals.timeouts, __ATOMIC_RELAXED) +
+      __atomic_load_n(&gChangeTotals.timeouts, __ATOMIC_RELAXED);
+    if (timeouts || breakers.trips) {
+      fprintf(stderr,
+              "%s: %u calls timed out, %u breaker trips, %u events "
+              "skipped, %u breakers open\n",
+              kProductName, timeouts, breakers.trips, breakers.skipped,
+              breakers.open);
+    }
+  }
+}
+
 DBusHandlerResult filter(DBusConnection* aConnection,
                          DBusMessage* aMessage,
-                         const CensorWordList* aCensorWordList) {
+                         const gfd::CensorList* aList,
+                         Scanner* aScanner) {
 #ifndef NDEBUG
 //  mtrace();
 #endif
+  const gfd::Matcher* matcher = aList->matcher;
   GFD_DUMP_DBUS_CONNECTION(aConnection);
   GFD_DUMP_DBUS_MESSAGE(aMessage);
 
+  /* Only LoadComplete signals get here, through scanEvent(); late replies
+     and NameAcquired are dropped by the worker that owns the connection. */
+  assert(dbus_message_is_signal(aMessage,
+                                gfd::atspi::interface::kEventDocument,
+                                "LoadComplete"));
+
   const char* sender = dbus_message_get_sender(aMessage);
   const char* path = dbus_message_get_path(aMessage);
 
   if (!sender || !path)
     return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 
-  if (0 == strncmp(DBUS_SERVICE_DBUS, sender, sizeof(DBUS_SERVICE_DBUS))) {
-    /* This is probably "NameAcquired" nottification. */
-    assert(0 == strncmp("NameAcquired", dbus_message_get_member(aMessage),
-                        sizeof("NameAcquired")));
-    return DBUS_HANDLER_RESULT_HANDLED;
-  }
-
   DBusError error;
   dbus_error_init(&error);
 
@@ -630,6 +1038,16 @@ DBusHandlerResult filter(DBusConnection* aConnection,
     }
   }
 
+  /* A page of an application whose breaker is open is not scanned, but its
+     visit is still logged, with as much of the URL as it answers quickly. */
+  const bool admitted = !gBreakers ||
+    gfd::admitSender(gBreakers, sender, monotonicMilliseconds());
+
+  /* Everything asked for this event shares one deadline. */
+  const uint64_t deadline = admitted? eventDeadline() :
+    monotonicMilliseconds() + GFD_SKIPPED_URL_TIMEOUT;
+  bool timedOut = false;
+
   /* Query URL via DBUS */
   DBusMessage* urlMessage(NULL);
   char* url(NULL);
@@ -653,11 +1071,12 @@ DBusHandlerResult filter(DBusConnection* aConnection,
     urlMessage =
       dbus_connection_send_with_reply_and_block(aConnection,
                                                 method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
+                                                callTimeout(deadline),
                                                 &error);
 
     dbus_message_unref(method);
 
+    timedOut = isCallTimeout(&error, deadline);
     GFD_CHECK_DBUS_ERROR(&error);
 
     if (urlMessage) {
@@ -669,48 +1088,166 @@ DBusHandlerResult filter(DBusConnection* aConnection,
     }
   }
 
-  /* Compose ISO 8601 datetime */
   char datetime[sizeof("0000-00-00T00:00:00")];
-  {
-    time_t now = time(NULL);
-    tm* gmt = gmtime(&now);
-#ifndef NDEBUG
-    size_t len =
+  formatDatetime(datetime, sizeof(datetime));
+
+  gfd::flogf(gMonitorLog, "d=%s+0000\nt=%s\nu=%s\n\n", datetime, title, url);
+
+  if (!admitted) {
+    recordEvent(aMessage, NULL);
+    if (urlMessage)
+      dbus_message_unref(urlMessage);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
+
+  const bool skipped = url && aList->skip && gfd::isSkipped(aList->skip, url);
+  if (skipped) {
+    gfd::addCounter(gfd::eCounterSkipListed, 1);
+    recordEvent(aMessage, NULL);
+#if GFD_WATCH_CHANGES
+    /* Forget what was there before; rescan() knows the URL is skipped. */
+    if (matcher && matcher->count() && aScanner->model) {
+      gfd::openDocument(aScanner->model, sender, path, title, url,
+                        aList->generation, matcher->count());
+    }
 #endif
-    strftime(datetime, sizeof(datetime), "%FT%H:%M:%S", gmt);
-    assert((sizeof("0000-00-00T00:00:00") - 1) == len);
-    assert('\0' == datetime[len]);
   }
+  else if (matcher) {
+    const uint32_t count = matcher->count();
+    uint8_t* hits = static_cast<uint8_t*>(calloc(count, 1));
+    if (!hits) {
+      if (urlMessage)
+        dbus_message_unref(urlMessage);
+      return DBUS_HANDLER_RESULT_NEED_MEMORY;
+    }
+
+    WalkStatistics statistics;
+    memset(&statistics, 0, sizeof(statistics));
+    statistics.roundTrips = 1; /* DocURL */
+    if (timedOut) {
+      /* Not worth walking. */
+      statistics.timeouts = 1;
+      statistics.truncated = eTruncatedTimeout;
+    }
 
-  flogf(kMonitorLogFile, "d=%s+0000\nt=%s\nu=%s\n\n", datetime, title, url);
+    /* Fragments are matched as they arrive, and the walk stops once there
+       is nothing left to find. */
+    PageScan scan;
+    scan.matcher = matcher;
+    scan.folded = &aScanner->folded;
+    scan.hits = hits;
+    scan.found = 0;
+    scan.stopped = false;
+    scan.current = NULL;
+    scan.cached = NULL;
+    scan.model = NULL;
+    scan.document = NULL;
+    scan.sender = sender;
+    scan.changesOnly = false;
+
+#if GFD_WATCH_CHANGES
+    /* Start over the model of the document, for the change events to
+       come. */
+    if (count && !aScanner->model)
+      aScanner->model = gfd::newDocumentModel();
+    if (count && aScanner->model) {
+      scan.model = aScanner->model;
+      scan.document = gfd::openDocument(scan.model, sender, path, title, url,
+                                        aList->generation, count);
+    }
+#endif
 
-  if (aCensorWordList) {
-    const CensorWordList* words = aCensorWordList;
-    TextFragmentList* texts = copyTexts(aConnection, sender, path, NULL);
+    gfd::TextArena* texts = &aScanner->texts;
+    gfd::resetArena(texts);
+
+    if (gResultCache && url && *url && count) {
+      scan.current = &aScanner->current;
+      scan.current->count = 0;
+      if (gfd::lookupResult(gResultCache, url, aList->generation,
+                            &aScanner->cached))
+        scan.cached = &aScanner->cached;
+    }
 
-    while(words) {
-      bool hit = censor(texts, words->data);
-      if (hit) {
-        flogf(kCensorLogFile, "k=%s\nd=%s+0000\nt=%s\nu=%s\n\n",
-              words->data, datetime, title, url);
+    if (count && !timedOut) {
+      copyTexts(aConnection, sender, path, texts, matcher->longestKeyword(),
+                deadline, scanFragment, &scan, &statistics);
+      timedOut = statistics.timeouts;
+    }
+
+    /* Every fragment hashed the same as last time: so do the hits. */
+    bool reused = scan.cached && texts->count == scan.cached->count &&
+                  count == scan.cached->keywordCount;
+    if (reused) {
+      memcpy(hits, scan.cached->hits, count);
+    }
+    else if (scan.cached) {
+      /* The page only lost fragments at its end. */
+      scan.cached = NULL;
+      uint32_t i;
+      for (i = 0; i < texts->count && !scan.stopped; i++) {
+        if (!texts->fragments[i].transient)
+          scan.stopped = !matchFragment(&scan, texts, i);
       }
-      words = words->next;
     }
 
-    /* release memory allocated by g_strdup(). */
-    while (texts) {
-#ifndef NDEBUG
-        printf("%s\n", texts->data);
-#endif
-      free(texts->data);
+    if (scan.current) {
+      __atomic_add_fetch(reused? &gResultCacheHits : &gResultCacheMisses, 1,
+                         __ATOMIC_RELAXED);
+      scan.current->stoppedEarly = scan.stopped;
+      if (gfd::setHits(scan.current, hits, count))
+        gfd::storeResult(gResultCache, url, aList->generation,
+                         scan.current);
+    }
 
-      TextFragmentList* oldNode = texts;
-      texts = texts->next;
+    if (scan.document) {
+      memcpy(scan.document->hits, hits, count);
+      scan.document->found = 0;
+      uint32_t i;
+      for (i = 0; i < count; i++)
+        scan.document->found += hits[i];
+    }
 
-      delete oldNode;
+#ifndef NDEBUG
+    printf("scan: %u round trips, %u nodes, %u texts, %u cancelled%s%s\n",
+           statistics.roundTrips, statistics.nodes, statistics.texts,
+           statistics.cancelled, reused? ", cached result" : "",
+           statistics.truncated? ", truncated" : "");
+#endif
+    __atomic_add_fetch(&gWalkTotals.roundTrips, statistics.roundTrips,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&gWalkTotals.nodes, statistics.nodes,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&gWalkTotals.texts, statistics.texts,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&gWalkTotals.cancelled, statistics.cancelled,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&gWalkTotals.timeouts, statistics.timeouts,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&gScanCount, 1, __ATOMIC_RELAXED);
+    recordEvent(aMessage, &statistics);
+
+    uint32_t i;
+    for (i = 0; i < count; i++) {
+      /* censor() is the reference implementation, of literals in the text
+         that is still there. */
+      assert(gfd::isPattern(matcher->keyword(i)) || texts->dropped ||
+             bool(hits[i]) == censor(texts, matcher->keyword(i)));
+      if (hits[i]) {
+        gfd::flogf(gCensorLog, "k=%s\nd=%s+0000\nt=%s\nu=%s\n\n",
+                   matcher->keyword(i), datetime, title, url);
+      }
     }
+    logTruncation(datetime, title, url, statistics.truncated);
+    free(hits);
 
+#ifndef NDEBUG
+    for (i = 0; i < texts->count; i++)
+      printf("%s\n", gfd::fragmentText(texts, i));
+#endif
+    gfd::resetArena(texts);
   }
+  if (gBreakers)
+    gfd::reportSender(gBreakers, sender, timedOut, monotonicMilliseconds());
   if (urlMessage)
     dbus_message_unref(urlMessage);
 #ifndef NDEBUG
@@ -719,309 +1256,382 @@ DBusHandlerResult filter(DBusConnection* aConnection,
   return DBUS_HANDLER_RESULT_HANDLED;
 }
 
-bool censor(const TextFragmentList* aFragment, const char* aKeyword) {
-  const TextFragmentList* fragment = aFragment;
-  while (fragment) {
-    assert(fragment->data);
-    if (strcasestr(fragment->data, aKeyword))
-      return true;
-    fragment = fragment->next;
-  }
-  return false;
-}
-
-TextFragmentList* copyTexts(DBusConnection* aConnection,
-                            const char* aDestination,
-                            const char* aPath,
-                            TextFragmentList* aLatestNode) {
+/* Handles object:text-changed and object:children-changed: only the text of
+ * the object, or of the children that have been added, is scanned, and only
+ * if it belongs to a document that still lacks some keywords. Keywords that
+ * were not in the document before are logged like those of a LoadComplete
+ * scan. Removals are ignored: what has been found stays found. */
+DBusHandlerResult rescan(DBusConnection* aConnection,
+                         DBusMessage* aEvent,
+                         const gfd::CensorList* aList,
+                         Scanner* aScanner) {
+  GFD_DUMP_DBUS_MESSAGE(aEvent);
+
+  const gfd::Matcher* matcher = aList->matcher;
+  const char* sender = dbus_message_get_sender(aEvent);
+  const char* path = dbus_message_get_path(aEvent);
+  if (!matcher || !matcher->count() || !sender || !path)
+    return DBUS_HANDLER_RESULT_HANDLED;
 
-  DBusError error;
-  dbus_error_init(&error);
+  if (gBreakers &&
+      !gfd::admitSender(gBreakers, sender, monotonicMilliseconds())) {
+    recordEvent(aEvent, NULL);
+    return DBUS_HANDLER_RESULT_HANDLED;
+  }
 
-  bool isText(false);
+  /* (detail, detail1, detail2, any_data, ...); for children-changed,
+     any_data is the child as (so). */
+  const char* detail(NULL);
+  const char* childSender(NULL);
+  const char* childPath(NULL);
   {
-    DBusMessage* method =
-      dbus_message_new_method_call(aDestination, aPath,
-                                   gfd::atspi::interface::kAccessible,
-                                   "GetInterfaces");
-    if (!method)
-      return aLatestNode;
-
-    DBusMessage* response =
-      dbus_connection_send_with_reply_and_block(aConnection,
-                                                method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
-                                                &error);
-
-    dbus_message_unref(method);
-
-    GFD_CHECK_DBUS_ERROR(&error);
-
-    if (response) {
-      DBusMessageIter aiter;
-      dbus_message_iter_init(response, &aiter);
-      int type = dbus_message_iter_get_arg_type(&aiter);
-      if (DBUS_TYPE_ARRAY == type) {
+    DBusMessageIter iter;
+    dbus_message_iter_init(aEvent, &iter);
+    if (DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&iter))
+      dbus_message_iter_get_basic(&iter, &detail);
+
+    int type = dbus_message_iter_get_arg_type(&iter);
+    while (type != DBUS_TYPE_INVALID && type != DBUS_TYPE_VARIANT) {
+      dbus_message_iter_next(&iter);
+      type = dbus_message_iter_get_arg_type(&iter);
+    }
+    if (DBUS_TYPE_VARIANT == type) {
+      DBusMessageIter viter;
+      dbus_message_iter_recurse(&iter, &viter);
+      if (DBUS_TYPE_STRUCT == dbus_message_iter_get_arg_type(&viter)) {
         DBusMessageIter siter;
-        dbus_message_iter_recurse(&aiter, &siter);
-        type = dbus_message_iter_get_arg_type(&siter);
-        while (DBUS_TYPE_STRING == type) {
-          const char* interface;
-          dbus_message_iter_get_basic(&siter, &interface);
-          if(0 == strncmp(gfd::atspi::interface::kText, interface,
-                          sizeof(GFD_ATSPI_INTERFACE_TEXT))) {
-            isText = true;
-            break;
-          }
+        dbus_message_iter_recurse(&viter, &siter);
+        if (DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&siter)) {
+          dbus_message_iter_get_basic(&siter, &childSender);
           dbus_message_iter_next(&siter);
-          type = dbus_message_iter_get_arg_type(&siter);
+          if (DBUS_TYPE_OBJECT_PATH == dbus_message_iter_get_arg_type(&siter))
+            dbus_message_iter_get_basic(&siter, &childPath);
         }
       }
-      dbus_message_unref(response);
     }
   }
+  if (!detail)
+    return DBUS_HANDLER_RESULT_HANDLED;
 
-  /* Query URL via DBUS */
-  int characterCount(0);
-  if (isText) {
-    DBusMessage* method =
-      dbus_message_new_method_call (aDestination, aPath,
-                                    DBUS_INTERFACE_PROPERTIES,
-                                    "Get");
-    if (!method)
-      return aLatestNode;
-
-    static const char* const attribute = "CharacterCount";
-
-    bool succeeded =
-      dbus_message_append_args(method,
-                               DBUS_TYPE_STRING, &gfd::atspi::interface::kText,
-                               DBUS_TYPE_STRING, &attribute,
-                               DBUS_TYPE_INVALID);
-    if (!succeeded) {
-      dbus_message_unref(method);
-      return aLatestNode;
-    }
-
-    DBusMessage* response =
-      dbus_connection_send_with_reply_and_block(aConnection,
-                                                method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
-                                                &error);
-
-    dbus_message_unref(method);
-
-    GFD_CHECK_DBUS_ERROR(&error);
-    if (response) {
-      DBusMessageIter viter;
-      dbus_message_iter_init(response, &viter);
-      int type = dbus_message_iter_get_arg_type(&viter);
-
-      //GFD_DUMP_DBUS_MESSAGE(response);
-        if (DBUS_TYPE_VARIANT == type) {
-          DBusMessageIter iiter;
-          dbus_message_iter_recurse(&viter, &iiter);
-          type = dbus_message_iter_get_arg_type(&iiter);
-
-          if (DBUS_TYPE_INT32 == type) {
-            dbus_message_iter_get_basic(&iiter, &characterCount);
-          }
-        }
-      dbus_message_unref(response);
-    }
+  bool children = dbus_message_is_signal(aEvent,
+                                         gfd::atspi::interface::kEventObject,
+                                         "ChildrenChanged");
+  if (children) {
+    if (0 != strncmp(detail, "add", sizeof("add") - 1) || !childPath ||
+        0 == strcmp(childPath, GFD_ATSPI_NULL_PATH))
+      return DBUS_HANDLER_RESULT_HANDLED;
+    if (!childSender || !*childSender)
+      childSender = sender;
+  }
+  else if (0 == strncmp(detail, "delete", sizeof("delete") - 1)) {
+    return DBUS_HANDLER_RESULT_HANDLED;
   }
 
-  TextFragmentList* result(aLatestNode);
-
-  if (isText && characterCount > 2) {
-    DBusMessage* method =
-      dbus_message_new_method_call (aDestination, aPath,
-                                    gfd::atspi::interface::kText,
-                                    "GetText");
-    if (!method)
-      return aLatestNode;
+  if (!aScanner->model) {
+    aScanner->model = gfd::newDocumentModel();
+    if (!aScanner->model)
+      return DBUS_HANDLER_RESULT_NEED_MEMORY;
+  }
 
-    static const int32_t start(0);
+  WalkStatistics statistics;
+  memset(&statistics, 0, sizeof(statistics));
+
+  const uint64_t deadline = eventDeadline();
+  const uint32_t count = matcher->count();
+  gfd::Document* document = findDocument(aConnection, aScanner->model,
+                                         sender, path, deadline,
+                                         &statistics);
+  bool complete = !document || document->generation != aList->generation ||
+                  document->found == count ||
+                  (document->url && aList->skip &&
+                   gfd::isSkipped(aList->skip, document->url));
+#if GFD_CENSOR_FIRST_HIT
+  complete = complete || document->found;
+#endif
 
-    bool succeeded =
-      dbus_message_append_args(method,
-                               DBUS_TYPE_INT32, &start,
-                               DBUS_TYPE_INT32, &characterCount,
-                               DBUS_TYPE_INVALID);
-    if (!succeeded) {
-      dbus_message_unref(method);
-      return aLatestNode;
+  if (!complete) {
+    uint8_t* hits = static_cast<uint8_t*>(malloc(count));
+    if (!hits)
+      return DBUS_HANDLER_RESULT_NEED_MEMORY;
+    memcpy(hits, document->hits, count);
+
+    PageScan scan;
+    scan.matcher = matcher;
+    scan.folded = &aScanner->folded;
+    scan.hits = hits;
+    scan.found = document->found;
+    scan.stopped = false;
+    scan.current = NULL;
+    scan.cached = NULL;
+    scan.model = aScanner->model;
+    scan.document = document;
+    scan.changesOnly = true;
+
+    gfd::TextArena* texts = &aScanner->texts;
+    gfd::resetArena(texts);
+
+    if (children) {
+      scan.sender = childSender;
+      if (gfd::addNode(scan.model, childSender, childPath, document)) {
+        copyTexts(aConnection, childSender, childPath, texts,
+                  matcher->longestKeyword(), deadline, scanFragment, &scan,
+                  &statistics);
+      }
+    }
+    else {
+      scan.sender = sender;
+      copyText(aConnection, sender, path, texts, matcher->longestKeyword(),
+               deadline, scanFragment, &scan, &statistics);
     }
 
-    DBusMessage* response =
-      dbus_connection_send_with_reply_and_block(aConnection,
-                                                method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
-                                                &error);
-
-    dbus_message_unref(method);
-
-    GFD_CHECK_DBUS_ERROR(&error);
+    char datetime[sizeof("0000-00-00T00:00:00")];
+    formatDatetime(datetime, sizeof(datetime));
 
-    if (response) {
-      const char* data(NULL);
-      //GFD_DUMP_DBUS_MESSAGE(response);
-      succeeded = dbus_message_get_args(response, &error,
-                                       DBUS_TYPE_STRING, &data,
-                                       DBUS_TYPE_INVALID);
-      GFD_CHECK_DBUS_ERROR(&error);
-      if (succeeded && data) {
-        char* str = strdup(data);
-        TextFragmentList* node = new TextFragmentList();
-        node->data = str;
-        node->next = result;
-        result = node;
+    uint32_t i;
+    for (i = 0; i < count; i++) {
+      if (hits[i] && !document->hits[i]) {
+        gfd::flogf(gCensorLog, "k=%s\nd=%s+0000\nt=%s\nu=%s\n\n",
+                   matcher->keyword(i), datetime, document->title,
+                   document->url);
+        document->hits[i] = 1;
       }
-      dbus_message_unref(response);
     }
+    logTruncation(datetime, document->title, document->url,
+                  statistics.truncated);
+    document->found = scan.found;
+    free(hits);
+    gfd::resetArena(texts);
   }
 
-  int childCount(0);
-  {
-    DBusMessage* method =
-      dbus_message_new_method_call(aDestination, aPath,
-                                   DBUS_INTERFACE_PROPERTIES,
-                                   "Get");
-    if (!method)
-      return result;
-
-    static const char* const attribute = "ChildCount";
+#ifndef NDEBUG
+  printf("change: %u round trips, %u nodes, %u texts%s%s\n",
+         statistics.roundTrips, statistics.nodes, statistics.texts,
+         complete? ", skipped" : "", statistics.truncated? ", truncated" : "");
+#endif
+  __atomic_add_fetch(&gChangeTotals.roundTrips, statistics.roundTrips,
+                     __ATOMIC_RELAXED);
+  __atomic_add_fetch(&gChangeTotals.nodes, statistics.nodes,
+                     __ATOMIC_RELAXED);
+  __atomic_add_fetch(&gChangeTotals.texts, statistics.texts,
+                     __ATOMIC_RELAXED);
+  __atomic_add_fetch(&gChangeTotals.timeouts, statistics.timeouts,
+                     __ATOMIC_RELAXED);
+  __atomic_add_fetch(&gChangeCount, 1, __ATOMIC_RELAXED);
+  recordEvent(aEvent, &statistics);
+  if (gBreakers) {
+    gfd::reportSender(gBreakers, sender, statistics.timeouts,
+                      monotonicMilliseconds());
+  }
+  return DBUS_HANDLER_RESULT_HANDLED;
+}
 
-    bool succeeded =
-      dbus_message_append_args(method, DBUS_TYPE_STRING,
-                               &gfd::atspi::interface::kAccessible,
-                               DBUS_TYPE_STRING, &attribute,
-                               DBUS_TYPE_INVALID);
-    if (!succeeded) {
-      dbus_message_unref(method);
-      return result;
+/* Returns the document the object belongs to, asking for its ancestors
+ * until one of them is known; they are all recorded on the way. */
+gfd::Document* findDocument(DBusConnection* aConnection,
+                            gfd::DocumentModel* aModel,
+                            const char* aSender, const char* aPath,
+                            uint64_t aDeadline,
+                            WalkStatistics* aStatistics) {
+  gfd::ModelNode* node = gfd::findNode(aModel, aSender, aPath);
+  if (node)
+    return node->document;
+
+  char* senders[GFD_WATCH_MAX_DEPTH + 1];
+  char* paths[GFD_WATCH_MAX_DEPTH + 1];
+  senders[0] = strdup(aSender);
+  paths[0] = strdup(aPath);
+  uint32_t depth = 1;
+
+  gfd::Document* document(NULL);
+  bool resolved = false;
+  while (senders[depth - 1] && paths[depth - 1] &&
+         depth <= GFD_WATCH_MAX_DEPTH) {
+    char* parentSender(NULL);
+    char* parentPath(NULL);
+    if (!getParent(aConnection, senders[depth - 1], paths[depth - 1],
+                   aDeadline, &parentSender, &parentPath, aStatistics)) {
+      /* The root of the application: outside of any document. Unless it
+         didn't answer, in which case nothing is known. */
+      if (aDeadline && monotonicMilliseconds() >= aDeadline)
+        aStatistics->truncated |= eTruncatedDeadline;
+      resolved = !(aStatistics->truncated &
+                   (eTruncatedDeadline | eTruncatedTimeout));
+      break;
     }
 
-    DBusMessage* response =
-      dbus_connection_send_with_reply_and_block(aConnection,
-                                                method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
-                                                &error);
-
-    dbus_message_unref(method);
-
-    GFD_CHECK_DBUS_ERROR(&error);
-
-    if (response) {
-      DBusMessageIter viter;
-      dbus_message_iter_init(response, &viter);
-      int type = dbus_message_iter_get_arg_type(&viter);
-
-      //GFD_DUMP_DBUS_MESSAGE(response);
-      while (type != DBUS_TYPE_INVALID) {
-        if (DBUS_TYPE_VARIANT == type) {
-          DBusMessageIter siter;
-          dbus_message_iter_recurse(&viter, &siter);
-          type = dbus_message_iter_get_arg_type(&siter);
-
-          if (DBUS_TYPE_INT32 == type) {
-            dbus_message_iter_get_basic(&siter, &childCount);
-            break;
-          }
-        }
-
-        dbus_message_iter_next(&viter);
-        type = dbus_message_iter_get_arg_type(&viter);
-      }
-      dbus_message_unref(response);
+    node = gfd::findNode(aModel, parentSender, parentPath);
+    if (node) {
+      document = node->document;
+      resolved = true;
+      free(parentSender);
+      free(parentPath);
+      break;
     }
+    senders[depth] = parentSender;
+    paths[depth] = parentPath;
+    depth++;
   }
 
-  int i;
-  for (i = 0; i < childCount; i++) {
-    DBusMessage* method =
-      dbus_message_new_method_call(aDestination, aPath,
-                                   gfd::atspi::interface::kAccessible,
-                                   "GetChildAtIndex");
-    if (!method)
-      return result;
+  uint32_t i;
+  for (i = 0; i < depth; i++) {
+    if (resolved && senders[i] && paths[i])
+      gfd::addNode(aModel, senders[i], paths[i], document);
+    free(senders[i]);
+    free(paths[i]);
+  }
+  return document;
+}
 
-    bool succeeded = dbus_message_append_args(method,
-                                              DBUS_TYPE_INT32, &i,
-                                              DBUS_TYPE_INVALID);
-    if (!succeeded) {
-      dbus_message_unref(method);
-      return result;
-    }
+/* Composes ISO 8601 datetime */
+void formatDatetime(char* aDatetime, size_t aSize) {
+  assert(sizeof("0000-00-00T00:00:00") == aSize);
 
-    DBusMessage* response =
-      dbus_connection_send_with_reply_and_block(aConnection,
-                                                method,
-                                                DBUS_TIMEOUT_USE_DEFAULT,
-                                                &error);
+  time_t now = time(NULL);
+  tm gmt;
+  gmtime_r(&now, &gmt);
+#ifndef NDEBUG
+  size_t len =
+#endif
+  strftime(aDatetime, aSize, "%FT%H:%M:%S", &gmt);
+  assert((sizeof("0000-00-00T00:00:00") - 1) == len);
+  assert('\0' == aDatetime[len]);
+}
 
-    dbus_message_unref(method);
+/* Records in censor.log that the page has not been scanned to the end:
+ * aTruncated tells which budgets ran out. Nothing if it is 0. */
+void logTruncation(const char* aDatetime, const char* aTitle, const char* aUrl,
+                   uint32_t aTruncated) {
+  if (!aTruncated)
+    return;
 
-    GFD_CHECK_DBUS_ERROR(&error);
+  static const char* const kReasons[] = { "nodes", "bytes", "depth",
+                                          "deadline", "timeout", "memory" };
+  char reasons[sizeof("nodes, bytes, depth, deadline, timeout, memory")];
+  reasons[0] = '\0';
+  uint32_t i;
+  for (i = 0; i < sizeof(kReasons) / sizeof(kReasons[0]); i++) {
+    if (aTruncated & (1 << i)) {
+      if (reasons[0])
+        strcat(reasons, ", ");
+      strcat(reasons, kReasons[i]);
+    }
+  }
 
-    if (response) {
-      DBusMessageIter parentIter;
-      dbus_message_iter_init(response, &parentIter);
-      int type = dbus_message_iter_get_arg_type(&parentIter);
-      char* signature = dbus_message_iter_get_signature(&parentIter);
+  gfd::flogf(gCensorLog, "x=truncated: %s\nd=%s+0000\nt=%s\nu=%s\n\n",
+             reasons, aDatetime, aTitle, aUrl);
+  __atomic_add_fetch(&gTruncatedCount, 1, __ATOMIC_RELAXED);
+}
 
-      //GFD_DUMP_DBUS_MESSAGE(response);
-      if (DBUS_TYPE_STRUCT == type &&
-          0 == strncmp("(so)", signature, sizeof("(so)"))) {
-        DBusMessageIter childIter;
-        dbus_message_iter_recurse(&parentIter, &childIter);
-        type = dbus_message_iter_get_arg_type(&childIter);
+bool scanFragment(const gfd::TextArena* aTexts, uint32_t aIndex,
+                  const char* aPath, void* aScan) {
+  PageScan* scan = static_cast<PageScan*>(aScan);
 
-        const char* destination(NULL);
-        if (DBUS_TYPE_STRING == type) {
-          dbus_message_iter_get_basic(&childIter, &destination);
-        }
-        else {
-          /* catch error */
-        }
+  uint64_t hash = 0;
+  if (scan->document || scan->current) {
+    hash = gfd::hash64(gfd::fragmentText(aTexts, aIndex),
+                       aTexts->fragments[aIndex].length);
+  }
 
-        dbus_message_iter_next(&childIter);
-        type = dbus_message_iter_get_arg_type(&childIter);
+  if (scan->document) {
+    gfd::ModelNode* node = gfd::addNode(scan->model, scan->sender, aPath,
+                                        scan->document);
+    if (node) {
+      /* A window of a long text says nothing of the whole text, which is
+         scanned again on every change. */
+      const uint64_t textHash =
+        aTexts->fragments[aIndex].transient? 0 : hash;
+      bool unchanged = textHash && node->textHash == textHash;
+      node->textHash = textHash;
+      if (scan->changesOnly && unchanged)
+        return true;
+    }
+  }
 
-        const char* path(NULL);
-        if (DBUS_TYPE_OBJECT_PATH == type) {
-          dbus_message_iter_get_basic(&childIter, &path);
+  if (scan->current) {
+    if (!gfd::appendHash(scan->current, hash))
+      scan->current = NULL;
+
+    const gfd::ScanResult* cached = scan->cached;
+    if (cached && scan->current) {
+      if (aIndex < cached->count && hash == cached->hashes[aIndex]) {
+        /* Last time the walk stopped here. */
+        if (aIndex + 1 == cached->count && cached->stoppedEarly) {
+          scan->stopped = true;
+          return false;
         }
-        else {
-          /* catch error */
+        /* A window of a long text is dropped after this: it can't wait. */
+        if (aTexts->fragments[aIndex].transient &&
+            !matchFragment(scan, aTexts, aIndex)) {
+          scan->stopped = true;
+          return false;
         }
+        return true;
+      }
+    }
 
-        if (path && destination) {
-          result = copyTexts(aConnection,destination, path, result);
+    if (cached) {
+      /* The page has changed: match what was deferred. */
+      scan->cached = NULL;
+      uint32_t i;
+      for (i = 0; i < aIndex; i++) {
+        if (!aTexts->fragments[i].transient &&
+            !matchFragment(scan, aTexts, i)) {
+          scan->stopped = true;
+          return false;
         }
       }
-      dbus_free(signature);
-      dbus_message_unref(response);
     }
   }
-  return result;
-}
 
-inline void flogf(const char* aFilename, const char* aFormat, ...) {
-  /* This is a little dangerous for compiler doesn't check arg types. */
-  FILE* fp = fopen(aFilename, "a");
-  if (!fp) {
-    perror(aFilename);
-    return;
+  if (!matchFragment(scan, aTexts, aIndex)) {
+    scan->stopped = true;
+    return false;
   }
+  return true;
+}
 
-  va_list args;
-  va_start(args, aFormat);
-  int count = vfprintf(fp, aFormat, args);
-  va_end(args);
+/* One pass over each fragment finds every keyword at once; the fragment is
+ * case folded first, once. Returns false if there is no need to match any
+ * more fragments. */
+bool matchFragment(PageScan* aScan, const gfd::TextArena* aTexts,
+                   uint32_t aIndex) {
+  const uint64_t start = gfd::metricsClock();
+  const gfd::TextFragment* fragment = &aTexts->fragments[aIndex];
+  size_t length;
+  const char* text = gfd::foldText(aScan->folded,
+                                   gfd::fragmentText(aTexts, aIndex),
+                                   fragment->length, &length);
+  uint32_t found = aScan->matcher->scan(text, length, aScan->hits,
+                                        fragment->wordBefore,
+                                        fragment->wordAfter);
+  gfd::addCounter(gfd::eCounterScanTime, gfd::metricsClock() - start);
+  gfd::addCounter(gfd::eCounterScannedBytes, length);
+  aScan->found += found;
+#if GFD_CENSOR_FIRST_HIT
+  if (found)
+    return false;
+#endif
+  return aScan->found < aScan->matcher->count();
+}
 
-  if (count < 0) {
-    perror(aFilename);
+bool censor(const gfd::TextArena* aTexts, const char* aKeyword) {
+  char* keyword = static_cast<char*>(malloc(strlen(aKeyword) + 1));
+  if (!keyword)
+    return false;
+  const size_t keywordLength = gfd::foldInto(keyword, aKeyword,
+                                             strlen(aKeyword));
+
+  gfd::FoldBuffer folded;
+  memset(&folded, 0, sizeof(folded));
+  bool found = false;
+  uint32_t i;
+  for (i = 0; !found && i < aTexts->count; i++) {
+    size_t length;
+    const char* text = gfd::foldText(&folded, gfd::fragmentText(aTexts, i),
+                                     aTexts->fragments[i].length, &length);
+    found = gfd::findCaseInsensitive(text, length, keyword, keywordLength);
   }
-  fclose(fp);
+  gfd::clearFoldBuffer(&folded);
+  free(keyword);
+  return found;
 }
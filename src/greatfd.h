@@ -0,0 +1,245 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Declarations shared by the translation units of great firedaemon. */
+
+#ifndef GFD_GREATFD_H
+#define GFD_GREATFD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include <dbus/dbus.h>
+}
+
+#include "arena.h"
+
+/* The maximum number of AT-SPI requests copyTexts() keeps in flight. */
+#ifndef GFD_WALK_WINDOW
+#define GFD_WALK_WINDOW 64
+#endif
+
+/* Whether copyTexts() first tries to learn the tree from the application's
+ * org.a11y.atspi.Cache in one GetItems call. */
+#ifndef GFD_WALK_USE_CACHE
+#define GFD_WALK_USE_CACHE 1
+#endif
+
+/* Whether copyTexts() learns each node with Properties.GetAll and one
+ * Accessible.GetChildren call (about 2 round trips per node) instead of
+ * GetInterfaces, CharacterCount, ChildCount and one GetChildAtIndex per
+ * child (4 + N round trips). */
+#ifndef GFD_WALK_BATCHED
+#define GFD_WALK_BATCHED 1
+#endif
+
+/* Budgets of one copyTexts() walk, so that an endless feed or a giant table
+ * can't keep a worker busy for long: the number of nodes visited, the bytes
+ * of text collected, the depth below the document and the time taken (in
+ * milliseconds, from the start of the event: see eventDeadline()). 0 means
+ * no limit. A walk that runs out of one stops there and says so in
+ * WalkStatistics::truncated. */
+#ifndef GFD_WALK_MAX_NODES
+#define GFD_WALK_MAX_NODES 100000
+#endif
+
+#ifndef GFD_WALK_MAX_BYTES
+#define GFD_WALK_MAX_BYTES (16 * 1024 * 1024)
+#endif
+
+#ifndef GFD_WALK_MAX_DEPTH
+#define GFD_WALK_MAX_DEPTH 256
+#endif
+
+#ifndef GFD_WALK_DEADLINE
+#define GFD_WALK_DEADLINE (5 * 1000)
+#endif
+
+/* How long (in milliseconds) one AT-SPI call made for an event waits for
+ * its reply, at most; 0 for the default of libdbus (25 s). An application
+ * that doesn't answer in time is given up on for the rest of the event. */
+#ifndef GFD_CALL_TIMEOUT
+#define GFD_CALL_TIMEOUT (2 * 1000)
+#endif
+
+/* How long (in milliseconds) the URL of a page is waited for when its
+ * application is skipped as unresponsive (see breaker.h), to log the visit
+ * anyway. */
+#ifndef GFD_SKIPPED_URL_TIMEOUT
+#define GFD_SKIPPED_URL_TIMEOUT 100
+#endif
+
+/* Whether copyTexts() also asks for GetState the nodes it walks one by one,
+ * to walk the subtrees that are showing before the others: collapsed menus,
+ * background tabs and rows scrolled out of view come last, and are what a
+ * budget cuts off. The items of the cache carry their state, so the part of
+ * a tree taken from it is always ordered so; without the cache this is one
+ * more round trip per node, hence off. */
+#ifndef GFD_WALK_VISIBLE_FIRST
+#define GFD_WALK_VISIBLE_FIRST 0
+#endif
+
+/* The most characters copyTexts() asks for in one GetText (so that a huge
+ * text node is not one huge reply); 0 for whole texts at once. The cache
+ * of the application doesn't tell the length of a text, so a text node
+ * found there costs one more call for its CharacterCount unless this is
+ * 0. */
+#ifndef GFD_WALK_TEXT_WINDOW
+#define GFD_WALK_TEXT_WINDOW (64 * 1024)
+#endif
+
+/* The budgets a walk ran out of. */
+typedef enum {
+  eTruncatedNodes    = 1 << 0,
+  eTruncatedBytes    = 1 << 1,
+  eTruncatedDepth    = 1 << 2,
+  eTruncatedDeadline = 1 << 3,
+  eTruncatedTimeout  = 1 << 4, /* a call got no reply in GFD_CALL_TIMEOUT */
+  eTruncatedMemory   = 1 << 5  /* a node or request couldn't be allocated */
+} WalkTruncation;
+
+/* What one page scan cost. */
+typedef struct _WalkStatistics {
+  uint32_t roundTrips; /* D-Bus method calls */
+  uint32_t nodes;      /* accessible objects visited */
+  uint32_t texts;      /* text fragments collected */
+  uint32_t bytes;      /* in them */
+  uint32_t cancelled;  /* requests dropped because the walk stopped early */
+  uint32_t truncated;  /* WalkTruncation flags */
+  uint32_t timeouts;   /* calls that got no reply in GFD_CALL_TIMEOUT */
+} WalkStatistics;
+
+/* CLOCK_MONOTONIC, in milliseconds. */
+uint64_t monotonicMilliseconds();
+
+/* The deadline of an event that starts now, GFD_WALK_DEADLINE from now; 0
+ * if there is none. */
+uint64_t eventDeadline();
+
+/* The timeout of a call made before aDeadline (0: none), as a D-Bus
+ * timeout: GFD_CALL_TIMEOUT, or less if the deadline comes first. */
+int callTimeout(uint64_t aDeadline);
+
+/* Whether aError, of a call made before aDeadline, means that it timed out
+ * at GFD_CALL_TIMEOUT rather than at the deadline. */
+bool isCallTimeout(const DBusError* aError, uint64_t aDeadline);
+
+/* Called by copyTexts() for each fragment as soon as it has been appended to
+ * aTexts; aPath is the object it is the text of. Returning false stops the
+ * walk. */
+typedef bool (*TextHandler)(const gfd::TextArena* aTexts, uint32_t aIndex,
+                            const char* aPath, void* aClosure);
+
+/* Appends the text of every text node under aPath to aTexts, passing each
+ * fragment to aHandler (if not NULL) as it arrives. A text longer than
+ * GFD_WALK_TEXT_WINDOW comes as several transient fragments, each
+ * repeating the last aOverlap characters of the one before (the length of
+ * the longest keyword), whose text is gone once aHandler returns. The walk
+ * stops at aDeadline (see eventDeadline()), or at the
+ * first call that times out. aStatistics, if not NULL, is added to. */
+void copyTexts(DBusConnection* aConnection,
+               const char* aDestination,
+               const char* aPath,
+               gfd::TextArena* aTexts,
+               uint32_t aOverlap,
+               uint64_t aDeadline,
+               TextHandler aHandler,
+               void* aClosure,
+               WalkStatistics* aStatistics);
+
+/* Like copyTexts(), for the text of aPath alone. */
+void copyText(DBusConnection* aConnection,
+              const char* aDestination,
+              const char* aPath,
+              gfd::TextArena* aTexts,
+              uint32_t aOverlap,
+              uint64_t aDeadline,
+              TextHandler aHandler,
+              void* aClosure,
+              WalkStatistics* aStatistics);
+
+/* The Properties.Get call for the accessible parent of aPath; NULL if out
+ * of memory. */
+DBusMessage* newGetParent(const char* aDestination, const char* aPath);
+
+/* Reads the reply to newGetParent() (or an error). On success,
+ * *aParentDestination and *aParentPath are to be free()d. Returns false at
+ * the root. */
+bool readParent(DBusMessage* aReply, char** aParentDestination,
+                char** aParentPath);
+
+/* Asks for the accessible parent of aPath, before aDeadline. On success,
+ * *aParentDestination and *aParentPath are to be free()d. Returns false at
+ * the root, or if there was no answer (aStatistics->timeouts tells). */
+bool getParent(DBusConnection* aConnection,
+               const char* aDestination,
+               const char* aPath,
+               uint64_t aDeadline,
+               char** aParentDestination,
+               char** aParentPath,
+               WalkStatistics* aStatistics);
+
+#ifndef NDEBUG
+void gfdDumpIter(DBusMessageIter* aIter, int aIndent);
+void gfdDumpMessage(DBusMessage* aMessage,
+                    int aLine = 0, const char* aFile = NULL);
+void gfdDumpConnection(DBusConnection* aConnection,
+                       int aLine = 0, const char* aFile = NULL);
+
+#define GFD_DUMP_DBUS_MESSAGE(__DBUSMESSAGE__) \
+  (gfdDumpMessage((__DBUSMESSAGE__), (__LINE__), (__FILE__)))
+
+#define GFD_DUMP_DBUS_CONNECTION(__DBUSCONNECTION__) \
+  (gfdDumpConnection((__DBUSCONNECTION__), (__LINE__), (__FILE__)))
+
+#else
+#define GFD_DUMP_DBUS_MESSAGE(ignore)((void) 0)
+#define GFD_DUMP_DBUS_CONNECTION(ignore)((void) 0)
+#endif
+
+void checkDBusError(DBusError* aError, int aLine, const char* aFile);
+
+#define GFD_CHECK_DBUS_ERROR(__DBUSERROR__) \
+  (checkDBusError((__DBUSERROR__), (__LINE__), (__FILE__)))
+
+#define GFD_A11Y_DESTINATION           "org.a11y.Bus"
+#define GFD_A11Y_PATH                  "/org/a11y/bus"
+#define GFD_A11Y_INTERFACE             "org.a11y.Bus"
+
+#define GFD_ATSPI_REGISTRY_DESTINATION "org.a11y.atspi.Registry"
+#define GFD_ATSPI_REGISTRY_PATH        "/org/a11y/atspi/registry"
+#define GFD_ATSPI_REGISTRY_INTERFACE   "org.a11y.atspi.Registry"
+
+#define GFD_ATSPI_INTERFACE_BASE_      "org.a11y.atspi."
+#define GFD_ATSPI_INTERFACE_ACCESSIBLE GFD_ATSPI_INTERFACE_BASE_ "Accessible"
+#define GFD_ATSPI_INTERFACE_TEXT       GFD_ATSPI_INTERFACE_BASE_ "Text"
+#define GFD_ATSPI_CACHE_PATH           "/org/a11y/atspi/cache"
+#define GFD_ATSPI_NULL_PATH            "/org/a11y/atspi/null"
+
+namespace gfd {
+namespace atspi {
+namespace interface {
+static const char* const kAccessible = GFD_ATSPI_INTERFACE_ACCESSIBLE;
+static const char* const kCache      = GFD_ATSPI_INTERFACE_BASE_ "Cache";
+static const char* const kDocument   = GFD_ATSPI_INTERFACE_BASE_ "Document";
+static const char* const kEventDocument =
+  GFD_ATSPI_INTERFACE_BASE_ "Event.Document";
+static const char* const kEventObject =
+  GFD_ATSPI_INTERFACE_BASE_ "Event.Object";
+static const char* const kText       = GFD_ATSPI_INTERFACE_TEXT;
+}
+}
+}
+
+#endif /* GFD_GREATFD_H */
@@ -0,0 +1,107 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "hash.h"
+
+#include <string.h>
+
+namespace gfd {
+
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t rotate(uint64_t aValue, int aBits) {
+  return (aValue << aBits) | (aValue >> (64 - aBits));
+}
+
+/* Unaligned little endian loads. */
+static inline uint64_t read64(const uint8_t* aData) {
+  uint64_t value;
+  memcpy(&value, aData, sizeof(value));
+  return value;
+}
+
+static inline uint32_t read32(const uint8_t* aData) {
+  uint32_t value;
+  memcpy(&value, aData, sizeof(value));
+  return value;
+}
+
+static inline uint64_t round(uint64_t aAccumulator, uint64_t aInput) {
+  aAccumulator += aInput * kPrime2;
+  aAccumulator = rotate(aAccumulator, 31);
+  return aAccumulator * kPrime1;
+}
+
+static inline uint64_t merge(uint64_t aHash, uint64_t aAccumulator) {
+  aHash ^= round(0, aAccumulator);
+  return aHash * kPrime1 + kPrime4;
+}
+
+uint64_t hash64(const void* aData, size_t aLength, uint64_t aSeed) {
+  const uint8_t* p = static_cast<const uint8_t*>(aData);
+  const uint8_t* const end = p + aLength;
+  uint64_t hash;
+
+  if (aLength >= 32) {
+    uint64_t v1 = aSeed + kPrime1 + kPrime2;
+    uint64_t v2 = aSeed + kPrime2;
+    uint64_t v3 = aSeed;
+    uint64_t v4 = aSeed - kPrime1;
+    const uint8_t* const limit = end - 32;
+    do {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = rotate(v1, 1) + rotate(v2, 7) + rotate(v3, 12) + rotate(v4, 18);
+    hash = merge(hash, v1);
+    hash = merge(hash, v2);
+    hash = merge(hash, v3);
+    hash = merge(hash, v4);
+  }
+  else {
+    hash = aSeed + kPrime5;
+  }
+
+  hash += aLength;
+
+  for (; p + 8 <= end; p += 8) {
+    hash ^= round(0, read64(p));
+    hash = rotate(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= uint64_t(read32(p)) * kPrime1;
+    hash = rotate(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * kPrime5;
+    hash = rotate(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+}
@@ -0,0 +1,30 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Non-cryptographic hashing. */
+
+#ifndef GFD_HASH_H
+#define GFD_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfd {
+
+/* XXH64 (https://github.com/Cyan4973/xxHash); same values as the reference
+ * implementation. */
+uint64_t hash64(const void* aData, size_t aLength, uint64_t aSeed = 0);
+
+}
+
+#endif /* GFD_HASH_H */
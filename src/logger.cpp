@@ -0,0 +1,369 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* The ring buffer is a byte array written by any number of threads and read
+ * by the writer thread only. A record is an 8 byte header (tag << 32 |
+ * length) followed by the formatted text, padded to 8 bytes. A producer
+ * reserves space by advancing sHead with compare-and-swap, copies the text,
+ * then publishes the header with a release store; a zero header means "not
+ * committed yet", so the writer stops there. Records never wrap: the rest
+ * of the buffer is filled with a padding record instead. The writer zeroes
+ * what it has consumed before handing it back by advancing sTail.
+ */
+
+#include "logger.h"
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define GFD_LOG_MAX_FILES 8
+
+namespace gfd {
+
+struct _LogFile {
+  const char* filename;
+  int fd;
+  uint32_t tag; /* 1 + index in sLogs */
+
+  /* records of the batch being written */
+  struct iovec* batch;
+  uint32_t batchCount;
+  uint32_t batchCapacity;
+};
+
+static LogFile sLogs[GFD_LOG_MAX_FILES];
+static uint32_t sLogCount(0);
+
+static const uint64_t kCapacity = GFD_LOG_BUFFER_SIZE;
+static const uint64_t kHeaderSize = sizeof(uint64_t);
+static const uint32_t kPaddingTag = 0xffffffff;
+
+static char* sRing(NULL);
+static uint64_t sHead(0); /* reserved up to; advanced by producers */
+static uint64_t sTail(0); /* consumed up to; advanced by the writer */
+
+static bool sRunning(false);
+static bool sStopping(false);
+static uint32_t sWakeRequested(0);
+static int sWakeFd(-1);
+static pthread_t sWriter;
+
+static inline uint64_t recordSize(uint64_t aLength) {
+  return (kHeaderSize + aLength + 7) & ~uint64_t(7);
+}
+
+static bool reopen(LogFile* aLog) {
+  if (aLog->fd >= 0)
+    return true;
+
+  aLog->fd = open(aLog->filename, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+                  0666);
+  if (aLog->fd < 0) {
+    perror(aLog->filename);
+    return false;
+  }
+  return true;
+}
+
+/* writev() everything, resuming after short writes. */
+static bool writeAll(int aFd, struct iovec* aIov, uint32_t aCount) {
+  while (aCount) {
+    int count = (aCount > IOV_MAX)? IOV_MAX : int(aCount);
+    ssize_t written = writev(aFd, aIov, count);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    while (aCount && size_t(written) >= aIov->iov_len) {
+      written -= aIov->iov_len;
+      aIov++;
+      aCount--;
+    }
+    if (aCount && written) {
+      aIov->iov_base = static_cast<char*>(aIov->iov_base) + written;
+      aIov->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+static void appendNow(LogFile* aLog, const char* aRecord, size_t aLength) {
+  if (!reopen(aLog))
+    return;
+
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(aRecord);
+  iov.iov_len = aLength;
+  if (!writeAll(aLog->fd, &iov, 1))
+    perror(aLog->filename);
+}
+
+static void wake() {
+  if (__atomic_exchange_n(&sWakeRequested, 1, __ATOMIC_ACQ_REL))
+    return;
+
+  uint64_t one = 1;
+  if (write(sWakeFd, &one, sizeof(one)) < 0)
+    perror("eventfd");
+}
+
+static inline void publish(uint64_t aPosition, uint32_t aTag,
+                           uint64_t aLength) {
+  uint64_t* header =
+    reinterpret_cast<uint64_t*>(sRing + (aPosition & (kCapacity - 1)));
+  __atomic_store_n(header, (uint64_t(aTag) << 32) | aLength,
+                   __ATOMIC_RELEASE);
+}
+
+/* Copies a record into the ring. Returns false if it has to be written
+ * synchronously instead. */
+static bool commit(LogFile* aLog, const char* aRecord, size_t aLength) {
+  const uint64_t size = recordSize(aLength);
+  if (size > kCapacity / 2)
+    return false;
+
+  uint64_t head;
+  uint64_t padding;
+  for (;;) {
+    if (!__atomic_load_n(&sRunning, __ATOMIC_ACQUIRE))
+      return false;
+
+    head = __atomic_load_n(&sHead, __ATOMIC_RELAXED);
+    uint64_t offset = head & (kCapacity - 1);
+    padding = (offset + size > kCapacity)? kCapacity - offset : 0;
+
+    if (head + padding + size - __atomic_load_n(&sTail, __ATOMIC_ACQUIRE) >
+        kCapacity) {
+      /* Full; wait for the writer. */
+      wake();
+      sched_yield();
+      continue;
+    }
+
+    if (__atomic_compare_exchange_n(&sHead, &head, head + padding + size,
+                                    true, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_RELAXED))
+      break;
+  }
+
+  if (padding)
+    publish(head, kPaddingTag, padding - kHeaderSize);
+
+  head += padding;
+  memcpy(sRing + (head & (kCapacity - 1)) + kHeaderSize, aRecord, aLength);
+  publish(head, aLog->tag, aLength);
+
+  if (head + size - __atomic_load_n(&sTail, __ATOMIC_RELAXED) >=
+      GFD_LOG_FLUSH_BYTES)
+    wake();
+  return true;
+}
+
+static bool addToBatch(LogFile* aLog, char* aData, size_t aLength) {
+  if (aLog->batchCount == aLog->batchCapacity) {
+    uint32_t capacity = aLog->batchCapacity? aLog->batchCapacity * 2 : 64;
+    struct iovec* batch = static_cast<struct iovec*>(
+      realloc(aLog->batch, sizeof(struct iovec) * capacity));
+    if (!batch)
+      return false;
+    aLog->batch = batch;
+    aLog->batchCapacity = capacity;
+  }
+
+  aLog->batch[aLog->batchCount].iov_base = aData;
+  aLog->batch[aLog->batchCount].iov_len = aLength;
+  aLog->batchCount++;
+  return true;
+}
+
+/* Writes out every committed record. Returns false if there was none. */
+static bool flushBatch() {
+  const uint64_t tail = sTail;
+  const uint64_t head = __atomic_load_n(&sHead, __ATOMIC_ACQUIRE);
+
+  uint64_t end = tail;
+  while (end < head) {
+    char* slot = sRing + (end & (kCapacity - 1));
+    uint64_t header =
+      __atomic_load_n(reinterpret_cast<uint64_t*>(slot), __ATOMIC_ACQUIRE);
+    if (!header)
+      break;
+
+    uint32_t tag = uint32_t(header >> 32);
+    uint64_t length = header & 0xffffffff;
+    if (tag != kPaddingTag && !addToBatch(&sLogs[tag - 1],
+                                          slot + kHeaderSize, length))
+      break;
+    end += recordSize(length);
+  }
+
+  if (end == tail)
+    return false;
+
+  const uint64_t start = metricsClock();
+  uint32_t i;
+  for (i = 0; i < sLogCount; i++) {
+    LogFile* log = &sLogs[i];
+    if (!log->batchCount)
+      continue;
+
+    if (reopen(log)) {
+      if (!writeAll(log->fd, log->batch, log->batchCount))
+        perror(log->filename);
+#if GFD_LOG_FSYNC
+      else if (fdatasync(log->fd) < 0)
+        perror(log->filename);
+#endif
+    }
+    log->batchCount = 0;
+  }
+  recordValue(eHistogramLogFlush, metricsClock() - start);
+
+  uint64_t from = tail & (kCapacity - 1);
+  uint64_t length = end - tail;
+  if (from + length > kCapacity) {
+    memset(sRing + from, 0, kCapacity - from);
+    memset(sRing, 0, from + length - kCapacity);
+  }
+  else {
+    memset(sRing + from, 0, length);
+  }
+  __atomic_store_n(&sTail, end, __ATOMIC_RELEASE);
+  return true;
+}
+
+/* Waits for reservations that are still being copied. */
+static void flushAll() {
+  while (__atomic_load_n(&sHead, __ATOMIC_ACQUIRE) != sTail) {
+    if (!flushBatch())
+      sched_yield();
+  }
+}
+
+static void* writerMain(void*) {
+  for (;;) {
+    uint64_t count;
+    if (read(sWakeFd, &count, sizeof(count)) < 0 && errno != EINTR)
+      perror("eventfd");
+    __atomic_store_n(&sWakeRequested, 0, __ATOMIC_RELEASE);
+
+    flushBatch();
+
+    if (__atomic_load_n(&sStopping, __ATOMIC_ACQUIRE)) {
+      flushAll();
+      break;
+    }
+  }
+  return NULL;
+}
+
+LogFile* openLog(const char* aFilename) {
+  if (sLogCount == GFD_LOG_MAX_FILES)
+    return NULL;
+
+  LogFile* log = &sLogs[sLogCount];
+  memset(log, 0, sizeof(LogFile));
+  log->filename = aFilename;
+  log->fd = -1;
+  log->tag = ++sLogCount;
+  reopen(log);
+  return log;
+}
+
+bool startLogger() {
+  sRing = static_cast<char*>(calloc(kCapacity, 1));
+  if (!sRing)
+    return false;
+
+  sWakeFd = eventfd(0, EFD_CLOEXEC);
+  if (sWakeFd < 0) {
+    perror("eventfd");
+    return false;
+  }
+
+  __atomic_store_n(&sRunning, true, __ATOMIC_RELEASE);
+  if (0 != pthread_create(&sWriter, NULL, writerMain, NULL)) {
+    __atomic_store_n(&sRunning, false, __ATOMIC_RELEASE);
+    return false;
+  }
+  return true;
+}
+
+void flushLogs() {
+  if (__atomic_load_n(&sRunning, __ATOMIC_ACQUIRE) &&
+      __atomic_load_n(&sHead, __ATOMIC_RELAXED) !=
+      __atomic_load_n(&sTail, __ATOMIC_RELAXED))
+    wake();
+}
+
+void stopLogger() {
+  if (!__atomic_load_n(&sRunning, __ATOMIC_ACQUIRE))
+    return;
+
+  __atomic_store_n(&sStopping, true, __ATOMIC_RELEASE);
+  wake();
+  pthread_join(sWriter, NULL);
+
+  /* From now on records are appended synchronously, after everything the
+   * writer has written. */
+  __atomic_store_n(&sRunning, false, __ATOMIC_RELEASE);
+}
+
+void flogf(LogFile* aLog, const char* aFormat, ...) {
+  if (!aLog)
+    return;
+
+  char buffer[1024];
+  char* record = buffer;
+
+  va_list args;
+  va_start(args, aFormat);
+  int length = vsnprintf(buffer, sizeof(buffer), aFormat, args);
+  va_end(args);
+
+  if (length < 0) {
+    perror(aLog->filename);
+    return;
+  }
+
+  if (size_t(length) >= sizeof(buffer)) {
+    record = static_cast<char*>(malloc(length + 1));
+    if (!record)
+      return;
+    va_start(args, aFormat);
+    vsnprintf(record, length + 1, aFormat, args);
+    va_end(args);
+  }
+
+  if (!commit(aLog, record, length))
+    appendNow(aLog, record, length);
+  addCounter(eCounterLogRecords, 1);
+
+  if (record != buffer)
+    free(record);
+}
+
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Buffered log writer.
+ *
+ * Log files are opened once and kept open. flogf() formats a record into a
+ * lock-free ring buffer and returns; a background thread collects whatever
+ * has been committed and appends it to each file with one writev() per
+ * file per batch (group commit). The bytes written are exactly what
+ * vfprintf() would have written.
+ *
+ * A batch is written when GFD_LOG_FLUSH_BYTES are pending, or when
+ * flushLogs() is called; the event loop of the daemon calls it every
+ * GFD_LOG_FLUSH_INTERVAL milliseconds. With GFD_LOG_FSYNC, every batch is
+ * also fdatasync()ed before the next one.
+ *
+ * Before startLogger() (and after stopLogger()), flogf() simply appends the
+ * record synchronously.
+ */
+
+#ifndef GFD_LOGGER_H
+#define GFD_LOGGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef GFD_LOG_BUFFER_SIZE
+#define GFD_LOG_BUFFER_SIZE (1024 * 1024) /* must be a power of 2 */
+#endif
+
+#ifndef GFD_LOG_FLUSH_BYTES
+#define GFD_LOG_FLUSH_BYTES (64 * 1024)
+#endif
+
+#ifndef GFD_LOG_FLUSH_INTERVAL
+#define GFD_LOG_FLUSH_INTERVAL 1000
+#endif
+
+#ifndef GFD_LOG_FSYNC
+#define GFD_LOG_FSYNC 0
+#endif
+
+namespace gfd {
+
+typedef struct _LogFile LogFile;
+
+/* Registers aFilename (which must outlive the logger) and opens it for
+ * appending. A file that can't be opened yet is retried on every batch. */
+LogFile* openLog(const char* aFilename);
+
+bool startLogger();
+
+/* Has the writer thread write out what is pending, without waiting. */
+void flushLogs();
+
+/* Writes out everything pending and stops the writer thread. */
+void stopLogger();
+
+void flogf(LogFile* aLog, const char* aFormat, ...)
+  __attribute__((format(printf, 2, 3)));
+
+}
+
+#endif /* GFD_LOGGER_H */
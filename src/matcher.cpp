@@ -0,0 +1,754 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "matcher.h"
+#include "casefold.h"
+#include "hash.h"
+#include "pattern.h"
+#include "strsearch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gfd {
+
+/* Same folding as strcasestr() in the "C" locale. */
+static inline uint8_t fold(uint8_t aByte) {
+  return (aByte >= 'A' && aByte <= 'Z')? uint8_t(aByte + ('a' - 'A')) : aByte;
+}
+
+template<typename T>
+static bool grow(T** aArray, uint32_t* aCapacity, uint32_t aNeeded) {
+  if (aNeeded <= *aCapacity)
+    return true;
+
+  uint32_t capacity = *aCapacity? *aCapacity : 64;
+  while (capacity < aNeeded)
+    capacity *= 2;
+
+  T* array = static_cast<T*>(realloc(*aArray, sizeof(T) * capacity));
+  if (!array)
+    return false;
+
+  *aArray = array;
+  *aCapacity = capacity;
+  return true;
+}
+
+/* The trie as it is being built: children are kept in sibling lists. */
+typedef struct _MatcherBuilder {
+  uint32_t* firstChild;
+  uint32_t* nextSibling;
+  uint8_t* label;
+  uint32_t* ownOut;
+  uint32_t stateCount;
+  uint32_t stateCapacity[4];
+
+  uint32_t* outKeyword;
+  uint32_t* outNext;
+  uint32_t outCount;
+  uint32_t outCapacity[2];
+} MatcherBuilder;
+
+static const uint32_t kNoState = 0xffffffff;
+
+static uint32_t
+findChild(const MatcherBuilder* aBuilder, uint32_t aState, uint8_t aClass) {
+  uint32_t child = aBuilder->firstChild[aState];
+  while (child != kNoState && aBuilder->label[child] != aClass)
+    child = aBuilder->nextSibling[child];
+  return child;
+}
+
+static uint32_t newState(MatcherBuilder* aBuilder) {
+  uint32_t state = aBuilder->stateCount;
+  if (!grow(&aBuilder->firstChild, &aBuilder->stateCapacity[0], state + 1) ||
+      !grow(&aBuilder->nextSibling, &aBuilder->stateCapacity[1], state + 1) ||
+      !grow(&aBuilder->label, &aBuilder->stateCapacity[2], state + 1) ||
+      !grow(&aBuilder->ownOut, &aBuilder->stateCapacity[3], state + 1))
+    return kNoState;
+
+  aBuilder->firstChild[state] = kNoState;
+  aBuilder->nextSibling[state] = kNoState;
+  aBuilder->label[state] = 0;
+  aBuilder->ownOut[state] = kNoState;
+  aBuilder->stateCount++;
+  return state;
+}
+
+static void freeBuilder(MatcherBuilder* aBuilder) {
+  free(aBuilder->firstChild);
+  free(aBuilder->nextSibling);
+  free(aBuilder->label);
+  free(aBuilder->ownOut);
+  free(aBuilder->outKeyword);
+  free(aBuilder->outNext);
+}
+
+Matcher::Matcher()
+  : mKeywords(NULL), mKeywordCount(0),
+    mKeywordText(NULL), mKeywordOffset(NULL), mImage(NULL), mImageSize(0),
+    mFolded(NULL), mFoldedText(NULL), mLongestKeyword(0),
+    mKeywordLength(NULL), mPatterns(NULL),
+    mClassCount(0), mStateCount(0),
+    mDelta(NULL), mEdgeStart(NULL), mEdgeClass(NULL), mEdgeTarget(NULL),
+    mFail(NULL), mOut(NULL), mOutKeyword(NULL), mOutNext(NULL), mOutCount(0) {
+  memset(mClass, 0, sizeof(mClass));
+}
+
+Matcher::~Matcher() {
+  free(mFolded);
+  free(mFoldedText);
+  free(mKeywordLength);
+  freePatterns(mPatterns);
+  if (mImage) {
+    munmap(mImage, mImageSize);
+    return;
+  }
+  free(mDelta);
+  free(mEdgeStart);
+  free(mEdgeClass);
+  free(mEdgeTarget);
+  free(mFail);
+  free(mOut);
+  free(mOutKeyword);
+  free(mOutNext);
+}
+
+Matcher* Matcher::compile(const char* const* aKeywords, uint32_t aCount) {
+  Matcher* matcher = new Matcher();
+  matcher->mKeywords = aKeywords;
+  matcher->mKeywordCount = aCount;
+  if (!matcher->foldKeywords()) {
+    delete matcher;
+    return NULL;
+  }
+
+  if (aCount <= GFD_MATCHER_SEARCH_LIMIT) {
+    matcher->mKeywordLength =
+      static_cast<size_t*>(malloc(sizeof(size_t) * (aCount? aCount : 1)));
+    if (!matcher->mKeywordLength) {
+      delete matcher;
+      return NULL;
+    }
+    uint32_t i;
+    for (i = 0; i < aCount; i++) {
+      const char* keyword = matcher->folded(i);
+      matcher->mKeywordLength[i] = isPattern(keyword)? 0 : strlen(keyword);
+    }
+  }
+
+  /* Byte classes: one per folded byte that appears in some keyword. */
+  {
+    bool used[256];
+    memset(used, 0, sizeof(used));
+
+    uint32_t i;
+    for (i = 0; i < aCount; i++) {
+      const char* keyword = matcher->folded(i);
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(keyword);
+      if (isPattern(keyword))
+        continue;
+      for (; *p; p++)
+        used[fold(*p)] = true;
+    }
+
+    uint8_t folded[256];
+    memset(folded, 0, sizeof(folded));
+    uint32_t classCount = 1;
+    for (i = 0; i < 256; i++) {
+      if (used[i])
+        folded[i] = uint8_t(classCount++);
+    }
+    for (i = 0; i < 256; i++)
+      matcher->mClass[i] = folded[fold(uint8_t(i))];
+
+    matcher->mClassCount = classCount;
+  }
+
+  MatcherBuilder builder;
+  memset(&builder, 0, sizeof(builder));
+
+  bool succeeded = (newState(&builder) == 0);
+
+  /* Trie */
+  uint32_t i;
+  for (i = 0; succeeded && i < aCount; i++) {
+    const char* keyword = matcher->folded(i);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(keyword);
+    if (!*p || isPattern(keyword))
+      continue;
+
+    uint32_t state = 0;
+    for (; *p; p++) {
+      uint8_t cls = matcher->mClass[*p];
+      uint32_t child = findChild(&builder, state, cls);
+      if (child == kNoState) {
+        child = newState(&builder);
+        if (child == kNoState) {
+          succeeded = false;
+          break;
+        }
+        builder.label[child] = cls;
+        builder.nextSibling[child] = builder.firstChild[state];
+        builder.firstChild[state] = child;
+      }
+      state = child;
+    }
+    if (!succeeded)
+      break;
+
+    uint32_t out = builder.outCount;
+    if (!grow(&builder.outKeyword, &builder.outCapacity[0], out + 1) ||
+        !grow(&builder.outNext, &builder.outCapacity[1], out + 1)) {
+      succeeded = false;
+      break;
+    }
+    builder.outKeyword[out] = i;
+    builder.outNext[out] = builder.ownOut[state];
+    builder.ownOut[state] = out;
+    builder.outCount++;
+  }
+
+  const uint32_t stateCount = builder.stateCount;
+  const uint32_t classCount = matcher->mClassCount;
+  uint32_t* queue(NULL);
+  uint32_t* rootNext(NULL);
+
+  if (succeeded) {
+    matcher->mStateCount = stateCount;
+    matcher->mFail = static_cast<uint32_t*>(malloc(sizeof(uint32_t) *
+                                                   stateCount));
+    matcher->mOut = static_cast<uint32_t*>(malloc(sizeof(uint32_t) *
+                                                  stateCount));
+    queue = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * stateCount));
+    rootNext = static_cast<uint32_t*>(calloc(classCount, sizeof(uint32_t)));
+    succeeded = matcher->mFail && matcher->mOut && queue && rootNext;
+  }
+
+  /* Failure links and output chains, in breadth-first order so that the
+   * failure target of a state is always complete before the state. */
+  uint32_t queued = 0;
+  if (succeeded) {
+    uint32_t child;
+    for (child = builder.firstChild[0]; child != kNoState;
+         child = builder.nextSibling[child])
+      rootNext[builder.label[child]] = child;
+
+    matcher->mFail[0] = 0;
+    matcher->mOut[0] = kNone;
+    queue[queued++] = 0;
+
+    uint32_t head;
+    for (head = 0; head < queued; head++) {
+      uint32_t state = queue[head];
+      for (child = builder.firstChild[state]; child != kNoState;
+           child = builder.nextSibling[child]) {
+        uint8_t cls = builder.label[child];
+        uint32_t fail = 0;
+        if (state != 0) {
+          uint32_t f = matcher->mFail[state];
+          for (;;) {
+            uint32_t next = f? findChild(&builder, f, cls) : rootNext[cls];
+            if (next != kNoState && next != 0) {
+              fail = next;
+              break;
+            }
+            if (f == 0)
+              break;
+            f = matcher->mFail[f];
+          }
+        }
+        matcher->mFail[child] = fail;
+
+        uint32_t own = builder.ownOut[child];
+        if (own == kNoState) {
+          matcher->mOut[child] = matcher->mOut[fail];
+        }
+        else {
+          uint32_t tail = own;
+          while (builder.outNext[tail] != kNoState)
+            tail = builder.outNext[tail];
+          builder.outNext[tail] = matcher->mOut[fail];
+          matcher->mOut[child] = own;
+        }
+        queue[queued++] = child;
+      }
+    }
+  }
+
+  if (succeeded) {
+    matcher->mOutKeyword = builder.outKeyword;
+    matcher->mOutNext = builder.outNext;
+    matcher->mOutCount = builder.outCount;
+    builder.outKeyword = NULL;
+    builder.outNext = NULL;
+  }
+
+  /* Transition table */
+  if (succeeded &&
+      uint64_t(stateCount) * classCount * sizeof(uint32_t) <=
+        GFD_MATCHER_DENSE_LIMIT) {
+    uint32_t* delta =
+      static_cast<uint32_t*>(malloc(sizeof(uint32_t) * stateCount *
+                                    classCount));
+    succeeded = (delta != NULL);
+    uint32_t head;
+    for (head = 0; succeeded && head < queued; head++) {
+      uint32_t state = queue[head];
+      uint32_t* row = delta + size_t(state) * classCount;
+      if (state == 0)
+        memset(row, 0, sizeof(uint32_t) * classCount);
+      else
+        memcpy(row, delta + size_t(matcher->mFail[state]) * classCount,
+               sizeof(uint32_t) * classCount);
+
+      uint32_t child;
+      for (child = builder.firstChild[state]; child != kNoState;
+           child = builder.nextSibling[child])
+        row[builder.label[child]] = child;
+    }
+    matcher->mDelta = delta;
+  }
+  else if (succeeded) {
+    matcher->mEdgeStart =
+      static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (stateCount + 1)));
+    matcher->mEdgeClass =
+      static_cast<uint8_t*>(malloc(stateCount? stateCount : 1));
+    matcher->mEdgeTarget =
+      static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (stateCount?
+                                                        stateCount : 1)));
+    succeeded = matcher->mEdgeStart && matcher->mEdgeClass &&
+                matcher->mEdgeTarget;
+
+    uint32_t edge = 0;
+    uint32_t state;
+    for (state = 0; succeeded && state < stateCount; state++) {
+      matcher->mEdgeStart[state] = edge;
+      uint32_t first = edge;
+      uint32_t child;
+      for (child = builder.firstChild[state]; child != kNoState;
+           child = builder.nextSibling[child]) {
+        /* insertion sort by class */
+        uint32_t j = edge++;
+        while (j > first && matcher->mEdgeClass[j - 1] > builder.label[child]) {
+          matcher->mEdgeClass[j] = matcher->mEdgeClass[j - 1];
+          matcher->mEdgeTarget[j] = matcher->mEdgeTarget[j - 1];
+          j--;
+        }
+        matcher->mEdgeClass[j] = builder.label[child];
+        matcher->mEdgeTarget[j] = child;
+      }
+    }
+    if (succeeded)
+      matcher->mEdgeStart[stateCount] = edge;
+  }
+
+  free(queue);
+  free(rootNext);
+  freeBuilder(&builder);
+
+  if (!succeeded || !matcher->compilePatterns()) {
+    delete matcher;
+    return NULL;
+  }
+  return matcher;
+}
+
+bool Matcher::foldKeywords() {
+  size_t size = 0;
+  bool ascii = true;
+  uint32_t i;
+  for (i = 0; i < mKeywordCount; i++) {
+    const uint8_t* start = reinterpret_cast<const uint8_t*>(keyword(i));
+    const uint8_t* p = start;
+    for (; *p; p++)
+      ascii = ascii && *p < 0x80;
+    if (uint32_t(p - start) > mLongestKeyword)
+      mLongestKeyword = uint32_t(p - start);
+    size += p - start + 1;
+  }
+  if (ascii)
+    return true;
+
+  mFolded = static_cast<const char**>(malloc(sizeof(char*) * mKeywordCount));
+  mFoldedText = static_cast<char*>(malloc(size));
+  if (!mFolded || !mFoldedText)
+    return false;
+
+  char* text = mFoldedText;
+  mLongestKeyword = 0;
+  for (i = 0; i < mKeywordCount; i++) {
+    mFolded[i] = text;
+    const char* source = keyword(i);
+    size_t length = isPattern(source)?
+      foldPattern(text, source, strlen(source)) :
+      foldInto(text, source, strlen(source));
+    if (length > mLongestKeyword)
+      mLongestKeyword = uint32_t(length);
+    text += length;
+    *text++ = '\0';
+  }
+  return true;
+}
+
+bool Matcher::compilePatterns() {
+  const char** patterns =
+    static_cast<const char**>(malloc(sizeof(char*) * (mKeywordCount + 1)));
+  uint32_t* index =
+    static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (mKeywordCount + 1)));
+  bool succeeded = patterns && index;
+
+  uint32_t count = 0;
+  uint32_t i;
+  for (i = 0; succeeded && i < mKeywordCount; i++) {
+    if (isPattern(folded(i))) {
+      patterns[count] = folded(i);
+      index[count++] = i;
+    }
+  }
+  if (succeeded && count) {
+    mPatterns = gfd::compilePatterns(patterns, index, count);
+    succeeded = (mPatterns != NULL);
+  }
+
+  free(patterns);
+  free(index);
+  return succeeded;
+}
+
+inline uint32_t Matcher::report(uint32_t aState, uint8_t* aHits) const {
+  uint32_t newHits = 0;
+  uint32_t out;
+  for (out = mOut[aState]; out != kNone; out = mOutNext[out]) {
+    uint32_t keyword = mOutKeyword[out];
+    if (!aHits[keyword]) {
+      aHits[keyword] = 1;
+      newHits++;
+    }
+  }
+  return newHits;
+}
+
+uint32_t Matcher::scan(const char* aText, size_t aLength, uint8_t* aHits,
+                       bool aWordBefore, bool aWordAfter) const {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(aText);
+  const uint8_t* end = p + aLength;
+  uint32_t newHits = mPatterns?
+    scanPatterns(mPatterns, aText, aLength, aHits, aWordBefore, aWordAfter) :
+    0;
+  uint32_t state = 0;
+
+  if (mKeywordLength) {
+    uint32_t i;
+    for (i = 0; i < mKeywordCount; i++) {
+      if (!aHits[i] && mKeywordLength[i] &&
+          findCaseInsensitive(aText, aLength,
+                              folded(i), mKeywordLength[i])) {
+        aHits[i] = 1;
+        newHits++;
+      }
+    }
+    return newHits;
+  }
+
+  if (mDelta) {
+    const uint32_t classCount = mClassCount;
+    for (; p < end; p++) {
+      state = mDelta[size_t(state) * classCount + mClass[*p]];
+      if (mOut[state] != kNone)
+        newHits += report(state, aHits);
+    }
+    return newHits;
+  }
+
+  for (; p < end; p++) {
+    uint8_t cls = mClass[*p];
+    if (!cls) {
+      state = 0;
+      continue;
+    }
+
+    for (;;) {
+      /* binary search among the (sorted) edges of this state */
+      uint32_t low = mEdgeStart[state];
+      uint32_t high = mEdgeStart[state + 1];
+      while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        if (mEdgeClass[middle] < cls)
+          low = middle + 1;
+        else
+          high = middle;
+      }
+      if (low < mEdgeStart[state + 1] && mEdgeClass[low] == cls) {
+        state = mEdgeTarget[low];
+        break;
+      }
+      if (state == 0)
+        break;
+      state = mFail[state];
+    }
+
+    if (mOut[state] != kNone)
+      newHits += report(state, aHits);
+  }
+  return newHits;
+}
+
+/* The image: this header, then the sections it gives the offsets of, each
+ * aligned to kImageAlignment. Everything is in the byte order of the host,
+ * which the magic number tells apart. */
+typedef struct _ImageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;       /* kImageByteOrder */
+  uint64_t sourceHash;
+  uint64_t size;            /* of the whole image */
+  uint64_t checksum;        /* hash64() of what follows the header */
+
+  uint32_t keywordCount;
+  uint32_t classCount;
+  uint32_t stateCount;
+  uint32_t outCount;
+  uint32_t edgeCount;       /* 0 in dense mode */
+  uint32_t dense;
+  uint8_t classes[256];
+
+  uint64_t offsets[10];     /* ImageSection -> offset from the start */
+} ImageHeader;
+
+enum ImageSection {
+  eDelta,
+  eEdgeStart,
+  eEdgeClass,
+  eEdgeTarget,
+  eFail,
+  eOut,
+  eOutKeyword,
+  eOutNext,
+  eKeywordOffset,
+  eKeywordText
+};
+
+static const char kImageMagic[8] = { 'G', 'F', 'D', 'M', 'A', 'T', 'C', 'H' };
+static const uint32_t kImageByteOrder = 0x01020304;
+static const uint64_t kImageAlignment = 64;
+
+static inline uint64_t alignImage(uint64_t aOffset) {
+  return (aOffset + kImageAlignment - 1) & ~(kImageAlignment - 1);
+}
+
+static bool writeAll(int aFd, const char* aData, size_t aLength) {
+  while (aLength) {
+    ssize_t written = write(aFd, aData, aLength);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    aData += written;
+    aLength -= written;
+  }
+  return true;
+}
+
+/* The size of each section of an image. */
+static void sectionSizes(const ImageHeader* aHeader, uint64_t* aSizes) {
+  const uint64_t stateCount = aHeader->stateCount;
+  aSizes[eDelta] = aHeader->dense?
+                   sizeof(uint32_t) * stateCount * aHeader->classCount : 0;
+  aSizes[eEdgeStart] = aHeader->dense?
+                       0 : sizeof(uint32_t) * (stateCount + 1);
+  aSizes[eEdgeClass] = aHeader->edgeCount;
+  aSizes[eEdgeTarget] = sizeof(uint32_t) * uint64_t(aHeader->edgeCount);
+  aSizes[eFail] = sizeof(uint32_t) * stateCount;
+  aSizes[eOut] = sizeof(uint32_t) * stateCount;
+  aSizes[eOutKeyword] = sizeof(uint32_t) * uint64_t(aHeader->outCount);
+  aSizes[eOutNext] = sizeof(uint32_t) * uint64_t(aHeader->outCount);
+  aSizes[eKeywordOffset] = sizeof(uint32_t) * uint64_t(aHeader->keywordCount);
+  aSizes[eKeywordText] = 0; /* whatever is left */
+}
+
+static inline uint32_t* section(void* aImage, const ImageHeader* aHeader,
+                                ImageSection aSection) {
+  return reinterpret_cast<uint32_t*>(static_cast<char*>(aImage) +
+                                     aHeader->offsets[aSection]);
+}
+
+bool Matcher::save(int aFd, uint64_t aSourceHash) const {
+  ImageHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.version = GFD_MATCHER_IMAGE_VERSION;
+  header.byteOrder = kImageByteOrder;
+  header.sourceHash = aSourceHash;
+  header.keywordCount = mKeywordCount;
+  header.classCount = mClassCount;
+  header.stateCount = mStateCount;
+  header.outCount = mOutCount;
+  header.edgeCount = mDelta? 0 : mEdgeStart[mStateCount];
+  header.dense = mDelta != NULL;
+  memcpy(header.classes, mClass, sizeof(mClass));
+
+  uint64_t sizes[10];
+  sectionSizes(&header, sizes);
+  uint32_t i;
+  for (i = 0; i < mKeywordCount; i++)
+    sizes[eKeywordText] += strlen(keyword(i)) + 1;
+
+  uint64_t offset = alignImage(sizeof(header));
+  for (i = 0; i < 10; i++) {
+    header.offsets[i] = offset;
+    offset = alignImage(offset + sizes[i]);
+  }
+  header.size = offset;
+
+  char* image = static_cast<char*>(calloc(header.size, 1));
+  if (!image)
+    return false;
+
+  const void* tables[eKeywordOffset] = {
+    mDelta, mEdgeStart, mEdgeClass, mEdgeTarget, mFail, mOut, mOutKeyword,
+    mOutNext
+  };
+  for (i = 0; i < eKeywordOffset; i++) {
+    if (sizes[i])
+      memcpy(image + header.offsets[i], tables[i], sizes[i]);
+  }
+
+  uint32_t* keywordOffset = section(image, &header, eKeywordOffset);
+  char* text = reinterpret_cast<char*>(section(image, &header, eKeywordText));
+  uint32_t textSize = 0;
+  for (i = 0; i < mKeywordCount; i++) {
+    size_t length = strlen(keyword(i)) + 1;
+    memcpy(text + textSize, keyword(i), length);
+    keywordOffset[i] = textSize;
+    textSize += length;
+  }
+
+  header.checksum = hash64(image + sizeof(header),
+                           header.size - sizeof(header));
+  memcpy(image, &header, sizeof(header));
+
+  bool succeeded = writeAll(aFd, image, header.size);
+  free(image);
+  return succeeded;
+}
+
+Matcher* Matcher::map(const char* aFilename, uint64_t aSourceHash) {
+  int fd = open(aFilename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno != ENOENT)
+      perror(aFilename);
+    return NULL;
+  }
+
+  struct stat status;
+  void* image = MAP_FAILED;
+  if (0 == fstat(fd, &status) && size_t(status.st_size) >= sizeof(ImageHeader))
+    image = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    fprintf(stderr, "%s: not a keyword image\n", aFilename);
+    return NULL;
+  }
+
+  const size_t size = status.st_size;
+  const ImageHeader* header = static_cast<const ImageHeader*>(image);
+  const char* base = static_cast<const char*>(image);
+  const char* problem(NULL);
+  if (0 != memcmp(header->magic, kImageMagic, sizeof(kImageMagic)))
+    problem = "not a keyword image";
+  else if (header->version != GFD_MATCHER_IMAGE_VERSION ||
+           header->byteOrder != kImageByteOrder)
+    problem = "keyword image of another version";
+  else if (header->size != size)
+    problem = "truncated keyword image";
+  else if (header->sourceHash != aSourceHash)
+    problem = "stale keyword image";
+  else if (header->checksum != hash64(base + sizeof(ImageHeader),
+                                      size - sizeof(ImageHeader)))
+    problem = "damaged keyword image";
+
+  uint64_t sizes[10];
+  sectionSizes(header, sizes);
+  uint32_t i;
+  for (i = 0; !problem && i < 10; i++) {
+    if (header->offsets[i] % kImageAlignment ||
+        header->offsets[i] > size || sizes[i] > size - header->offsets[i])
+      problem = "damaged keyword image";
+  }
+  if (problem) {
+    fprintf(stderr, "%s: %s, ignored\n", aFilename, problem);
+    munmap(image, size);
+    return NULL;
+  }
+
+  Matcher* matcher = new Matcher();
+  matcher->mImage = image;
+  matcher->mImageSize = size;
+  matcher->mKeywordCount = header->keywordCount;
+  matcher->mClassCount = header->classCount;
+  matcher->mStateCount = header->stateCount;
+  matcher->mOutCount = header->outCount;
+  memcpy(matcher->mClass, header->classes, sizeof(matcher->mClass));
+
+  /* The tables are never written to once built, mapped or not. */
+  if (header->dense) {
+    matcher->mDelta = section(image, header, eDelta);
+  }
+  else {
+    matcher->mEdgeStart = section(image, header, eEdgeStart);
+    matcher->mEdgeClass =
+      reinterpret_cast<uint8_t*>(section(image, header, eEdgeClass));
+    matcher->mEdgeTarget = section(image, header, eEdgeTarget);
+  }
+  matcher->mFail = section(image, header, eFail);
+  matcher->mOut = section(image, header, eOut);
+  matcher->mOutKeyword = section(image, header, eOutKeyword);
+  matcher->mOutNext = section(image, header, eOutNext);
+  matcher->mKeywordOffset = section(image, header, eKeywordOffset);
+  matcher->mKeywordText =
+    reinterpret_cast<const char*>(section(image, header, eKeywordText));
+
+  if (!matcher->foldKeywords()) {
+    delete matcher;
+    return NULL;
+  }
+  if (matcher->mKeywordCount <= GFD_MATCHER_SEARCH_LIMIT) {
+    matcher->mKeywordLength = static_cast<size_t*>(
+      malloc(sizeof(size_t) * (matcher->mKeywordCount?
+                               matcher->mKeywordCount : 1)));
+    if (!matcher->mKeywordLength) {
+      delete matcher;
+      return NULL;
+    }
+    for (i = 0; i < matcher->mKeywordCount; i++) {
+      const char* keyword = matcher->folded(i);
+      matcher->mKeywordLength[i] = isPattern(keyword)? 0 : strlen(keyword);
+    }
+  }
+  if (!matcher->compilePatterns()) {
+    delete matcher;
+    return NULL;
+  }
+  return matcher;
+}
+
+}
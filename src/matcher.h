@@ -0,0 +1,164 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Multi-keyword matcher.
+ *
+ * The censor list is compiled once into an Aho-Corasick automaton, so that
+ * every keyword is found in a single pass over a text fragment, no matter
+ * how many keywords there are. Matching is case-insensitive: keywords are
+ * folded with foldInto(), and scan() expects text folded likewise with
+ * foldText() (see casefold.h); ASCII letters are folded through the byte
+ * classes at no cost, so pure ASCII text may be passed as it is.
+ *
+ * All tables are flat arrays indexed by state number (no pointers between
+ * states), so the whole automaton is position independent: save() writes
+ * it, keywords included, as one image that map() uses in place, without
+ * building anything. The image starts with a header carrying a version and
+ * a checksum of the rest, and the hash of the source it was compiled from,
+ * so that a stale or damaged image is never used.
+ *
+ * Keywords written as /.../ are patterns instead, matched by their own DFA
+ * (see pattern.h) in the same scan(). Images keep their text only; they are
+ * compiled again when mapped.
+ */
+
+#ifndef GFD_MATCHER_H
+#define GFD_MATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A full state x byte-class transition table is used as long as it fits in
+ * this many bytes. Beyond that the automaton keeps only the trie edges and
+ * follows failure links while scanning. */
+#ifndef GFD_MATCHER_DENSE_LIMIT
+#define GFD_MATCHER_DENSE_LIMIT (32 * 1024 * 1024)
+#endif
+
+/* Lists of at most this many keywords are searched keyword by keyword with
+ * findCaseInsensitive(), which beats the automaton when there are only a
+ * few of them. */
+#ifndef GFD_MATCHER_SEARCH_LIMIT
+#define GFD_MATCHER_SEARCH_LIMIT 4
+#endif
+
+/* Changes whenever the layout of images, or the case folding of the
+ * keywords in them, does. */
+#define GFD_MATCHER_IMAGE_VERSION 4
+
+namespace gfd {
+
+typedef struct _PatternSet PatternSet;
+
+class Matcher {
+public:
+  /* Compiles aCount keywords. The strings are referenced, not copied, so they
+   * must outlive the matcher. Empty keywords are ignored. Returns NULL on
+   * allocation failure. */
+  static Matcher* compile(const char* const* aKeywords, uint32_t aCount);
+
+  /* Maps an image written by save(). Returns NULL if there is no such file,
+   * or (saying why on stderr) if it is of another version, damaged, or was
+   * compiled from something else than aSourceHash. */
+  static Matcher* map(const char* aFilename, uint64_t aSourceHash);
+
+  ~Matcher();
+
+  /* Writes the image to aFd. aSourceHash identifies the keywords. */
+  bool save(int aFd, uint64_t aSourceHash) const;
+
+  uint32_t count() const { return mKeywordCount; }
+  const char* keyword(uint32_t aIndex) const {
+    return mKeywords? mKeywords[aIndex] : mKeywordText + mKeywordOffset[aIndex];
+  }
+
+  /* The length in bytes of the longest keyword as it is matched (folded),
+   * which no occurrence has more characters than. Patterns count as long as
+   * they are written, which doesn't bound what repetitions match. */
+  uint32_t longestKeyword() const { return mLongestKeyword; }
+
+  /* Scans aLength bytes of aText. For every keyword i found, aHits[i] is set
+   * to 1. Returns the number of entries of aHits that were newly set.
+   * Occurrences never span two calls; each call starts from the root. When
+   * aText is part of a longer text, aWordBefore and aWordAfter say whether
+   * the characters around it are word characters, for \b and \B in
+   * patterns (see pattern.h). */
+  uint32_t scan(const char* aText, size_t aLength, uint8_t* aHits,
+                bool aWordBefore = false, bool aWordAfter = false) const;
+
+private:
+  Matcher();
+
+  uint32_t report(uint32_t aState, uint8_t* aHits) const;
+
+  /* Folds the keywords into mFolded, unless they are all ASCII, and
+   * measures mLongestKeyword. */
+  bool foldKeywords();
+  const char* folded(uint32_t aIndex) const {
+    return mFolded? mFolded[aIndex] : keyword(aIndex);
+  }
+
+  /* Builds mPatterns from the keywords that are patterns (see pattern.h),
+   * which the automaton leaves out. */
+  bool compilePatterns();
+
+  static const uint32_t kNone = 0xffffffff;
+
+  const char* const* mKeywords;
+  uint32_t mKeywordCount;
+
+  /* Instead of mKeywords, in a mapped image. */
+  const char* mKeywordText;
+  const uint32_t* mKeywordOffset;
+  void* mImage;
+  size_t mImageSize;
+
+  /* The keywords as they are matched; NULL if they are the same. */
+  const char** mFolded;
+  char* mFoldedText;
+  uint32_t mLongestKeyword;
+
+  /* Non-NULL when the list is short enough to be searched keyword by
+   * keyword. */
+  size_t* mKeywordLength;
+
+  PatternSet* mPatterns;
+
+  /* byte -> folded byte class, class 0 being "not in any keyword" */
+  uint8_t mClass[256];
+  uint32_t mClassCount;
+
+  uint32_t mStateCount;
+
+  /* Dense mode: mDelta[state * mClassCount + class] -> state. */
+  uint32_t* mDelta;
+
+  /* Sparse mode: trie edges of state s are mEdgeClass/mEdgeTarget
+   * [mEdgeStart[s], mEdgeStart[s + 1]), sorted by class. */
+  uint32_t* mEdgeStart;
+  uint8_t* mEdgeClass;
+  uint32_t* mEdgeTarget;
+  uint32_t* mFail;
+
+  /* Output chains: mOut[s] is the first output node of state s (or kNone),
+   * nodes being linked through mOutNext; a chain includes the outputs of
+   * all proper suffixes of the state. */
+  uint32_t* mOut;
+  uint32_t* mOutKeyword;
+  uint32_t* mOutNext;
+  uint32_t mOutCount;
+};
+
+}
+
+#endif /* GFD_MATCHER_H */
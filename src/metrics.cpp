@@ -0,0 +1,384 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "metrics.h"
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace gfd {
+
+static const uint32_t kPrecision = GFD_METRICS_PRECISION;
+static const uint64_t kSubBuckets = uint64_t(1) << kPrecision;
+/* Larger values (about 18 minutes, in nanoseconds) count as this one. */
+static const uint32_t kMaxExponent = 40;
+static const uint64_t kMaxValue = (uint64_t(2) << kMaxExponent) - 1;
+static const uint32_t kBucketCount =
+  (kMaxExponent - kPrecision + 2) * kSubBuckets;
+
+typedef struct _MetricsShard {
+  uint64_t counters[eCounterCount];
+  uint64_t counts[eHistogramCount];
+  uint64_t sums[eHistogramCount];
+  uint64_t maxima[eHistogramCount];
+  uint64_t buckets[eHistogramCount][kBucketCount];
+} MetricsShard;
+
+typedef struct _HistogramInfo {
+  const char* name;
+  bool time;
+} HistogramInfo;
+
+static const char* const kCounterNames[eCounterCount] = {
+  "events",
+  "round trips",
+  "nodes",
+  "texts",
+  "scanned bytes",
+  "scan time",
+  "log records",
+  "truncated scans",
+  "truncated by nodes",
+  "truncated by bytes",
+  "truncated by depth",
+  "truncated by deadline",
+  "truncated by timeout",
+  "truncated by memory",
+  "call timeouts",
+  "breaker trips",
+  "skipped events",
+  "skip.lst pages"
+};
+
+static const char* const kGaugeNames[eGaugeCount] = {
+  "open breakers"
+};
+
+static const HistogramInfo kHistograms[eHistogramCount] = {
+  { "event latency", true },
+  { "round trips per event", false },
+  { "nodes per event", false },
+  { "bytes per event", false },
+  { "GetItems", true },
+  { "GetInterfaces", true },
+  { "Get CharacterCount", true },
+  { "GetText", true },
+  { "Get ChildCount", true },
+  { "GetChildAtIndex", true },
+  { "GetAll Text", true },
+  { "GetAll Accessible", true },
+  { "GetChildren", true },
+  { "GetState", true },
+  { "Get Parent", true },
+  { "log flush", true }
+};
+
+static const uint64_t sStart = metricsClock();
+
+#if GFD_METRICS
+
+static MetricsShard* sShards[GFD_METRICS_THREADS];
+static uint32_t sShardCount(0);
+static MetricsShard sSharedShard;
+static __thread MetricsShard* tShard(NULL);
+static uint64_t sGauges[eGaugeCount];
+
+static MetricsShard* shard() {
+  MetricsShard* shard = tShard;
+  if (shard)
+    return shard;
+
+  shard = &sSharedShard;
+  uint32_t index = __atomic_fetch_add(&sShardCount, 1, __ATOMIC_RELAXED);
+  if (index < GFD_METRICS_THREADS) {
+    MetricsShard* own =
+      static_cast<MetricsShard*>(calloc(1, sizeof(MetricsShard)));
+    if (own) {
+      __atomic_store_n(&sShards[index], own, __ATOMIC_RELEASE);
+      shard = own;
+    }
+  }
+  tShard = shard;
+  return shard;
+}
+
+/* Only the owner of a shard writes it, so a plain read-modify-write is
+ * enough, as long as readers see whole values. */
+static inline void add(MetricsShard* aShard, uint64_t* aCell,
+                       uint64_t aValue) {
+  if (aShard == &sSharedShard)
+    __atomic_add_fetch(aCell, aValue, __ATOMIC_RELAXED);
+  else
+    __atomic_store_n(aCell, __atomic_load_n(aCell, __ATOMIC_RELAXED) + aValue,
+                     __ATOMIC_RELAXED);
+}
+
+static inline uint32_t bucketOf(uint64_t aValue) {
+  if (aValue > kMaxValue)
+    aValue = kMaxValue;
+  if (aValue < kSubBuckets)
+    return uint32_t(aValue);
+  uint32_t exponent = 63 - __builtin_clzll(aValue);
+  return (exponent - kPrecision) * kSubBuckets +
+         uint32_t(aValue >> (exponent - kPrecision));
+}
+
+void addCounter(MetricCounter aCounter, uint64_t aValue) {
+  MetricsShard* s = shard();
+  add(s, &s->counters[aCounter], aValue);
+}
+
+void setGauge(MetricGauge aGauge, uint64_t aValue) {
+  __atomic_store_n(&sGauges[aGauge], aValue, __ATOMIC_RELAXED);
+}
+
+void recordValue(MetricHistogram aHistogram, uint64_t aValue) {
+  MetricsShard* s = shard();
+  add(s, &s->buckets[aHistogram][bucketOf(aValue)], 1);
+  add(s, &s->counts[aHistogram], 1);
+  add(s, &s->sums[aHistogram], aValue);
+
+  uint64_t* maximum = &s->maxima[aHistogram];
+  uint64_t current = __atomic_load_n(maximum, __ATOMIC_RELAXED);
+  while (aValue > current &&
+         !__atomic_compare_exchange_n(maximum, &current, aValue, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+static void addShard(MetricsShard* aTotal, const MetricsShard* aShard) {
+  uint32_t i;
+  for (i = 0; i < eCounterCount; i++)
+    aTotal->counters[i] += __atomic_load_n(&aShard->counters[i],
+                                           __ATOMIC_RELAXED);
+  for (i = 0; i < eHistogramCount; i++) {
+    aTotal->counts[i] += __atomic_load_n(&aShard->counts[i],
+                                         __ATOMIC_RELAXED);
+    aTotal->sums[i] += __atomic_load_n(&aShard->sums[i], __ATOMIC_RELAXED);
+    uint64_t maximum = __atomic_load_n(&aShard->maxima[i], __ATOMIC_RELAXED);
+    if (maximum > aTotal->maxima[i])
+      aTotal->maxima[i] = maximum;
+    uint32_t j;
+    for (j = 0; j < kBucketCount; j++)
+      aTotal->buckets[i][j] += __atomic_load_n(&aShard->buckets[i][j],
+                                               __ATOMIC_RELAXED);
+  }
+}
+
+#endif /* GFD_METRICS */
+
+/* The highest value bucket aIndex stands for. */
+static uint64_t bucketValue(uint32_t aIndex) {
+  if (aIndex < kSubBuckets)
+    return aIndex;
+  uint32_t exponent = aIndex / kSubBuckets - 1 + kPrecision;
+  uint64_t low = (aIndex % kSubBuckets + kSubBuckets) <<
+                 (exponent - kPrecision);
+  return low + (uint64_t(1) << (exponent - kPrecision)) - 1;
+}
+
+/* A growing string. */
+typedef struct _Text {
+  char* data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} Text;
+
+static void appendf(Text* aText, const char* aFormat, ...)
+  __attribute__((format(printf, 2, 3)));
+
+static void appendf(Text* aText, const char* aFormat, ...) {
+  if (aText->failed)
+    return;
+
+  for (;;) {
+    va_list args;
+    va_start(args, aFormat);
+    int length = vsnprintf(aText->data + aText->length,
+                           aText->capacity - aText->length, aFormat, args);
+    va_end(args);
+    if (length < 0) {
+      aText->failed = true;
+      return;
+    }
+    if (aText->length + length < aText->capacity) {
+      aText->length += length;
+      return;
+    }
+
+    size_t capacity = aText->capacity * 2 + length;
+    char* data = static_cast<char*>(realloc(aText->data, capacity));
+    if (!data) {
+      aText->failed = true;
+      return;
+    }
+    aText->data = data;
+    aText->capacity = capacity;
+  }
+}
+
+static void appendValue(Text* aText, uint64_t aValue, bool aTime) {
+  if (!aTime)
+    appendf(aText, " %10llu", static_cast<unsigned long long>(aValue));
+  else if (aValue < 1000)
+    appendf(aText, " %7llu ns", static_cast<unsigned long long>(aValue));
+  else if (aValue < 1000000)
+    appendf(aText, " %7.1f us", aValue / 1e3);
+  else if (aValue < 1000000000)
+    appendf(aText, " %7.1f ms", aValue / 1e6);
+  else
+    appendf(aText, " %7.2f s ", aValue / 1e9);
+}
+
+static void appendHistogram(Text* aText, const MetricsShard* aTotal,
+                            uint32_t aHistogram) {
+  static const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+  const uint64_t count = aTotal->counts[aHistogram];
+  const bool time = kHistograms[aHistogram].time;
+
+  appendf(aText, "%-22s %10llu", kHistograms[aHistogram].name,
+          static_cast<unsigned long long>(count));
+
+  uint64_t seen = 0;
+  uint32_t bucket = 0;
+  uint32_t q;
+  for (q = 0; q < sizeof(kQuantiles) / sizeof(kQuantiles[0]); q++) {
+    uint64_t rank = uint64_t(kQuantiles[q] * count + 0.5);
+    if (rank < 1)
+      rank = 1;
+    while (bucket < kBucketCount &&
+           seen + aTotal->buckets[aHistogram][bucket] < rank)
+      seen += aTotal->buckets[aHistogram][bucket++];
+    uint64_t value = bucketValue(bucket);
+    if (value > aTotal->maxima[aHistogram])
+      value = aTotal->maxima[aHistogram];
+    appendValue(aText, value, time);
+  }
+  appendValue(aText, aTotal->maxima[aHistogram], time);
+  appendValue(aText, aTotal->sums[aHistogram] / count, time);
+  appendf(aText, "\n");
+}
+
+char* formatMetrics() {
+  MetricsShard* total =
+    static_cast<MetricsShard*>(calloc(1, sizeof(MetricsShard)));
+  if (!total)
+    return NULL;
+
+#if GFD_METRICS
+  uint32_t shardCount = __atomic_load_n(&sShardCount, __ATOMIC_RELAXED);
+  if (shardCount > GFD_METRICS_THREADS)
+    shardCount = GFD_METRICS_THREADS;
+  uint32_t s;
+  for (s = 0; s < shardCount; s++) {
+    const MetricsShard* shard = __atomic_load_n(&sShards[s], __ATOMIC_ACQUIRE);
+    if (shard)
+      addShard(total, shard);
+  }
+  addShard(total, &sSharedShard);
+#endif
+
+  Text text;
+  memset(&text, 0, sizeof(text));
+
+  const double uptime = (metricsClock() - sStart) / 1e9;
+  const uint64_t* counters = total->counters;
+  const uint64_t events = counters[eCounterEvents];
+  appendf(&text, "%-22s %10.1f s\n", "uptime", uptime);
+
+  uint32_t i;
+  for (i = 0; i < eCounterCount; i++) {
+    appendf(&text, "%-22s %10llu", kCounterNames[i],
+            static_cast<unsigned long long>(counters[i]));
+    if (i == eCounterEvents && uptime > 0)
+      appendf(&text, " (%.2f/s)", events / uptime);
+    else if (i == eCounterScanTime)
+      appendf(&text, " ns");
+    else if (i != eCounterScannedBytes && i != eCounterLogRecords && events)
+      appendf(&text, " (%.1f per event)", double(counters[i]) / events);
+    appendf(&text, "\n");
+  }
+#if GFD_METRICS
+  for (i = 0; i < eGaugeCount; i++) {
+    appendf(&text, "%-22s %10llu\n", kGaugeNames[i],
+            static_cast<unsigned long long>(
+              __atomic_load_n(&sGauges[i], __ATOMIC_RELAXED)));
+  }
+#endif
+  if (counters[eCounterScanTime]) {
+    appendf(&text, "%-22s %10.2f GB/s, %.3f ns/byte\n", "matcher throughput",
+            double(counters[eCounterScannedBytes]) /
+              counters[eCounterScanTime],
+            double(counters[eCounterScanTime]) /
+              (counters[eCounterScannedBytes]?
+                 counters[eCounterScannedBytes] : 1));
+  }
+
+  appendf(&text, "\n%-22s %10s %10s %10s %10s %10s %10s %10s\n", "",
+          "count", "p50", "p90", "p99", "p99.9", "max", "mean");
+  for (i = 0; i < eHistogramCount; i++) {
+    if (total->counts[i])
+      appendHistogram(&text, total, i);
+  }
+
+  free(total);
+  if (text.failed) {
+    free(text.data);
+    return NULL;
+  }
+  return text.data;
+}
+
+bool writeMetrics(const char* aFilename) {
+  char* text = formatMetrics();
+  if (!text)
+    return false;
+
+  size_t length = strlen(aFilename);
+  char* temporary = static_cast<char*>(malloc(length + sizeof(".tmp")));
+  if (!temporary) {
+    free(text);
+    return false;
+  }
+  memcpy(temporary, aFilename, length);
+  memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+  bool succeeded = false;
+  int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    perror(temporary);
+  }
+  else {
+    size_t size = strlen(text);
+    succeeded = (write(fd, text, size) == ssize_t(size));
+    if (0 != close(fd))
+      succeeded = false;
+    if (succeeded && 0 != rename(temporary, aFilename))
+      succeeded = false;
+    if (!succeeded) {
+      perror(aFilename);
+      unlink(temporary);
+    }
+  }
+
+  free(temporary);
+  free(text);
+  return succeeded;
+}
+
+}
@@ -0,0 +1,136 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Metrics.
+ *
+ * Counters and histograms recorded from any thread, without locks: each
+ * thread adds to a shard of its own (allocated the first time it records
+ * anything), which only it writes, and readers add the shards up. Threads
+ * beyond GFD_METRICS_THREADS share one more shard, with atomic additions.
+ *
+ * Histograms are HDR-style: values are counted in buckets whose width
+ * grows with the value, 2^GFD_METRICS_PRECISION buckets per power of 2, so
+ * that any percentile is known within 1 / 2^GFD_METRICS_PRECISION of the
+ * value (6% by default) from nanoseconds up to minutes, in a fixed few
+ * kilobytes. Latencies are recorded in nanoseconds of CLOCK_MONOTONIC.
+ *
+ * formatMetrics() renders everything as text: totals, rates and the
+ * percentiles of each histogram.
+ */
+
+#ifndef GFD_METRICS_H
+#define GFD_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* 0 compiles recording out. */
+#ifndef GFD_METRICS
+#define GFD_METRICS 1
+#endif
+
+#ifndef GFD_METRICS_THREADS
+#define GFD_METRICS_THREADS 40
+#endif
+
+#ifndef GFD_METRICS_PRECISION
+#define GFD_METRICS_PRECISION 4
+#endif
+
+namespace gfd {
+
+typedef enum {
+  eCounterEvents,        /* handled by filter() or rescan() */
+  eCounterRoundTrips,    /* made for them */
+  eCounterNodes,         /* visited by copyTexts() */
+  eCounterTexts,         /* fragments collected */
+  eCounterScannedBytes,  /* given to the matcher */
+  eCounterScanTime,      /* spent in the matcher, in nanoseconds */
+  eCounterLogRecords,
+  eCounterTruncated,     /* walks that ran out of a budget */
+  /* the budget they ran out of (WalkTruncation) */
+  eCounterTruncatedNodes,
+  eCounterTruncatedBytes,
+  eCounterTruncatedDepth,
+  eCounterTruncatedDeadline,
+  eCounterTruncatedTimeout,
+  eCounterTruncatedMemory,
+  eCounterCallTimeouts,  /* calls that got no reply in GFD_CALL_TIMEOUT */
+  eCounterBreakerTrips,  /* senders given up on for a while (breaker.h) */
+  eCounterSkipped,       /* events of those senders, not scanned */
+  eCounterSkipListed,    /* pages not scanned because of skip.lst */
+  eCounterCount
+} MetricCounter;
+
+typedef enum {
+  eHistogramEventLatency,     /* from the signal to the end of its scan */
+  eHistogramEventRoundTrips,
+  eHistogramEventNodes,
+  eHistogramEventBytes,
+  /* latency of each D-Bus method, from the call to its reply */
+  eHistogramGetItems,
+  eHistogramGetInterfaces,
+  eHistogramGetCharacterCount,
+  eHistogramGetText,
+  eHistogramGetChildCount,
+  eHistogramGetChildAtIndex,
+  eHistogramGetAllText,
+  eHistogramGetAllAccessible,
+  eHistogramGetChildren,
+  eHistogramGetState,
+  eHistogramGetParent,
+  eHistogramLogFlush,         /* writing out one batch of records */
+  eHistogramCount
+} MetricHistogram;
+
+/* Values that are set rather than added to, by whoever knows them. */
+typedef enum {
+  eGaugeOpenBreakers,         /* senders whose events are being skipped */
+  eGaugeCount
+} MetricGauge;
+
+static inline uint64_t metricsClock() {
+#if GFD_METRICS
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
+#if GFD_METRICS
+
+void addCounter(MetricCounter aCounter, uint64_t aValue);
+void recordValue(MetricHistogram aHistogram, uint64_t aValue);
+void setGauge(MetricGauge aGauge, uint64_t aValue);
+
+#else
+
+static inline void addCounter(MetricCounter, uint64_t) {}
+static inline void recordValue(MetricHistogram, uint64_t) {}
+static inline void setGauge(MetricGauge, uint64_t) {}
+
+#endif
+
+/* Everything recorded so far, as text; NULL on allocation failure. The
+ * caller frees it. */
+char* formatMetrics();
+
+/* Rewrites aFilename with formatMetrics(), atomically. */
+bool writeMetrics(const char* aFilename);
+
+}
+
+#endif /* GFD_METRICS_H */
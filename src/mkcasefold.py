@@ -0,0 +1,132 @@
+#!/usr/bin/python3
+#
+# Generates casefoldtable.h, the folding table of casefold.cpp, from the
+# CaseFolding.txt of the Unicode Character Database:
+#
+#   $ python3 src/mkcasefold.py CaseFolding.txt > src/casefoldtable.h
+#
+# Only the simple folding (statuses C and S) is used. Code points whose
+# folding is longer in UTF-8 than they are are left out, as foldInto()
+# never lengthens a text.
+
+import sys
+
+BLOCK_BITS = 7
+DENSE_END = 0x800 # two bytes of UTF-8
+
+BANNER = """\
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+"""
+
+
+def utf8Length(aCodePoint):
+  return len(chr(aCodePoint).encode("utf-8", "surrogatepass"))
+
+
+def readFolding(aFile):
+  version = None
+  folding = {}
+  for line in aFile:
+    if line.startswith("#") and version is None:
+      version = line[1:].split(",")[0].strip()
+    line = line.split("#")[0].strip()
+    if not line:
+      continue
+    fields = [field.strip() for field in line.split(";")]
+    if fields[1] in ("C", "S"):
+      folding[int(fields[0], 16)] = int(fields[2], 16)
+  return version, folding
+
+
+# Sorted, disjoint ranges (first, last, delta, alternate): every code point
+# of the range, or every other one from first, folds to itself + delta.
+def makeRanges(aFolding):
+  ranges = []
+  for codePoint in sorted(aFolding):
+    delta = aFolding[codePoint] - codePoint
+    if ranges:
+      first, last, lastDelta, alternate = ranges[-1]
+      if delta == lastDelta:
+        if codePoint == last + 1 and (not alternate or first == last):
+          ranges[-1] = (first, codePoint, delta, False)
+          continue
+        if (codePoint == last + 2 and (alternate or first == last) and
+            last + 1 not in aFolding):
+          ranges[-1] = (first, codePoint, delta, True)
+          continue
+    ranges.append((codePoint, codePoint, delta, False))
+  return ranges
+
+
+def main():
+  if len(sys.argv) != 2:
+    sys.stderr.write("usage: mkcasefold.py CaseFolding.txt\n")
+    return 1
+
+  with open(sys.argv[1]) as data:
+    version, folding = readFolding(data)
+
+  longer = sorted(codePoint for codePoint in folding
+                  if utf8Length(folding[codePoint]) > utf8Length(codePoint))
+  for codePoint in longer:
+    del folding[codePoint]
+
+  out = sys.stdout
+  out.write(BANNER)
+  out.write("\n/* Generated by mkcasefold.py from %s; do not edit.\n"
+            % (version or "CaseFolding.txt"))
+  out.write(" * Left out, folding to longer UTF-8: %s. */\n"
+            % ", ".join("U+%04X" % codePoint for codePoint in longer))
+  # Deltas of U+0080 to DENSE_END, the most common non-ASCII letters.
+  deltas = [folding.get(codePoint, codePoint) - codePoint
+            for codePoint in range(0x80, DENSE_END)]
+  assert all(-32768 <= delta < 32768 for delta in deltas)
+  out.write("\n#define GFD_FOLD_DENSE_END 0x%04x\n" % DENSE_END)
+  out.write("\nstatic const int16_t kFoldDeltas[] = {")
+  for i, delta in enumerate(deltas):
+    out.write(("\n  " if i % 12 == 0 else " ") + "%4d" % delta +
+              ("," if i + 1 < len(deltas) else "\n"))
+  out.write("};\n")
+
+  out.write("\nstatic const FoldRange kFoldRanges[] = {\n")
+  ranges = makeRanges(dict((codePoint, folding[codePoint])
+                            for codePoint in folding
+                            if codePoint >= DENSE_END))
+  for i, (first, last, delta, alternate) in enumerate(ranges):
+    out.write("  { 0x%04x, 0x%04x, %d, %s }%s\n"
+              % (first, last, delta, "true" if alternate else "false",
+                 "," if i + 1 < len(ranges) else ""))
+  out.write("};\n")
+
+  # For each block of 1 << BLOCK_BITS code points, the first range that
+  # doesn't end before it.
+  blocks = []
+  for block in range((ranges[-1][1] >> BLOCK_BITS) + 1):
+    index = 0
+    while ranges[index][1] < block << BLOCK_BITS:
+      index += 1
+    blocks.append(index)
+  assert len(ranges) <= 256
+
+  out.write("\n#define GFD_FOLD_BLOCK_BITS %d\n" % BLOCK_BITS)
+  out.write("\nstatic const uint8_t kFoldBlocks[] = {")
+  for i, index in enumerate(blocks):
+    out.write(("\n  " if i % 12 == 0 else " ") + "%3d" % index +
+              ("," if i + 1 < len(blocks) else "\n"))
+  out.write("};\n")
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
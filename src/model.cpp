@@ -0,0 +1,255 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "model.h"
+
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace gfd {
+
+struct _DocumentModel {
+  Document* documents[GFD_MODEL_DOCUMENTS];
+  uint32_t clock;
+
+  ModelNode** buckets;
+  uint32_t bucketCount; /* power of 2 */
+  uint32_t nodeCount;
+
+  /* the nodes that belong to no document */
+  ModelNode* outside;
+  uint32_t outsideCount;
+};
+
+static uint64_t keyHash(const char* aSender, const char* aPath) {
+  return hash64(aPath, strlen(aPath), hash64(aSender, strlen(aSender)));
+}
+
+static ModelNode** findLink(DocumentModel* aModel, const char* aSender,
+                            const char* aPath, uint64_t aHash) {
+  ModelNode** link = &aModel->buckets[aHash & (aModel->bucketCount - 1)];
+  while (*link && ((*link)->keyHash != aHash ||
+                   0 != strcmp((*link)->path, aPath) ||
+                   0 != strcmp((*link)->sender, aSender)))
+    link = &(*link)->chain;
+  return link;
+}
+
+static bool growBuckets(DocumentModel* aModel) {
+  uint32_t count = aModel->bucketCount? aModel->bucketCount * 2 : 1024;
+  ModelNode** buckets =
+    static_cast<ModelNode**>(calloc(count, sizeof(ModelNode*)));
+  if (!buckets)
+    return false;
+
+  uint32_t i;
+  for (i = 0; i < aModel->bucketCount; i++) {
+    ModelNode* node = aModel->buckets[i];
+    while (node) {
+      ModelNode* chain = node->chain;
+      ModelNode** link = &buckets[node->keyHash & (count - 1)];
+      node->chain = *link;
+      *link = node;
+      node = chain;
+    }
+  }
+  free(aModel->buckets);
+  aModel->buckets = buckets;
+  aModel->bucketCount = count;
+  return true;
+}
+
+static ModelNode** listOf(DocumentModel* aModel, Document* aDocument) {
+  return aDocument? &aDocument->nodes : &aModel->outside;
+}
+
+static void unlinkNode(DocumentModel* aModel, ModelNode* aNode) {
+  if (aNode->previous)
+    aNode->previous->next = aNode->next;
+  else
+    *listOf(aModel, aNode->document) = aNode->next;
+  if (aNode->next)
+    aNode->next->previous = aNode->previous;
+  if (!aNode->document)
+    aModel->outsideCount--;
+}
+
+static void linkNode(DocumentModel* aModel, ModelNode* aNode,
+                     Document* aDocument) {
+  ModelNode** list = listOf(aModel, aDocument);
+  aNode->document = aDocument;
+  aNode->previous = NULL;
+  aNode->next = *list;
+  if (*list)
+    (*list)->previous = aNode;
+  *list = aNode;
+  if (!aDocument)
+    aModel->outsideCount++;
+}
+
+static void removeNode(DocumentModel* aModel, ModelNode* aNode) {
+  ModelNode** link = findLink(aModel, aNode->sender, aNode->path,
+                              aNode->keyHash);
+  *link = aNode->chain;
+  unlinkNode(aModel, aNode);
+  aModel->nodeCount--;
+  free(aNode->sender);
+  free(aNode->path);
+  delete aNode;
+}
+
+static void clearNodes(DocumentModel* aModel, Document* aDocument) {
+  ModelNode** list = listOf(aModel, aDocument);
+  while (*list)
+    removeNode(aModel, *list);
+}
+
+static void freeDocument(DocumentModel* aModel, Document* aDocument) {
+  clearNodes(aModel, aDocument);
+  free(aDocument->sender);
+  free(aDocument->path);
+  free(aDocument->title);
+  free(aDocument->url);
+  free(aDocument->hits);
+  delete aDocument;
+}
+
+static char* copyString(const char* aString) {
+  return strdup(aString? aString : "");
+}
+
+DocumentModel* newDocumentModel() {
+  DocumentModel* model = new DocumentModel();
+  memset(model, 0, sizeof(DocumentModel));
+  if (!growBuckets(model)) {
+    delete model;
+    return NULL;
+  }
+  return model;
+}
+
+void freeDocumentModel(DocumentModel* aModel) {
+  if (!aModel)
+    return;
+
+  uint32_t i;
+  for (i = 0; i < GFD_MODEL_DOCUMENTS; i++) {
+    if (aModel->documents[i])
+      freeDocument(aModel, aModel->documents[i]);
+  }
+  clearNodes(aModel, NULL);
+  free(aModel->buckets);
+  delete aModel;
+}
+
+Document* openDocument(DocumentModel* aModel, const char* aSender,
+                       const char* aPath, const char* aTitle,
+                       const char* aUrl, uint32_t aGeneration,
+                       uint32_t aKeywordCount) {
+  /* The same document again, or else a free or the least recently used
+   * slot. */
+  uint32_t slot = 0;
+  uint32_t i;
+  for (i = 0; i < GFD_MODEL_DOCUMENTS; i++) {
+    Document* document = aModel->documents[i];
+    if (!document ||
+        (0 == strcmp(document->sender, aSender) &&
+         0 == strcmp(document->path, aPath))) {
+      slot = i;
+      break;
+    }
+    if (document->lastUsed < aModel->documents[slot]->lastUsed)
+      slot = i;
+  }
+  if (aModel->documents[slot]) {
+    freeDocument(aModel, aModel->documents[slot]);
+    aModel->documents[slot] = NULL;
+  }
+
+  /* Objects of the chrome may have become part of the new document. */
+  clearNodes(aModel, NULL);
+
+  Document* document = new Document();
+  memset(document, 0, sizeof(Document));
+  document->sender = copyString(aSender);
+  document->path = copyString(aPath);
+  document->title = copyString(aTitle);
+  document->url = copyString(aUrl);
+  document->hits = static_cast<uint8_t*>(calloc(aKeywordCount + 1, 1));
+  document->keywordCount = aKeywordCount;
+  document->generation = aGeneration;
+  document->lastUsed = ++aModel->clock;
+  aModel->documents[slot] = document;
+
+  if (!document->sender || !document->path || !document->title ||
+      !document->url || !document->hits ||
+      !addNode(aModel, aSender, aPath, document)) {
+    freeDocument(aModel, document);
+    aModel->documents[slot] = NULL;
+    return NULL;
+  }
+  return document;
+}
+
+ModelNode* addNode(DocumentModel* aModel, const char* aSender,
+                   const char* aPath, Document* aDocument) {
+  const uint64_t hash = keyHash(aSender, aPath);
+  ModelNode* node = *findLink(aModel, aSender, aPath, hash);
+  if (node) {
+    if (node->document != aDocument) {
+      unlinkNode(aModel, node);
+      linkNode(aModel, node, aDocument);
+    }
+  }
+  else {
+    if (!aDocument && aModel->outsideCount >= GFD_MODEL_OUTSIDE_NODES)
+      clearNodes(aModel, NULL);
+    if (aModel->nodeCount >= aModel->bucketCount && !growBuckets(aModel))
+      return NULL;
+
+    node = new ModelNode();
+    memset(node, 0, sizeof(ModelNode));
+    node->sender = strdup(aSender);
+    node->path = strdup(aPath);
+    if (!node->sender || !node->path) {
+      free(node->sender);
+      free(node->path);
+      delete node;
+      return NULL;
+    }
+    node->keyHash = hash;
+
+    ModelNode** link = &aModel->buckets[hash & (aModel->bucketCount - 1)];
+    node->chain = *link;
+    *link = node;
+    aModel->nodeCount++;
+    linkNode(aModel, node, aDocument);
+  }
+
+  if (aDocument)
+    aDocument->lastUsed = ++aModel->clock;
+  return node;
+}
+
+ModelNode* findNode(DocumentModel* aModel, const char* aSender,
+                    const char* aPath) {
+  ModelNode* node =
+    *findLink(aModel, aSender, aPath, keyHash(aSender, aPath));
+  if (node && node->document)
+    node->document->lastUsed = ++aModel->clock;
+  return node;
+}
+
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* What is known about the documents open in the applications.
+ *
+ * A document is known from its LoadComplete scan on: its title and URL,
+ * which keywords have been found in it so far, and the accessible objects
+ * that belong to it, with the hash of their text. Change events name an
+ * object, not a document, so objects are looked up here by (bus name,
+ * path). Objects found not to belong to any document are remembered too,
+ * so that events from e.g. the URL bar cost nothing the second time.
+ *
+ * A model is used by one thread only. It holds at most GFD_MODEL_DOCUMENTS
+ * documents and forgets the least recently used one first.
+ */
+
+#ifndef GFD_MODEL_H
+#define GFD_MODEL_H
+
+#include <stdint.h>
+
+#ifndef GFD_MODEL_DOCUMENTS
+#define GFD_MODEL_DOCUMENTS 16
+#endif
+
+/* Objects outside of any document remembered at most. */
+#ifndef GFD_MODEL_OUTSIDE_NODES
+#define GFD_MODEL_OUTSIDE_NODES 4096
+#endif
+
+namespace gfd {
+
+typedef struct _ModelNode ModelNode;
+
+typedef struct _Document {
+  char* sender;
+  char* path;
+  char* title;
+  char* url;
+
+  uint8_t* hits; /* per keyword of the list of that generation */
+  uint32_t keywordCount;
+  uint32_t generation;
+  uint32_t found;
+
+  /* private */
+  ModelNode* nodes;
+  uint32_t lastUsed;
+} Document;
+
+struct _ModelNode {
+  Document* document; /* NULL: not in any document */
+  uint64_t textHash;  /* 0: no text seen, or one read in windows */
+
+  /* private */
+  char* sender;
+  char* path;
+  uint64_t keyHash;
+  ModelNode* chain;    /* next in the bucket */
+  ModelNode* next;     /* nodes of the same document */
+  ModelNode* previous;
+};
+
+typedef struct _DocumentModel DocumentModel;
+
+DocumentModel* newDocumentModel();
+void freeDocumentModel(DocumentModel* aModel);
+
+/* Starts the model of a (re)loaded document over, without any node or hit.
+ * Returns NULL on allocation failure. */
+Document* openDocument(DocumentModel* aModel, const char* aSender,
+                       const char* aPath, const char* aTitle,
+                       const char* aUrl, uint32_t aGeneration,
+                       uint32_t aKeywordCount);
+
+/* Records that the object belongs to aDocument (NULL: to none), or returns
+ * the node already recorded. Returns NULL on allocation failure. */
+ModelNode* addNode(DocumentModel* aModel, const char* aSender,
+                   const char* aPath, Document* aDocument);
+
+ModelNode* findNode(DocumentModel* aModel, const char* aSender,
+                    const char* aPath);
+
+}
+
+#endif /* GFD_MODEL_H */
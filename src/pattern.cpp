@@ -0,0 +1,1046 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "pattern.h"
+#include "casefold.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace gfd {
+
+/* NFA instructions */
+enum OpCode {
+  eOpByte,        /* consume a byte of set arg, go to x */
+  eOpSplit,       /* go to x and to y */
+  eOpBoundary,    /* go to x at a word boundary */
+  eOpNotBoundary, /* go to x anywhere else */
+  eOpMatch        /* pattern arg matched */
+};
+
+typedef struct _Op {
+  uint32_t code;
+  uint32_t x;
+  uint32_t y;
+  uint32_t arg;
+} Op;
+
+typedef struct _ByteSet {
+  uint32_t bits[8];
+} ByteSet;
+
+struct _PatternSet {
+  uint64_t serial; /* tells the per-thread DFAs apart */
+
+  Op* ops;
+  uint32_t opCount;
+  uint32_t opCapacity;
+
+  ByteSet* sets;
+  uint32_t setCount;
+  uint32_t setCapacity;
+
+  uint32_t* starts;       /* first instruction of each pattern that parsed */
+  uint32_t startCount;
+
+  uint32_t* keywordIndex; /* per pattern */
+  uint32_t patternCount;
+};
+
+static uint64_t sSerial(0);
+
+template<typename T>
+static bool grow(T** aArray, uint32_t* aCapacity, uint32_t aNeeded) {
+  if (aNeeded <= *aCapacity)
+    return true;
+
+  uint32_t capacity = *aCapacity? *aCapacity : 64;
+  while (capacity < aNeeded)
+    capacity *= 2;
+
+  T* array = static_cast<T*>(realloc(*aArray, sizeof(T) * capacity));
+  if (!array)
+    return false;
+
+  *aArray = array;
+  *aCapacity = capacity;
+  return true;
+}
+
+static inline bool hasByte(const ByteSet* aSet, uint8_t aByte) {
+  return aSet->bits[aByte >> 5] & (1u << (aByte & 31));
+}
+
+static inline void addByte(ByteSet* aSet, uint8_t aByte) {
+  aSet->bits[aByte >> 5] |= 1u << (aByte & 31);
+}
+
+static void addRange(ByteSet* aSet, uint8_t aFirst, uint8_t aLast) {
+  uint32_t byte;
+  for (byte = aFirst; byte <= aLast; byte++)
+    addByte(aSet, uint8_t(byte));
+}
+
+/* Same folding as the literal keywords: ASCII letters only. */
+static void foldSet(ByteSet* aSet) {
+  uint8_t byte;
+  for (byte = 'a'; byte <= 'z'; byte++) {
+    uint8_t upper = uint8_t(byte - ('a' - 'A'));
+    if (hasByte(aSet, byte) || hasByte(aSet, upper)) {
+      addByte(aSet, byte);
+      addByte(aSet, upper);
+    }
+  }
+}
+
+static void invertSet(ByteSet* aSet) {
+  uint32_t i;
+  for (i = 0; i < 8; i++)
+    aSet->bits[i] = ~aSet->bits[i];
+}
+
+/* \d \w \s and their complements; false for any other letter. */
+static bool classEscape(char aLetter, ByteSet* aSet) {
+  memset(aSet, 0, sizeof(ByteSet));
+  switch (aLetter | 0x20) {
+  case 'd':
+    addRange(aSet, '0', '9');
+    break;
+  case 'w':
+    addRange(aSet, 'a', 'z');
+    addRange(aSet, 'A', 'Z');
+    addRange(aSet, '0', '9');
+    addByte(aSet, '_');
+    addRange(aSet, 0x80, 0xff);
+    break;
+  case 's':
+    addByte(aSet, ' ');
+    addRange(aSet, '\t', '\r');
+    break;
+  default:
+    return false;
+  }
+  if (aLetter >= 'A' && aLetter <= 'Z')
+    invertSet(aSet);
+  return true;
+}
+
+/* Syntax tree */
+enum NodeKind {
+  eNodeEmpty,
+  eNodeSet,
+  eNodeConcat,
+  eNodeAlternate,
+  eNodeRepeat,
+  eNodeBoundary,
+  eNodeNotBoundary
+};
+
+typedef struct _Node {
+  uint32_t kind;
+  uint32_t set;
+  uint32_t left;
+  uint32_t right;
+  int min;
+  int max; /* -1: unbounded */
+} Node;
+
+typedef struct _Parser {
+  PatternSet* patterns;
+  const char* text;
+  const char* position;
+  const char* end;
+  const char* error;
+
+  Node* nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+} Parser;
+
+static const uint32_t kNoNode = 0xffffffff;
+
+static uint32_t newNode(Parser* aParser, uint32_t aKind,
+                        uint32_t aLeft = kNoNode, uint32_t aRight = kNoNode) {
+  if (!grow(&aParser->nodes, &aParser->nodeCapacity, aParser->nodeCount + 1)) {
+    aParser->error = "out of memory";
+    return kNoNode;
+  }
+  Node* node = &aParser->nodes[aParser->nodeCount];
+  memset(node, 0, sizeof(Node));
+  node->kind = aKind;
+  node->left = aLeft;
+  node->right = aRight;
+  return aParser->nodeCount++;
+}
+
+static uint32_t newSetNode(Parser* aParser, const ByteSet* aSet) {
+  PatternSet* patterns = aParser->patterns;
+  if (!grow(&patterns->sets, &patterns->setCapacity, patterns->setCount + 1)) {
+    aParser->error = "out of memory";
+    return kNoNode;
+  }
+  uint32_t node = newNode(aParser, eNodeSet);
+  if (node == kNoNode)
+    return kNoNode;
+  patterns->sets[patterns->setCount] = *aSet;
+  aParser->nodes[node].set = patterns->setCount++;
+  return node;
+}
+
+static inline bool atEnd(const Parser* aParser) {
+  return aParser->error || aParser->position == aParser->end;
+}
+
+static uint32_t parseAlternate(Parser* aParser);
+
+static uint32_t parseClass(Parser* aParser) {
+  ByteSet set;
+  memset(&set, 0, sizeof(set));
+
+  bool negated = false;
+  if (!atEnd(aParser) && *aParser->position == '^') {
+    negated = true;
+    aParser->position++;
+  }
+
+  bool first = true;
+  for (;;) {
+    if (atEnd(aParser)) {
+      aParser->error = "missing ]";
+      return kNoNode;
+    }
+    uint8_t low = uint8_t(*aParser->position++);
+    if (low == ']' && !first)
+      break;
+    first = false;
+
+    if (low == '\\') {
+      if (atEnd(aParser)) {
+        aParser->error = "trailing \\";
+        return kNoNode;
+      }
+      char letter = *aParser->position++;
+      ByteSet escaped;
+      if (classEscape(letter, &escaped)) {
+        uint32_t i;
+        for (i = 0; i < 8; i++)
+          set.bits[i] |= escaped.bits[i];
+        continue;
+      }
+      low = uint8_t(letter == 'n'? '\n' : letter == 't'? '\t' :
+                    letter == 'r'? '\r' : letter);
+    }
+
+    uint8_t high = low;
+    if (aParser->end - aParser->position >= 2 &&
+        aParser->position[0] == '-' && aParser->position[1] != ']') {
+      high = uint8_t(aParser->position[1]);
+      aParser->position += 2;
+      if (high < low) {
+        aParser->error = "bad range";
+        return kNoNode;
+      }
+    }
+    addRange(&set, low, high);
+  }
+
+  foldSet(&set);
+  if (negated)
+    invertSet(&set);
+  return newSetNode(aParser, &set);
+}
+
+static uint32_t parseAtom(Parser* aParser) {
+  char c = *aParser->position++;
+  ByteSet set;
+  memset(&set, 0, sizeof(set));
+
+  switch (c) {
+  case '(':
+    {
+      if (aParser->end - aParser->position >= 2 &&
+          0 == strncmp(aParser->position, "?:", 2))
+        aParser->position += 2;
+      uint32_t node = parseAlternate(aParser);
+      if (atEnd(aParser) || *aParser->position != ')') {
+        if (!aParser->error)
+          aParser->error = "missing )";
+        return kNoNode;
+      }
+      aParser->position++;
+      return node;
+    }
+
+  case '[':
+    return parseClass(aParser);
+
+  case '.':
+    invertSet(&set);
+    set.bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+    return newSetNode(aParser, &set);
+
+  case '*':
+  case '+':
+  case '?':
+  case '{':
+    aParser->error = "nothing to repeat";
+    return kNoNode;
+
+  case '^':
+  case '$':
+    aParser->error = "anchors are not supported";
+    return kNoNode;
+
+  case '\\':
+    {
+      if (atEnd(aParser)) {
+        aParser->error = "trailing \\";
+        return kNoNode;
+      }
+      char letter = *aParser->position++;
+      if (letter == 'b')
+        return newNode(aParser, eNodeBoundary);
+      if (letter == 'B')
+        return newNode(aParser, eNodeNotBoundary);
+      if (classEscape(letter, &set))
+        return newSetNode(aParser, &set);
+      if (letter == 'n')
+        c = '\n';
+      else if (letter == 't')
+        c = '\t';
+      else if (letter == 'r')
+        c = '\r';
+      else if ((letter >= 'a' && letter <= 'z') ||
+               (letter >= 'A' && letter <= 'Z') ||
+               (letter >= '0' && letter <= '9')) {
+        aParser->error = "unknown escape";
+        return kNoNode;
+      }
+      else
+        c = letter;
+    }
+    break;
+  }
+
+  addByte(&set, uint8_t(c));
+  foldSet(&set);
+  return newSetNode(aParser, &set);
+}
+
+static bool parseNumber(Parser* aParser, int* aNumber) {
+  const char* start = aParser->position;
+  int number = 0;
+  while (!atEnd(aParser) && *aParser->position >= '0' &&
+         *aParser->position <= '9' && number <= GFD_PATTERN_MAX_PROGRAM) {
+    number = number * 10 + (*aParser->position - '0');
+    aParser->position++;
+  }
+  *aNumber = number;
+  return aParser->position != start;
+}
+
+static uint32_t parseRepeat(Parser* aParser) {
+  uint32_t node = parseAtom(aParser);
+  while (node != kNoNode && !atEnd(aParser)) {
+    int min;
+    int max;
+    char c = *aParser->position;
+    if (c == '*') {
+      min = 0;
+      max = -1;
+    }
+    else if (c == '+') {
+      min = 1;
+      max = -1;
+    }
+    else if (c == '?') {
+      min = 0;
+      max = 1;
+    }
+    else if (c == '{') {
+      aParser->position++;
+      if (!parseNumber(aParser, &min)) {
+        aParser->error = "bad repetition";
+        return kNoNode;
+      }
+      max = min;
+      if (!atEnd(aParser) && *aParser->position == ',') {
+        aParser->position++;
+        if (!parseNumber(aParser, &max))
+          max = -1;
+      }
+      if (atEnd(aParser) || *aParser->position != '}' ||
+          (max >= 0 && max < min)) {
+        aParser->error = "bad repetition";
+        return kNoNode;
+      }
+    }
+    else {
+      break;
+    }
+    aParser->position++;
+
+    uint32_t repeat = newNode(aParser, eNodeRepeat, node);
+    if (repeat == kNoNode)
+      return kNoNode;
+    aParser->nodes[repeat].min = min;
+    aParser->nodes[repeat].max = max;
+    node = repeat;
+  }
+  return node;
+}
+
+static uint32_t parseConcat(Parser* aParser) {
+  uint32_t node = kNoNode;
+  while (!atEnd(aParser) && *aParser->position != '|' &&
+         *aParser->position != ')') {
+    uint32_t next = parseRepeat(aParser);
+    if (next == kNoNode)
+      return kNoNode;
+    node = (node == kNoNode)? next :
+           newNode(aParser, eNodeConcat, node, next);
+  }
+  return (node == kNoNode)? newNode(aParser, eNodeEmpty) : node;
+}
+
+static uint32_t parseAlternate(Parser* aParser) {
+  uint32_t node = parseConcat(aParser);
+  while (node != kNoNode && !atEnd(aParser) && *aParser->position == '|') {
+    aParser->position++;
+    uint32_t next = parseConcat(aParser);
+    if (next == kNoNode)
+      return kNoNode;
+    node = newNode(aParser, eNodeAlternate, node, next);
+  }
+  return node;
+}
+
+static const uint32_t kNoOp = 0xffffffff;
+
+static uint32_t newOp(Parser* aParser, uint32_t aCode, uint32_t aX,
+                      uint32_t aY = kNoOp, uint32_t aArg = 0) {
+  PatternSet* patterns = aParser->patterns;
+  if (aParser->error)
+    return kNoOp;
+  if (!grow(&patterns->ops, &patterns->opCapacity, patterns->opCount + 1)) {
+    aParser->error = "out of memory";
+    return kNoOp;
+  }
+  Op* op = &patterns->ops[patterns->opCount];
+  op->code = aCode;
+  op->x = aX;
+  op->y = aY;
+  op->arg = aArg;
+  return patterns->opCount++;
+}
+
+/* Emits aNode, followed by aNext; returns its first instruction. The
+ * program is built backwards, so that every target is known. */
+static uint32_t emit(Parser* aParser, uint32_t aStart, uint32_t aNode,
+                     uint32_t aNext) {
+  if (aParser->error)
+    return kNoOp;
+  if (aParser->patterns->opCount - aStart > GFD_PATTERN_MAX_PROGRAM) {
+    aParser->error = "too large";
+    return kNoOp;
+  }
+
+  const Node node = aParser->nodes[aNode];
+  switch (node.kind) {
+  case eNodeEmpty:
+    return aNext;
+
+  case eNodeSet:
+    return newOp(aParser, eOpByte, aNext, kNoOp, node.set);
+
+  case eNodeBoundary:
+    return newOp(aParser, eOpBoundary, aNext);
+
+  case eNodeNotBoundary:
+    return newOp(aParser, eOpNotBoundary, aNext);
+
+  case eNodeConcat:
+    return emit(aParser, aStart, node.left,
+                emit(aParser, aStart, node.right, aNext));
+
+  case eNodeAlternate:
+    {
+      uint32_t left = emit(aParser, aStart, node.left, aNext);
+      uint32_t right = emit(aParser, aStart, node.right, aNext);
+      return newOp(aParser, eOpSplit, left, right);
+    }
+
+  case eNodeRepeat:
+    {
+      uint32_t tail = aNext;
+      if (node.max < 0) {
+        uint32_t loop = newOp(aParser, eOpSplit, kNoOp, aNext);
+        uint32_t body = emit(aParser, aStart, node.left, loop);
+        if (aParser->error)
+          return kNoOp;
+        aParser->patterns->ops[loop].x = body;
+        tail = loop;
+      }
+      else {
+        int i;
+        for (i = node.min; i < node.max && !aParser->error; i++) {
+          uint32_t body = emit(aParser, aStart, node.left, tail);
+          tail = newOp(aParser, eOpSplit, body, aNext);
+        }
+      }
+      int i;
+      for (i = 0; i < node.min && !aParser->error; i++)
+        tail = emit(aParser, aStart, node.left, tail);
+      return tail;
+    }
+  }
+  return kNoOp;
+}
+
+bool isPattern(const char* aKeyword) {
+  size_t length = strlen(aKeyword);
+  return length >= 3 && aKeyword[0] == '/' && aKeyword[length - 1] == '/';
+}
+
+size_t foldPattern(char* aOut, const char* aPattern, size_t aLength) {
+  const char* p = aPattern;
+  const char* end = aPattern + aLength;
+  char* out = aOut;
+  while (p < end) {
+    if (uint8_t(*p) >= 0x80) {
+      const char* run = p;
+      while (p < end && uint8_t(*p) >= 0x80)
+        p++;
+      out += foldInto(out, run, p - run);
+    }
+    else if (*p == '\\' && p + 1 < end && uint8_t(p[1]) >= 0x80) {
+      /* \x is x for any x but a letter or a digit, which the folding of x
+       * may be (U+212A is k, U+017F is s). */
+      p++;
+    }
+    else {
+      if (*p == '\\' && p + 1 < end)
+        *out++ = *p++;
+      *out++ = *p++;
+    }
+  }
+  return out - aOut;
+}
+
+PatternSet* compilePatterns(const char* const* aPatterns,
+                            const uint32_t* aKeywordIndex, uint32_t aCount) {
+  PatternSet* patterns = new PatternSet();
+  memset(patterns, 0, sizeof(PatternSet));
+  patterns->serial = __atomic_add_fetch(&sSerial, 1, __ATOMIC_RELAXED);
+  patterns->starts =
+    static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (aCount? aCount : 1)));
+  patterns->keywordIndex =
+    static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (aCount? aCount : 1)));
+  if (!patterns->starts || !patterns->keywordIndex) {
+    freePatterns(patterns);
+    return NULL;
+  }
+  memcpy(patterns->keywordIndex, aKeywordIndex, sizeof(uint32_t) * aCount);
+  patterns->patternCount = aCount;
+
+  Parser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.patterns = patterns;
+
+  uint32_t i;
+  for (i = 0; i < aCount; i++) {
+    const uint32_t opCount = patterns->opCount;
+    const uint32_t setCount = patterns->setCount;
+
+    parser.text = aPatterns[i];
+    parser.position = aPatterns[i] + 1;
+    parser.end = aPatterns[i] + strlen(aPatterns[i]) - 1;
+    parser.error = NULL;
+    parser.nodeCount = 0;
+
+    uint32_t root = parseAlternate(&parser);
+    if (!parser.error && !atEnd(&parser))
+      parser.error = "unmatched )";
+    if (!parser.error) {
+      uint32_t match = newOp(&parser, eOpMatch, kNoOp, kNoOp, i);
+      uint32_t start = emit(&parser, opCount, root, match);
+      if (!parser.error)
+        patterns->starts[patterns->startCount++] = start;
+    }
+
+    if (parser.error) {
+      fprintf(stderr, "%s: %s at offset %d, ignored\n", aPatterns[i],
+              parser.error, int(parser.position - parser.text));
+      if (0 == strcmp(parser.error, "out of memory")) {
+        free(parser.nodes);
+        freePatterns(patterns);
+        return NULL;
+      }
+      patterns->opCount = opCount;
+      patterns->setCount = setCount;
+    }
+  }
+  free(parser.nodes);
+  return patterns;
+}
+
+void freePatterns(PatternSet* aPatterns) {
+  if (!aPatterns)
+    return;
+  free(aPatterns->ops);
+  free(aPatterns->sets);
+  free(aPatterns->starts);
+  free(aPatterns->keywordIndex);
+  delete aPatterns;
+}
+
+/* The lazily built DFA of one thread.
+ *
+ * A DFA state is the set of instructions waiting for the next byte (the
+ * targets of the eOpByte instructions the previous byte went through) and
+ * whether the previous byte was a word character. Going through a byte
+ * follows the splits and assertions from there and from the start of every
+ * pattern, which is what makes the search unanchored; the patterns matched
+ * on the way are recorded with the transition, since whether \b holds
+ * depends on that byte. At the end of the text the same is done as if a
+ * non-word byte followed, or a word byte if the caller says that the text
+ * goes on with one; likewise the first state may follow a word byte. */
+
+typedef struct _DfaState {
+  uint32_t first;     /* of its instructions in mInstructions */
+  uint32_t count;
+  uint32_t previousWord;
+  /* matches at the end of the text, or kUnknown; [1] if a word character
+     follows it */
+  uint32_t finalList[2];
+  uint64_t hash;
+  uint32_t chain;
+} DfaState;
+
+typedef struct _PatternCache {
+  uint64_t serial;
+
+  DfaState* states;
+  uint32_t stateCount;
+  uint32_t stateCapacity;
+
+  uint32_t* instructions;
+  uint32_t instructionCount;
+  uint32_t instructionCapacity;
+
+  /* [state * 256 + byte]: the next state, kHasMatches if the patterns of
+     lists[matchList[state * 256 + byte]] match on the way; or kUnknown. */
+  uint32_t* next;
+  uint32_t* matchList;
+  uint32_t tableCapacity;
+
+  uint32_t* buckets;
+
+  /* count, then the patterns; list 0 is empty */
+  uint32_t* lists;
+  uint32_t listSize;
+  uint32_t listCapacity;
+
+  /* scratch */
+  uint32_t* stack;
+  uint32_t* marks;        /* per instruction */
+  uint32_t* patternMarks; /* per pattern */
+  uint32_t mark;
+  uint32_t* waiting;
+  uint32_t waitingCount;
+  uint32_t* matched;
+  uint32_t matchedCount;
+  uint32_t opCapacity;
+  uint32_t patternCapacity;
+} PatternCache;
+
+static const uint32_t kUnknown = 0xffffffff;
+static const uint32_t kHasMatches = 0x80000000;
+static const uint32_t kBucketCount = 2 * GFD_PATTERN_CACHE_STATES;
+
+static pthread_key_t sCacheKey;
+static pthread_once_t sCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+static void freeCache(void* aCache) {
+  PatternCache* cache = static_cast<PatternCache*>(aCache);
+  free(cache->states);
+  free(cache->instructions);
+  free(cache->next);
+  free(cache->matchList);
+  free(cache->buckets);
+  free(cache->lists);
+  free(cache->stack);
+  free(cache->marks);
+  free(cache->patternMarks);
+  free(cache->waiting);
+  free(cache->matched);
+  delete cache;
+}
+
+static void createCacheKey() {
+  pthread_key_create(&sCacheKey, freeCache);
+}
+
+static void clearCache(PatternCache* aCache) {
+  aCache->stateCount = 0;
+  aCache->instructionCount = 0;
+  aCache->listSize = 1;
+  aCache->lists[0] = 0;
+  memset(aCache->buckets, 0xff, sizeof(uint32_t) * kBucketCount);
+}
+
+/* The DFA of this thread for aPatterns, started over if it was built for
+ * other patterns. */
+static PatternCache* cacheFor(const PatternSet* aPatterns) {
+  pthread_once(&sCacheKeyOnce, createCacheKey);
+  PatternCache* cache =
+    static_cast<PatternCache*>(pthread_getspecific(sCacheKey));
+  if (!cache) {
+    cache = new PatternCache();
+    memset(cache, 0, sizeof(PatternCache));
+    cache->buckets =
+      static_cast<uint32_t*>(malloc(sizeof(uint32_t) * kBucketCount));
+    if (!cache->buckets || !grow(&cache->lists, &cache->listCapacity, 1) ||
+        0 != pthread_setspecific(sCacheKey, cache)) {
+      freeCache(cache);
+      return NULL;
+    }
+    clearCache(cache);
+  }
+  if (cache->serial == aPatterns->serial)
+    return cache;
+
+  if (aPatterns->opCount > cache->opCapacity) {
+    const size_t size = sizeof(uint32_t) * aPatterns->opCount;
+    free(cache->stack);
+    free(cache->marks);
+    free(cache->waiting);
+    cache->stack = static_cast<uint32_t*>(malloc(size));
+    cache->marks = static_cast<uint32_t*>(malloc(size));
+    cache->waiting = static_cast<uint32_t*>(malloc(size));
+    cache->opCapacity = aPatterns->opCount;
+  }
+  if (aPatterns->patternCount > cache->patternCapacity) {
+    const size_t size = sizeof(uint32_t) * aPatterns->patternCount;
+    free(cache->patternMarks);
+    free(cache->matched);
+    cache->patternMarks = static_cast<uint32_t*>(malloc(size));
+    cache->matched = static_cast<uint32_t*>(malloc(size));
+    cache->patternCapacity = aPatterns->patternCount;
+  }
+  if ((cache->opCapacity &&
+       (!cache->stack || !cache->marks || !cache->waiting)) ||
+      (cache->patternCapacity && (!cache->patternMarks || !cache->matched))) {
+    pthread_setspecific(sCacheKey, NULL);
+    freeCache(cache);
+    return NULL;
+  }
+  if (cache->opCapacity)
+    memset(cache->marks, 0, sizeof(uint32_t) * cache->opCapacity);
+  if (cache->patternCapacity)
+    memset(cache->patternMarks, 0, sizeof(uint32_t) * cache->patternCapacity);
+  cache->mark = 0;
+
+  clearCache(cache);
+  cache->serial = aPatterns->serial;
+  return cache;
+}
+
+static inline uint32_t nextMark(PatternCache* aCache) {
+  if (++aCache->mark == 0) {
+    memset(aCache->marks, 0, sizeof(uint32_t) * aCache->opCapacity);
+    memset(aCache->patternMarks, 0,
+           sizeof(uint32_t) * aCache->patternCapacity);
+    aCache->mark = 1;
+  }
+  return aCache->mark;
+}
+
+/* Follows everything but eOpByte from the instructions of aState and the
+ * start of every pattern, between a byte that was (aPreviousWord) and one
+ * that is (aWord) a word character. Leaves the eOpByte instructions reached
+ * in waiting, the patterns matched in matched. */
+static void close(const PatternSet* aPatterns, PatternCache* aCache,
+                  uint32_t aState, bool aPreviousWord, bool aWord) {
+  const uint32_t mark = nextMark(aCache);
+  uint32_t* stack = aCache->stack;
+  uint32_t depth = 0;
+  uint32_t i;
+
+  aCache->waitingCount = 0;
+  aCache->matchedCount = 0;
+
+  const DfaState* state = &aCache->states[aState];
+  const uint32_t* pending = aCache->instructions + state->first;
+  for (i = 0; i < state->count + aPatterns->startCount; i++) {
+    uint32_t pc = (i < state->count)? pending[i] :
+                  aPatterns->starts[i - state->count];
+    if (aCache->marks[pc] == mark)
+      continue;
+    aCache->marks[pc] = mark;
+    stack[depth++] = pc;
+
+    while (depth) {
+      const Op* op = &aPatterns->ops[stack[--depth]];
+      uint32_t targets[2];
+      uint32_t count = 0;
+
+      switch (op->code) {
+      case eOpByte:
+        aCache->waiting[aCache->waitingCount++] = uint32_t(op - aPatterns->ops);
+        break;
+      case eOpSplit:
+        targets[count++] = op->y;
+        targets[count++] = op->x;
+        break;
+      case eOpBoundary:
+        if (aPreviousWord != aWord)
+          targets[count++] = op->x;
+        break;
+      case eOpNotBoundary:
+        if (aPreviousWord == aWord)
+          targets[count++] = op->x;
+        break;
+      case eOpMatch:
+        if (aCache->patternMarks[op->arg] != mark) {
+          aCache->patternMarks[op->arg] = mark;
+          aCache->matched[aCache->matchedCount++] = op->arg;
+        }
+        break;
+      }
+
+      while (count) {
+        uint32_t target = targets[--count];
+        if (aCache->marks[target] != mark) {
+          aCache->marks[target] = mark;
+          stack[depth++] = target;
+        }
+      }
+    }
+  }
+}
+
+/* Stores matched as a list; 0 if it's empty. */
+static uint32_t addList(PatternCache* aCache) {
+  if (!aCache->matchedCount)
+    return 0;
+  if (!grow(&aCache->lists, &aCache->listCapacity,
+            aCache->listSize + 1 + aCache->matchedCount))
+    return kUnknown;
+
+  uint32_t list = aCache->listSize;
+  aCache->lists[list] = aCache->matchedCount;
+  memcpy(aCache->lists + list + 1, aCache->matched,
+         sizeof(uint32_t) * aCache->matchedCount);
+  aCache->listSize += 1 + aCache->matchedCount;
+  return list;
+}
+
+static int compareInstructions(const void* aLeft, const void* aRight) {
+  uint32_t left = *static_cast<const uint32_t*>(aLeft);
+  uint32_t right = *static_cast<const uint32_t*>(aRight);
+  return (left > right) - (left < right);
+}
+
+/* The state of the aCount instructions in aPending (sorted), added if
+ * needed; kUnknown if the cache is full or out of memory. */
+static uint32_t findState(PatternCache* aCache, const uint32_t* aPending,
+                          uint32_t aCount, bool aPreviousWord) {
+  uint64_t hash = 14695981039346656037ull ^ aPreviousWord;
+  uint32_t i;
+  for (i = 0; i < aCount; i++)
+    hash = (hash ^ aPending[i]) * 1099511628211ull;
+
+  uint32_t* bucket = &aCache->buckets[hash % kBucketCount];
+  uint32_t index;
+  for (index = *bucket; index != kUnknown;
+       index = aCache->states[index].chain) {
+    const DfaState* state = &aCache->states[index];
+    if (state->hash == hash && state->count == aCount &&
+        state->previousWord == uint32_t(aPreviousWord) &&
+        (!aCount || 0 == memcmp(aCache->instructions + state->first,
+                                aPending, sizeof(uint32_t) * aCount)))
+      return index;
+  }
+
+  if (aCache->stateCount == GFD_PATTERN_CACHE_STATES)
+    return kUnknown;
+  if (!grow(&aCache->states, &aCache->stateCapacity, aCache->stateCount + 1) ||
+      !grow(&aCache->instructions, &aCache->instructionCapacity,
+            aCache->instructionCount + aCount))
+    return kUnknown;
+  if (aCache->stateCapacity > aCache->tableCapacity) {
+    const size_t size = sizeof(uint32_t) * 256 * aCache->stateCapacity;
+    uint32_t* next = static_cast<uint32_t*>(realloc(aCache->next, size));
+    if (next)
+      aCache->next = next;
+    uint32_t* matchList =
+      static_cast<uint32_t*>(realloc(aCache->matchList, size));
+    if (matchList)
+      aCache->matchList = matchList;
+    if (!next || !matchList)
+      return kUnknown;
+    aCache->tableCapacity = aCache->stateCapacity;
+  }
+
+  index = aCache->stateCount++;
+  DfaState* state = &aCache->states[index];
+  state->first = aCache->instructionCount;
+  state->count = aCount;
+  state->previousWord = aPreviousWord;
+  state->finalList[0] = kUnknown;
+  state->finalList[1] = kUnknown;
+  state->hash = hash;
+  state->chain = *bucket;
+  *bucket = index;
+  if (aCount)
+    memcpy(aCache->instructions + state->first, aPending,
+           sizeof(uint32_t) * aCount);
+  aCache->instructionCount += aCount;
+  memset(aCache->next + index * 256, 0xff, sizeof(uint32_t) * 256);
+  return index;
+}
+
+/* Builds the transition of aState on aByte. Returns the next state, with
+ * kHasMatches and *aList set if patterns match on the way, or kUnknown. The
+ * cache may be cleared to make room, in which case the transition is not
+ * stored and aState is gone. */
+static uint32_t step(const PatternSet* aPatterns, PatternCache* aCache,
+                     uint32_t aState, uint8_t aByte, uint32_t* aList) {
+  const bool word = isWordByte(aByte);
+  close(aPatterns, aCache, aState, aCache->states[aState].previousWord, word);
+
+  /* The instructions consuming aByte; stack is free again. */
+  uint32_t* pending = aCache->stack;
+  uint32_t count = 0;
+  uint32_t i;
+  for (i = 0; i < aCache->waitingCount; i++) {
+    const Op* op = &aPatterns->ops[aCache->waiting[i]];
+    if (hasByte(&aPatterns->sets[op->arg], aByte))
+      pending[count++] = op->x;
+  }
+  qsort(pending, count, sizeof(uint32_t), compareInstructions);
+  uint32_t unique = 0;
+  for (i = 0; i < count; i++) {
+    if (!unique || pending[unique - 1] != pending[i])
+      pending[unique++] = pending[i];
+  }
+
+  bool stored = true;
+  uint32_t next = findState(aCache, pending, unique, word);
+  if (next == kUnknown) {
+    clearCache(aCache);
+    stored = false;
+    next = findState(aCache, pending, unique, word);
+    if (next == kUnknown)
+      return kUnknown;
+  }
+
+  uint32_t list = addList(aCache);
+  if (list == kUnknown)
+    return kUnknown;
+  if (list)
+    next |= kHasMatches;
+  if (stored) {
+    aCache->next[aState * 256 + aByte] = next;
+    aCache->matchList[aState * 256 + aByte] = list;
+  }
+  *aList = list;
+  return next;
+}
+
+/* Sets the hits of list aList; returns how many were new. */
+static inline uint32_t addHits(const PatternSet* aPatterns,
+                               const PatternCache* aCache, uint32_t aList,
+                               uint8_t* aHits) {
+  const uint32_t* patterns = aCache->lists + aList + 1;
+  uint32_t count = 0;
+  uint32_t i;
+  for (i = 0; i < aCache->lists[aList]; i++) {
+    uint8_t* hit = &aHits[aPatterns->keywordIndex[patterns[i]]];
+    if (!*hit) {
+      *hit = 1;
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t scanPatterns(const PatternSet* aPatterns, const char* aText,
+                      size_t aLength, uint8_t* aHits, bool aWordBefore,
+                      bool aWordAfter) {
+  if (!aPatterns || !aPatterns->startCount)
+    return 0;
+
+  uint32_t remaining = 0;
+  uint32_t i;
+  for (i = 0; i < aPatterns->patternCount; i++) {
+    if (!aHits[aPatterns->keywordIndex[i]])
+      remaining++;
+  }
+  if (!remaining)
+    return 0;
+
+  PatternCache* cache = cacheFor(aPatterns);
+  if (!cache)
+    return 0;
+
+  uint32_t state = findState(cache, NULL, 0, aWordBefore);
+  if (state == kUnknown) {
+    clearCache(cache);
+    state = findState(cache, NULL, 0, aWordBefore);
+    if (state == kUnknown)
+      return 0;
+  }
+
+  const uint8_t* text = reinterpret_cast<const uint8_t*>(aText);
+  uint32_t count = 0;
+  size_t position;
+  for (position = 0; position < aLength; position++) {
+    const uint32_t transition = state * 256 + text[position];
+    uint32_t next = cache->next[transition];
+    uint32_t list;
+    if (next == kUnknown) {
+      next = step(aPatterns, cache, state, text[position], &list);
+      if (next == kUnknown)
+        return count;
+    }
+    else {
+      list = cache->matchList[transition];
+    }
+
+    if (next & kHasMatches) {
+      count += addHits(aPatterns, cache, list, aHits);
+      if (count == remaining)
+        return count;
+    }
+    state = next & ~kHasMatches;
+  }
+
+  DfaState* last = &cache->states[state];
+  if (last->finalList[aWordAfter] == kUnknown) {
+    close(aPatterns, cache, state, last->previousWord, aWordAfter);
+    uint32_t list = addList(cache);
+    if (list == kUnknown)
+      return count;
+    cache->states[state].finalList[aWordAfter] = list;
+  }
+  uint32_t list = cache->states[state].finalList[aWordAfter];
+  if (list)
+    count += addHits(aPatterns, cache, list, aHits);
+  return count;
+}
+
+}
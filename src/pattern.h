@@ -0,0 +1,96 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Pattern keywords.
+ *
+ * A line of the censor list written as /.../ is a pattern instead of a
+ * literal keyword. Like literals, patterns are found anywhere in a fragment
+ * and are ASCII case-insensitive. The syntax is a subset of POSIX extended
+ * regular expressions:
+ *
+ *   x          the byte x; \x for any of .[]()|*+?{}\/^$
+ *   .          any byte but a newline
+ *   [a-z_]     a class; [^...] its complement
+ *   \d \w \s   digits, word characters, white space; \D \W \S complements
+ *   \b \B      a word boundary, or none; bytes >= 0x80 count as word
+ *              characters, so that UTF-8 letters do
+ *   xy x|y (x) concatenation, alternation, grouping
+ *   x* x+ x?   repetition; x{m}, x{m,} and x{m,n} for bounded repetition
+ *
+ * Wildcards are written with them, e.g. /harr.+potter/ or /\bwiz\w*\b/.
+ *
+ * A text longer than GFD_WALK_TEXT_WINDOW (greatfd.h) is scanned a window
+ * at a time, and consecutive windows only overlap by the longest keyword as
+ * it is written. A match longer than that (which any x*, x+, x{m,} or
+ * large x{m,n} can produce) is missed where it crosses a window boundary.
+ * A window is scanned knowing whether the characters just before and after
+ * it are word characters, so that \b and \B hold at its edges as they do
+ * in the whole text.
+ *
+ * All patterns of a list are compiled into one NFA, which is turned into a
+ * DFA lazily, a state at a time, as the text requires: a fragment is scanned
+ * in one pass, one table lookup per byte, without backtracking. Each thread
+ * builds its own DFA, in at most GFD_PATTERN_CACHE_STATES states; when that
+ * is exceeded the DFA is thrown away and started over.
+ */
+
+#ifndef GFD_PATTERN_H
+#define GFD_PATTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef GFD_PATTERN_CACHE_STATES
+#define GFD_PATTERN_CACHE_STATES 4096
+#endif
+
+/* Instructions a single pattern may compile to, bounded repetitions
+ * expanded. */
+#ifndef GFD_PATTERN_MAX_PROGRAM
+#define GFD_PATTERN_MAX_PROGRAM 20000
+#endif
+
+namespace gfd {
+
+typedef struct _PatternSet PatternSet;
+
+/* Whether \w matches aByte; bytes >= 0x80 do. */
+inline bool isWordByte(uint8_t aByte) {
+  return (aByte >= 'a' && aByte <= 'z') || (aByte >= 'A' && aByte <= 'Z') ||
+         (aByte >= '0' && aByte <= '9') || aByte == '_' || aByte >= 0x80;
+}
+
+/* Whether aKeyword is written as a pattern. */
+bool isPattern(const char* aKeyword);
+
+/* Like foldInto() (see casefold.h), for a pattern: only the characters
+ * outside ASCII are folded, ASCII case being left to the pattern itself, so
+ * that escapes such as \D keep their meaning. Returns the folded length. */
+size_t foldPattern(char* aOut, const char* aPattern, size_t aLength);
+
+/* Compiles aCount patterns (as written in the list, slashes included);
+ * aKeywordIndex[i] is the entry of aHits pattern i sets. A pattern that
+ * doesn't parse is reported on stderr and never matches. Returns NULL on
+ * allocation failure. */
+PatternSet* compilePatterns(const char* const* aPatterns,
+                            const uint32_t* aKeywordIndex, uint32_t aCount);
+void freePatterns(PatternSet* aPatterns);
+
+/* Like Matcher::scan(), for the patterns. */
+uint32_t scanPatterns(const PatternSet* aPatterns, const char* aText,
+                      size_t aLength, uint8_t* aHits, bool aWordBefore = false,
+                      bool aWordAfter = false);
+
+}
+
+#endif /* GFD_PATTERN_H */
@@ -0,0 +1,225 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "resultcache.h"
+
+#include "hash.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace gfd {
+
+typedef struct _CacheEntry {
+  char* url;
+  uint64_t urlHash;
+  uint32_t generation; /* of the keyword list */
+  ScanResult result;
+
+  _CacheEntry* chain;  /* next in the bucket */
+  _CacheEntry* newer;  /* LRU list */
+  _CacheEntry* older;
+} CacheEntry;
+
+struct _ResultCache {
+  pthread_mutex_t lock;
+  CacheEntry** buckets;
+  uint32_t bucketMask;
+  uint32_t count;
+  uint32_t capacity;
+  CacheEntry* newest;
+  CacheEntry* oldest;
+};
+
+static bool reserveHashes(ScanResult* aResult, uint32_t aCount) {
+  if (aCount <= aResult->capacity)
+    return true;
+
+  uint32_t capacity = aResult->capacity? aResult->capacity : 256;
+  while (capacity < aCount)
+    capacity *= 2;
+  uint64_t* hashes = static_cast<uint64_t*>(
+    realloc(aResult->hashes, sizeof(uint64_t) * capacity));
+  if (!hashes)
+    return false;
+  aResult->hashes = hashes;
+  aResult->capacity = capacity;
+  return true;
+}
+
+bool appendHash(ScanResult* aResult, uint64_t aHash) {
+  if (!reserveHashes(aResult, aResult->count + 1))
+    return false;
+  aResult->hashes[aResult->count++] = aHash;
+  return true;
+}
+
+bool setHits(ScanResult* aResult, const uint8_t* aHits, uint32_t aCount) {
+  if (aCount != aResult->keywordCount) {
+    uint8_t* hits = static_cast<uint8_t*>(realloc(aResult->hits, aCount));
+    if (aCount && !hits)
+      return false;
+    aResult->hits = hits;
+    aResult->keywordCount = aCount;
+  }
+  if (aCount)
+    memcpy(aResult->hits, aHits, aCount);
+  return true;
+}
+
+void clearResult(ScanResult* aResult) {
+  free(aResult->hashes);
+  free(aResult->hits);
+  memset(aResult, 0, sizeof(ScanResult));
+}
+
+static bool copyResult(ScanResult* aTo, const ScanResult* aFrom) {
+  if (!reserveHashes(aTo, aFrom->count) ||
+      !setHits(aTo, aFrom->hits, aFrom->keywordCount))
+    return false;
+  memcpy(aTo->hashes, aFrom->hashes, sizeof(uint64_t) * aFrom->count);
+  aTo->count = aFrom->count;
+  aTo->stoppedEarly = aFrom->stoppedEarly;
+  return true;
+}
+
+static void unlinkLru(ResultCache* aCache, CacheEntry* aEntry) {
+  if (aEntry->newer)
+    aEntry->newer->older = aEntry->older;
+  else
+    aCache->newest = aEntry->older;
+  if (aEntry->older)
+    aEntry->older->newer = aEntry->newer;
+  else
+    aCache->oldest = aEntry->newer;
+}
+
+static void pushNewest(ResultCache* aCache, CacheEntry* aEntry) {
+  aEntry->newer = NULL;
+  aEntry->older = aCache->newest;
+  if (aCache->newest)
+    aCache->newest->newer = aEntry;
+  else
+    aCache->oldest = aEntry;
+  aCache->newest = aEntry;
+}
+
+static CacheEntry** findLink(ResultCache* aCache, const char* aUrl,
+                             uint64_t aUrlHash) {
+  CacheEntry** link = &aCache->buckets[aUrlHash & aCache->bucketMask];
+  while (*link && ((*link)->urlHash != aUrlHash ||
+                   0 != strcmp((*link)->url, aUrl)))
+    link = &(*link)->chain;
+  return link;
+}
+
+static void freeEntry(CacheEntry* aEntry) {
+  free(aEntry->url);
+  clearResult(&aEntry->result);
+  delete aEntry;
+}
+
+static void removeEntry(ResultCache* aCache, CacheEntry* aEntry) {
+  CacheEntry** link = findLink(aCache, aEntry->url, aEntry->urlHash);
+  *link = aEntry->chain;
+  unlinkLru(aCache, aEntry);
+  aCache->count--;
+  freeEntry(aEntry);
+}
+
+ResultCache* newResultCache(uint32_t aCapacity) {
+  if (!aCapacity)
+    return NULL;
+
+  uint32_t buckets = 1;
+  while (buckets < aCapacity * 2)
+    buckets *= 2;
+
+  ResultCache* cache = new ResultCache();
+  memset(cache, 0, sizeof(ResultCache));
+  cache->buckets =
+    static_cast<CacheEntry**>(calloc(buckets, sizeof(CacheEntry*)));
+  if (!cache->buckets) {
+    delete cache;
+    return NULL;
+  }
+  cache->bucketMask = buckets - 1;
+  cache->capacity = aCapacity;
+  pthread_mutex_init(&cache->lock, NULL);
+  return cache;
+}
+
+void freeResultCache(ResultCache* aCache) {
+  if (!aCache)
+    return;
+
+  while (aCache->oldest)
+    removeEntry(aCache, aCache->oldest);
+  free(aCache->buckets);
+  pthread_mutex_destroy(&aCache->lock);
+  delete aCache;
+}
+
+bool lookupResult(ResultCache* aCache, const char* aUrl, uint32_t aGeneration,
+                  ScanResult* aResult) {
+  const uint64_t urlHash = hash64(aUrl, strlen(aUrl));
+  bool found = false;
+
+  pthread_mutex_lock(&aCache->lock);
+  CacheEntry* entry = *findLink(aCache, aUrl, urlHash);
+  if (entry && entry->generation == aGeneration) {
+    unlinkLru(aCache, entry);
+    pushNewest(aCache, entry);
+    found = copyResult(aResult, &entry->result);
+  }
+  pthread_mutex_unlock(&aCache->lock);
+  return found;
+}
+
+void storeResult(ResultCache* aCache, const char* aUrl, uint32_t aGeneration,
+                 const ScanResult* aResult) {
+  const uint64_t urlHash = hash64(aUrl, strlen(aUrl));
+
+  pthread_mutex_lock(&aCache->lock);
+  CacheEntry* entry = *findLink(aCache, aUrl, urlHash);
+  if (entry) {
+    unlinkLru(aCache, entry);
+  }
+  else {
+    if (aCache->count == aCache->capacity)
+      removeEntry(aCache, aCache->oldest);
+
+    entry = new CacheEntry();
+    memset(entry, 0, sizeof(CacheEntry));
+    entry->url = strdup(aUrl);
+    if (!entry->url) {
+      delete entry;
+      pthread_mutex_unlock(&aCache->lock);
+      return;
+    }
+    entry->urlHash = urlHash;
+    CacheEntry** link = &aCache->buckets[urlHash & aCache->bucketMask];
+    entry->chain = *link;
+    *link = entry;
+    aCache->count++;
+  }
+  pushNewest(aCache, entry);
+
+  entry->generation = aGeneration;
+  if (!copyResult(&entry->result, aResult))
+    removeEntry(aCache, entry);
+  pthread_mutex_unlock(&aCache->lock);
+}
+
+}
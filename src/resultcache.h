@@ -0,0 +1,68 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Results of previous page scans, by URL.
+ *
+ * For every page the cache remembers the hash of each text fragment that
+ * was matched, in order, and which keywords were found. When a page is
+ * scanned again and its fragments hash the same, the matcher is not run and
+ * the remembered hits are logged; if the previous scan stopped early, the
+ * walk stops at the same place. The cache holds at most
+ * GFD_RESULT_CACHE_SIZE pages and forgets the least recently used one first.
+ * It can be used from any thread.
+ */
+
+#ifndef GFD_RESULTCACHE_H
+#define GFD_RESULTCACHE_H
+
+#include <stdint.h>
+
+#ifndef GFD_RESULT_CACHE_SIZE
+#define GFD_RESULT_CACHE_SIZE 256
+#endif
+
+namespace gfd {
+
+typedef struct _ResultCache ResultCache;
+
+/* One page's result; the arrays are owned by whoever holds the record and
+ * grow as needed. */
+typedef struct _ScanResult {
+  uint64_t* hashes;        /* of the fragments matched, in order */
+  uint32_t count;
+  uint32_t capacity;
+
+  uint8_t* hits;           /* per keyword */
+  uint32_t keywordCount;
+  bool stoppedEarly;       /* the walk stopped after the last fragment */
+} ScanResult;
+
+bool appendHash(ScanResult* aResult, uint64_t aHash);
+bool setHits(ScanResult* aResult, const uint8_t* aHits, uint32_t aCount);
+void clearResult(ScanResult* aResult);
+
+ResultCache* newResultCache(uint32_t aCapacity);
+void freeResultCache(ResultCache* aCache);
+
+/* Copies what was stored for aUrl into aResult, if it was stored with the
+ * same generation of the keyword list. */
+bool lookupResult(ResultCache* aCache, const char* aUrl, uint32_t aGeneration,
+                  ScanResult* aResult);
+
+/* Stores a copy of aResult for aUrl. */
+void storeResult(ResultCache* aCache, const char* aUrl, uint32_t aGeneration,
+                 const ScanResult* aResult);
+
+}
+
+#endif /* GFD_RESULTCACHE_H */
@@ -0,0 +1,282 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "skiplist.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A host name is at most 253 characters long. */
+#define GFD_SKIP_MAX_HOST 256
+
+namespace gfd {
+
+typedef struct _SkipKey {
+  const char* text;
+  uint32_t length;
+} SkipKey;
+
+typedef struct _SkipNode {
+  uint32_t firstEdge;
+  uint16_t edgeCount;
+  uint16_t terminal;  /* an entry ends here */
+} SkipNode;
+
+typedef struct _SkipEdge {
+  uint32_t label;     /* offset in labels */
+  uint32_t length;
+  uint32_t target;    /* node */
+} SkipEdge;
+
+struct _SkipList {
+  uint32_t count;
+  uint32_t prefixRoot;
+  uint32_t hostRoot;
+
+  SkipNode* nodes;
+  uint32_t nodeCount;
+  uint8_t* edgeBytes; /* the first byte of the label of each edge */
+  SkipEdge* edges;
+  uint32_t edgeCount;
+  char* labels;
+  uint32_t labelSize;
+};
+
+static int compareKeys(const void* aFirst, const void* aSecond) {
+  const SkipKey* first = static_cast<const SkipKey*>(aFirst);
+  const SkipKey* second = static_cast<const SkipKey*>(aSecond);
+  uint32_t length =
+    (first->length < second->length)? first->length : second->length;
+  int order = memcmp(first->text, second->text, length);
+  if (order)
+    return order;
+  return (first->length > second->length) - (first->length < second->length);
+}
+
+/* Builds the node of the sorted aKeys[aFirst, aLast), which share their
+ * first aDepth bytes, and everything under it. Returns its index. */
+static uint32_t buildNode(SkipList* aList, const SkipKey* aKeys,
+                          uint32_t aFirst, uint32_t aLast, uint32_t aDepth) {
+  const uint32_t index = aList->nodeCount++;
+  SkipNode* node = &aList->nodes[index];
+  node->terminal = 0;
+
+  uint32_t i = aFirst;
+  while (i < aLast && aKeys[i].length == aDepth) {
+    node->terminal = 1;
+    i++;
+  }
+
+  /* The edges of a node are contiguous, so they are taken before those of
+     its children. */
+  uint32_t edgeCount = 0;
+  uint32_t j = i;
+  while (j < aLast) {
+    const char byte = aKeys[j].text[aDepth];
+    while (j < aLast && aKeys[j].text[aDepth] == byte)
+      j++;
+    edgeCount++;
+  }
+  node->firstEdge = aList->edgeCount;
+  node->edgeCount = uint16_t(edgeCount);
+  aList->edgeCount += edgeCount;
+
+  uint32_t edge = node->firstEdge;
+  while (i < aLast) {
+    const SkipKey* first = &aKeys[i];
+    j = i + 1;
+    while (j < aLast && aKeys[j].text[aDepth] == first->text[aDepth])
+      j++;
+
+    /* Sorted: what the first and the last keys share, they all share. */
+    const SkipKey* last = &aKeys[j - 1];
+    uint32_t end = aDepth + 1;
+    while (end < first->length && end < last->length &&
+           first->text[end] == last->text[end])
+      end++;
+
+    const uint32_t length = end - aDepth;
+    aList->edgeBytes[edge] = uint8_t(first->text[aDepth]);
+    aList->edges[edge].label = aList->labelSize;
+    aList->edges[edge].length = length;
+    memcpy(aList->labels + aList->labelSize, first->text + aDepth, length);
+    aList->labelSize += length;
+    aList->edges[edge].target = buildNode(aList, aKeys, i, j, end);
+    edge++;
+    i = j;
+  }
+  return index;
+}
+
+/* Follows aText down from aNode. A prefix matches wherever an entry ends;
+ * a host suffix only where a label of the host ends too. */
+static bool follow(const SkipList* aList, uint32_t aNode, const char* aText,
+                   size_t aLength, bool aHost) {
+  size_t position = 0;
+  for (;;) {
+    const SkipNode* node = &aList->nodes[aNode];
+    if (node->terminal &&
+        (!aHost || position == aLength || aText[position] == '.'))
+      return true;
+    if (position == aLength || !node->edgeCount)
+      return false;
+
+    const uint8_t* byte = static_cast<const uint8_t*>(
+      memchr(aList->edgeBytes + node->firstEdge, uint8_t(aText[position]),
+             node->edgeCount));
+    if (!byte)
+      return false;
+
+    const SkipEdge* edge = &aList->edges[byte - aList->edgeBytes];
+    if (aLength - position < edge->length ||
+        0 != memcmp(aList->labels + edge->label, aText + position,
+                    edge->length))
+      return false;
+    position += edge->length;
+    aNode = edge->target;
+  }
+}
+
+SkipList* newSkipList(const char* aText) {
+  uint32_t lines = 1;
+  const char* c;
+  for (c = aText; *c; c++)
+    lines += (*c == '\n');
+
+  const size_t size = c - aText;
+  SkipKey* prefixes = static_cast<SkipKey*>(malloc(sizeof(SkipKey) * lines));
+  SkipKey* hosts = static_cast<SkipKey*>(malloc(sizeof(SkipKey) * lines));
+  char* reversed = static_cast<char*>(malloc(size + 1));
+  SkipList* list = static_cast<SkipList*>(calloc(1, sizeof(SkipList)));
+  if (!prefixes || !hosts || !reversed || !list) {
+    free(prefixes);
+    free(hosts);
+    free(reversed);
+    free(list);
+    return NULL;
+  }
+
+  /* Host suffixes are matched backwards, in lower case. */
+  uint32_t prefixCount = 0;
+  uint32_t hostCount = 0;
+  char* next = reversed;
+  const char* line = aText;
+  while (*line) {
+    const char* end = strchr(line, '\n');
+    if (!end)
+      end = line + strlen(line);
+    const char* last = end;
+    while (last > line && isspace(static_cast<unsigned char>(last[-1])))
+      last--;
+
+    const uint32_t length = uint32_t(last - line);
+    if (!length || *line == '#') {
+      /* Nothing. */
+    }
+    else if (*line != '.') {
+      prefixes[prefixCount].text = line;
+      prefixes[prefixCount].length = length;
+      prefixCount++;
+    }
+    else if (length > 1) {
+      hosts[hostCount].text = next;
+      hosts[hostCount].length = length - 1;
+      hostCount++;
+      while (last > line + 1)
+        *next++ = char(tolower(static_cast<unsigned char>(*--last)));
+    }
+    line = *end? end + 1 : end;
+  }
+
+  qsort(prefixes, prefixCount, sizeof(SkipKey), compareKeys);
+  qsort(hosts, hostCount, sizeof(SkipKey), compareKeys);
+
+  /* Every node but a root ends an entry or branches, so there are fewer
+     than two per entry; the labels are at most the entries. */
+  const uint32_t nodes = 2 * (prefixCount + hostCount) + 2;
+  list->count = prefixCount + hostCount;
+  list->nodes = static_cast<SkipNode*>(malloc(sizeof(SkipNode) * nodes));
+  list->edgeBytes = static_cast<uint8_t*>(malloc(nodes));
+  list->edges = static_cast<SkipEdge*>(malloc(sizeof(SkipEdge) * nodes));
+  list->labels = static_cast<char*>(malloc(size + 1));
+  if (list->nodes && list->edgeBytes && list->edges && list->labels) {
+    list->prefixRoot = buildNode(list, prefixes, 0, prefixCount, 0);
+    list->hostRoot = buildNode(list, hosts, 0, hostCount, 0);
+  }
+  else {
+    freeSkipList(list);
+    list = NULL;
+  }
+
+  free(prefixes);
+  free(hosts);
+  free(reversed);
+  return list;
+}
+
+void freeSkipList(SkipList* aList) {
+  if (!aList)
+    return;
+  free(aList->nodes);
+  free(aList->edgeBytes);
+  free(aList->edges);
+  free(aList->labels);
+  free(aList);
+}
+
+uint32_t skipListCount(const SkipList* aList) {
+  return aList->count;
+}
+
+bool isSkipped(const SkipList* aList, const char* aUrl) {
+  if (follow(aList, aList->prefixRoot, aUrl, strlen(aUrl), false))
+    return true;
+
+  /* The host: after "scheme://" and any "user@", up to the port or the
+     path. */
+  const char* start = strstr(aUrl, "://");
+  if (!start)
+    return false;
+  start += sizeof("://") - 1;
+  const char* end = start + strcspn(start, "/?#");
+  const char* c;
+  for (c = start; c < end; c++) {
+    if (*c == '@')
+      start = c + 1;
+  }
+  if (*start == '[') {
+    /* IPv6 */
+    const char* bracket =
+      static_cast<const char*>(memchr(start, ']', end - start));
+    if (bracket)
+      end = bracket + 1;
+  }
+  else {
+    const char* colon =
+      static_cast<const char*>(memchr(start, ':', end - start));
+    if (colon)
+      end = colon;
+  }
+
+  const size_t length = end - start;
+  if (!length || length > GFD_SKIP_MAX_HOST)
+    return false;
+  char host[GFD_SKIP_MAX_HOST];
+  size_t i;
+  for (i = 0; i < length; i++)
+    host[i] = char(tolower(static_cast<unsigned char>(end[-1 - i])));
+  return follow(aList, aList->hostRoot, host, length, true);
+}
+
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Sites that are not censored, only monitored.
+ *
+ * settings/skip.lst has one entry per line: a line starting with '.' is a
+ * host suffix (".example.com" matches example.com and every host under
+ * it, in any case), any other line a URL prefix
+ * ("https://intranet.example.com/wiki/"). Empty lines and lines starting
+ * with '#' are ignored.
+ *
+ * The entries are compiled into two path-compressed tries, one of the
+ * prefixes and one of the reversed host suffixes, laid out in flat arrays:
+ * a node is an edge range, an edge a byte, a label and a target. A lookup
+ * follows the URL, or its host backwards, through one edge per branching
+ * point, so it takes about as long as comparing the URL to a single entry,
+ * whatever the number of entries.
+ */
+
+#ifndef GFD_SKIPLIST_H
+#define GFD_SKIPLIST_H
+
+#include <stdint.h>
+
+namespace gfd {
+
+typedef struct _SkipList SkipList;
+
+/* Compiles the lines of aText. Returns NULL on allocation failure. */
+SkipList* newSkipList(const char* aText);
+void freeSkipList(SkipList* aList);
+
+/* The number of entries. */
+uint32_t skipListCount(const SkipList* aList);
+
+/* Whether aUrl starts with one of the prefixes or is on a host of one of
+ * the suffixes. */
+bool isSkipped(const SkipList* aList, const char* aUrl);
+
+}
+
+#endif /* GFD_SKIPLIST_H */
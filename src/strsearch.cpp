@@ -0,0 +1,279 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "strsearch.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#define GFD_STRSEARCH_X86 1
+#include <immintrin.h>
+#else
+#define GFD_STRSEARCH_X86 0
+#endif
+
+namespace gfd {
+
+static inline uint8_t fold(uint8_t aByte) {
+  return (aByte >= 'A' && aByte <= 'Z')? uint8_t(aByte + ('a' - 'A')) : aByte;
+}
+
+static inline bool
+equalsFolded(const uint8_t* aLeft, const uint8_t* aRight, size_t aLength) {
+  size_t i;
+  for (i = 0; i < aLength; i++) {
+    if (fold(aLeft[i]) != fold(aRight[i]))
+      return false;
+  }
+  return true;
+}
+
+/* Plain C version, also used for the last few positions of the SIMD ones. */
+static const char*
+searchScalarFrom(const uint8_t* aHaystack, size_t aStart, size_t aLimit,
+                 const uint8_t* aNeedle, size_t aNeedleLength) {
+  const uint8_t first = fold(aNeedle[0]);
+  const uint8_t last = fold(aNeedle[aNeedleLength - 1]);
+
+  size_t i;
+  for (i = aStart; i < aLimit; i++) {
+    if (fold(aHaystack[i]) == first &&
+        fold(aHaystack[i + aNeedleLength - 1]) == last &&
+        equalsFolded(aHaystack + i + 1, aNeedle + 1, aNeedleLength - 1))
+      return reinterpret_cast<const char*>(aHaystack + i);
+  }
+  return NULL;
+}
+
+static const char*
+searchScalar(const char* aHaystack, size_t aHaystackLength,
+             const char* aNeedle, size_t aNeedleLength) {
+  if (!aNeedleLength)
+    return aHaystack;
+  if (aNeedleLength > aHaystackLength)
+    return NULL;
+
+  return searchScalarFrom(reinterpret_cast<const uint8_t*>(aHaystack), 0,
+                          aHaystackLength - aNeedleLength + 1,
+                          reinterpret_cast<const uint8_t*>(aNeedle),
+                          aNeedleLength);
+}
+
+#if GFD_STRSEARCH_X86
+
+static inline __m128i fold128(__m128i aBytes) {
+  /* Bytes >= 0x80 are negative as signed chars, so they never match. */
+  __m128i upper =
+    _mm_and_si128(_mm_cmpgt_epi8(aBytes, _mm_set1_epi8('A' - 1)),
+                  _mm_cmplt_epi8(aBytes, _mm_set1_epi8('Z' + 1)));
+  return _mm_or_si128(aBytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+/* Folded needle, prepared once per search. */
+typedef struct _SearchNeedle {
+  const uint8_t* data;
+  size_t length;
+  __m128i head;     /* the first 16 bytes, folded, zero padded */
+  uint32_t headMask;
+} SearchNeedle;
+
+static inline void
+prepareNeedle(SearchNeedle* aNeedle, const uint8_t* aData, size_t aLength) {
+  uint8_t head[16];
+  memset(head, 0, sizeof(head));
+  size_t i;
+  for (i = 0; i < aLength && i < sizeof(head); i++)
+    head[i] = fold(aData[i]);
+
+  aNeedle->data = aData;
+  aNeedle->length = aLength;
+  aNeedle->head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(head));
+  aNeedle->headMask = (aLength >= 16)? 0xffff : ((1u << aLength) - 1);
+}
+
+/* Whether the needle occurs at aCandidate; aAvailable is the number of
+ * readable bytes from aCandidate on. */
+static inline bool
+verify(const SearchNeedle* aNeedle, const uint8_t* aCandidate,
+       size_t aAvailable) {
+  const size_t length = aNeedle->length;
+
+  if (length <= 16) {
+    if (aAvailable < 16)
+      return equalsFolded(aCandidate, aNeedle->data, length);
+
+    __m128i bytes =
+      fold128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aCandidate)));
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, aNeedle->head));
+    return (mask & aNeedle->headMask) == aNeedle->headMask;
+  }
+
+  size_t offset = 0;
+  for (;;) {
+    __m128i left = fold128(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(aCandidate + offset)));
+    __m128i right = fold128(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(aNeedle->data + offset)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(left, right)) != 0xffff)
+      return false;
+
+    if (offset + 16 == length)
+      return true;
+
+    offset += 16;
+    /* The last chunk overlaps the previous one instead of reading beyond. */
+    if (offset + 16 > length)
+      offset = length - 16;
+  }
+}
+
+static const char*
+searchSSE2(const char* aHaystack, size_t aHaystackLength,
+           const char* aNeedle, size_t aNeedleLength) {
+  if (!aNeedleLength)
+    return aHaystack;
+  if (aNeedleLength > aHaystackLength)
+    return NULL;
+
+  const uint8_t* haystack = reinterpret_cast<const uint8_t*>(aHaystack);
+  const uint8_t* needle = reinterpret_cast<const uint8_t*>(aNeedle);
+
+  SearchNeedle prepared;
+  prepareNeedle(&prepared, needle, aNeedleLength);
+
+  const __m128i first = _mm_set1_epi8(char(fold(needle[0])));
+  const __m128i last = _mm_set1_epi8(char(fold(needle[aNeedleLength - 1])));
+
+  /* Candidate positions are [0, limit). A block of 16 candidates starting
+   * at i reads up to i + 16 + aNeedleLength - 1 bytes. */
+  const size_t limit = aHaystackLength - aNeedleLength + 1;
+  size_t i = 0;
+  for (; i + 16 <= limit; i += 16) {
+    __m128i blockFirst = fold128(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(haystack + i)));
+    __m128i blockLast = fold128(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(haystack + i + aNeedleLength - 1)));
+    uint32_t mask =
+      _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                      _mm_cmpeq_epi8(blockLast, last)));
+    while (mask) {
+      size_t candidate = i + __builtin_ctz(mask);
+      if (verify(&prepared, haystack + candidate,
+                 aHaystackLength - candidate))
+        return aHaystack + candidate;
+      mask &= mask - 1;
+    }
+  }
+
+  return searchScalarFrom(haystack, i, limit, needle, aNeedleLength);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fold256(__m256i aBytes) {
+  __m256i upper =
+    _mm256_and_si256(_mm256_cmpgt_epi8(aBytes, _mm256_set1_epi8('A' - 1)),
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), aBytes));
+  return _mm256_or_si256(aBytes,
+                         _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static const char*
+searchAVX2(const char* aHaystack, size_t aHaystackLength,
+           const char* aNeedle, size_t aNeedleLength) {
+  if (!aNeedleLength)
+    return aHaystack;
+  if (aNeedleLength > aHaystackLength)
+    return NULL;
+
+  const uint8_t* haystack = reinterpret_cast<const uint8_t*>(aHaystack);
+  const uint8_t* needle = reinterpret_cast<const uint8_t*>(aNeedle);
+
+  SearchNeedle prepared;
+  prepareNeedle(&prepared, needle, aNeedleLength);
+
+  const __m256i first = _mm256_set1_epi8(char(fold(needle[0])));
+  const __m256i last =
+    _mm256_set1_epi8(char(fold(needle[aNeedleLength - 1])));
+
+  const size_t limit = aHaystackLength - aNeedleLength + 1;
+  size_t i = 0;
+  for (; i + 32 <= limit; i += 32) {
+    __m256i blockFirst = fold256(_mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(haystack + i)));
+    __m256i blockLast = fold256(_mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(haystack + i + aNeedleLength - 1)));
+    uint32_t mask = uint32_t(_mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                       _mm256_cmpeq_epi8(blockLast, last))));
+    while (mask) {
+      size_t candidate = i + __builtin_ctz(mask);
+      if (verify(&prepared, haystack + candidate,
+                 aHaystackLength - candidate))
+        return aHaystack + candidate;
+      mask &= mask - 1;
+    }
+  }
+
+  return searchScalarFrom(haystack, i, limit, needle, aNeedleLength);
+}
+
+#endif /* GFD_STRSEARCH_X86 */
+
+static SearchFunction resolveSearchFunction() {
+#if GFD_STRSEARCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return searchAVX2;
+  return searchSSE2;
+#else
+  return searchScalar;
+#endif
+}
+
+/* Resolved during static initialization, i.e. before any thread exists. */
+static const SearchFunction sSearch = resolveSearchFunction();
+
+const char* findCaseInsensitive(const char* aHaystack, size_t aHaystackLength,
+                                const char* aNeedle, size_t aNeedleLength) {
+  return sSearch(aHaystack, aHaystackLength, aNeedle, aNeedleLength);
+}
+
+SearchFunction searchFunction(const char* aName) {
+  if (0 == strcmp(aName, "scalar"))
+    return searchScalar;
+#if GFD_STRSEARCH_X86
+  if (0 == strcmp(aName, "sse2"))
+    return searchSSE2;
+  if (0 == strcmp(aName, "avx2")) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2")? searchAVX2 : NULL;
+  }
+#endif
+  return NULL;
+}
+
+const char* searchFunctionName() {
+  if (sSearch == searchScalar)
+    return "scalar";
+#if GFD_STRSEARCH_X86
+  if (sSearch == searchSSE2)
+    return "sse2";
+  if (sSearch == searchAVX2)
+    return "avx2";
+#endif
+  return "???";
+}
+
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* ASCII case-insensitive substring search.
+ *
+ * findCaseInsensitive() returns exactly what strcasestr() returns in the "C"
+ * locale, but works on counted strings and compares 16 or 32 candidate
+ * positions at a time: the first and the last byte of the needle are checked
+ * in vector registers, then the surviving candidates are verified (also in
+ * vector registers when the needle is long enough). The implementation is
+ * chosen once at run time (AVX2, SSE2 or plain C).
+ */
+
+#ifndef GFD_STRSEARCH_H
+#define GFD_STRSEARCH_H
+
+#include <stddef.h>
+
+namespace gfd {
+
+const char* findCaseInsensitive(const char* aHaystack, size_t aHaystackLength,
+                                const char* aNeedle, size_t aNeedleLength);
+
+/* The implementations behind findCaseInsensitive(); NULL when the CPU does
+ * not support it. */
+typedef const char* (*SearchFunction)(const char*, size_t,
+                                      const char*, size_t);
+SearchFunction searchFunction(const char* aName);
+
+/* "avx2", "sse2" or "scalar" */
+const char* searchFunctionName();
+
+}
+
+#endif /* GFD_STRSEARCH_H */
@@ -0,0 +1,103 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "strtable.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace gfd {
+
+static const uint32_t kMinimumCapacity = 4 * 1024;
+static const uint32_t kMinimumSlots = 256;
+
+static inline uint32_t slotOf(const char* aText, size_t aLength,
+                              uint32_t aSlotCount) {
+  return uint32_t(hash64(aText, aLength)) & (aSlotCount - 1);
+}
+
+/* Doubles the hash table; the strings stay where they are. */
+static bool growSlots(StringTable* aTable) {
+  if (aTable->slotCount > UINT32_MAX / 2)
+    return false;
+  const uint32_t slotCount =
+    aTable->slotCount? aTable->slotCount * 2 : kMinimumSlots;
+  uint32_t* slots =
+    static_cast<uint32_t*>(calloc(slotCount, sizeof(uint32_t)));
+  if (!slots)
+    return false;
+
+  uint32_t i;
+  for (i = 0; i < aTable->slotCount; i++) {
+    if (!aTable->slots[i])
+      continue;
+    const char* text = aTable->data + aTable->slots[i] - 1;
+    uint32_t slot = slotOf(text, strlen(text), slotCount);
+    while (slots[slot])
+      slot = (slot + 1) & (slotCount - 1);
+    slots[slot] = aTable->slots[i];
+  }
+
+  free(aTable->slots);
+  aTable->slots = slots;
+  aTable->slotCount = slotCount;
+  return true;
+}
+
+uint32_t internString(StringTable* aTable, const char* aText) {
+  /* At most 3/4 full. */
+  if (uint64_t(aTable->count + 1) * 4 > uint64_t(aTable->slotCount) * 3 &&
+      !growSlots(aTable))
+    return kNoString;
+
+  const size_t length = strlen(aText);
+  uint32_t slot = slotOf(aText, length, aTable->slotCount);
+  for (; aTable->slots[slot];
+       slot = (slot + 1) & (aTable->slotCount - 1)) {
+    const uint32_t offset = aTable->slots[slot] - 1;
+    if (0 == strcmp(aTable->data + offset, aText))
+      return offset;
+  }
+
+  const uint64_t needed = uint64_t(aTable->used) + length + 1;
+  if (needed >= kNoString)
+    return kNoString;
+  if (needed > aTable->capacity) {
+    uint64_t capacity = aTable->capacity? aTable->capacity : kMinimumCapacity;
+    while (capacity < needed)
+      capacity *= 2;
+    if (capacity > kNoString)
+      capacity = kNoString;
+    char* data = static_cast<char*>(realloc(aTable->data, capacity));
+    if (!data)
+      return kNoString;
+    aTable->data = data;
+    aTable->capacity = uint32_t(capacity);
+  }
+
+  const uint32_t offset = aTable->used;
+  memcpy(aTable->data + offset, aText, length + 1);
+  aTable->used += uint32_t(length) + 1;
+  aTable->slots[slot] = offset + 1;
+  aTable->count++;
+  return offset;
+}
+
+void clearStrings(StringTable* aTable) {
+  free(aTable->data);
+  free(aTable->slots);
+  memset(aTable, 0, sizeof(StringTable));
+}
+
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Interned strings.
+ *
+ * Every distinct string is stored once, NUL-terminated, in one contiguous
+ * buffer, and named by its offset there; an open-addressing hash table of
+ * offsets finds it again. The tree walker keeps the bus names and object
+ * paths of one walk in a table: the bus name every child reference repeats
+ * is only stored the first time, and a node costs two offsets instead of
+ * two strdup()s. Offsets stay valid as the table grows; the pointers of
+ * stringAt() only until the next internString().
+ */
+
+#ifndef GFD_STRTABLE_H
+#define GFD_STRTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gfd {
+
+static const uint32_t kNoString = 0xffffffff;
+
+typedef struct _StringTable {
+  char* data;
+  uint32_t used;
+  uint32_t capacity;
+
+  uint32_t* slots;    /* 1 + offset of a string, 0 if free */
+  uint32_t slotCount; /* a power of 2 */
+  uint32_t count;
+} StringTable;
+
+/* Returns the offset of aText in aTable, which it is copied to if it isn't
+ * there yet; kNoString on allocation failure. */
+uint32_t internString(StringTable* aTable, const char* aText);
+
+inline const char* stringAt(const StringTable* aTable, uint32_t aOffset) {
+  return aTable->data + aOffset;
+}
+
+/* Releases the memory; the table can be used again afterwards. */
+void clearStrings(StringTable* aTable);
+
+}
+
+#endif /* GFD_STRTABLE_H */
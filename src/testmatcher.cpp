@@ -0,0 +1,142 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+
+/* Regression test of the matcher:
+ *
+ * $ ./gfd-test-matcher
+ *
+ * Each case is a censor list, a text, the keywords it must find and
+ * whether the text is taken to be preceded and followed by word characters,
+ * as a window of a longer text may be. The text is folded with foldText(),
+ * as greatfd does, and scanned twice: with the list as it is, searched
+ * keyword by keyword, and with keywords that never match added to it,
+ * through the automaton. The exit status is 1 if
+ * any scan finds other keywords; each of them is said on stderr.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "casefold.h"
+#include "matcher.h"
+
+static const char kProductName[] = "gfd-test-matcher";
+
+static const uint32_t kMaxKeywords = 4;
+
+/* Added to a list so that it is longer than GFD_MATCHER_SEARCH_LIMIT. */
+static const char* const kPadding[] = {
+  "qqqqa", "qqqqb", "qqqqc", "qqqqd", "qqqqe"
+};
+static const uint32_t kPaddingCount = sizeof(kPadding) / sizeof(kPadding[0]);
+
+typedef struct _Case {
+  const char* keywords[kMaxKeywords + 1]; /* NULL-terminated */
+  const char* text;
+  const char* expected;                   /* '1' for each keyword found */
+  /* whether the text is a window between word characters */
+  bool wordBefore;
+  bool wordAfter;
+} Case;
+
+static const Case kCases[] = {
+  /* Complement escapes, with and without a keyword that needs folding. */
+  { { "/foo\\Dbar/", NULL }, "fooxbar", "1" },
+  { { "/foo\\Dbar/", NULL }, "foo1bar", "0" },
+  { { "/foo\\Dbar/", "stra\xc3\x9f" "e", NULL }, "fooxbar", "10" },
+  { { "/foo\\Dbar/", "stra\xc3\x9f" "e", NULL }, "foo1bar", "00" },
+  { { "/a\\Wb\\Sc\\Bd/", "\xc3\x89t\xc3\xa9", NULL }, "a-bxcd", "10" },
+  { { "/a\\Wb\\Sc\\Bd/", "\xc3\x89t\xc3\xa9", NULL }, "a-b cd", "00" },
+  { { "/a\\Wb\\Sc\\Bd/", "\xc3\x89t\xc3\xa9", NULL },
+    "A-BXCD \xc3\x89T\xc3\x89", "11" },
+  /* Characters outside ASCII in a pattern are folded like the text. */
+  { { "/\xc3\x89t\xc3\xa9+/", "stra\xc3\x9f" "e", NULL },
+    "L'\xc3\x89T\xc3\x89\xc3\x89 STRA\xc3\x9f" "E", "11" },
+  { { "/[\xc3\x89\xc3\x88]t\xc3\xa9/", NULL },
+    "\xc3\xa9T\xc3\x89", "1" },
+  /* U+212A KELVIN SIGN folds to k, escaped or not. */
+  { { "/\\\xe2\x84\xaa" "elvin/", "\xc3\xa9", NULL }, "KELVIN", "10" },
+  { { "/\xe2\x84\xaa" "elvin\\d/", "\xc3\xa9", NULL }, "\xe2\x84\xaa" "elvin3",
+    "10" },
+  /* \b and \B at the edges of a window of a longer text. */
+  { { "/\\bcat/", "/cat\\b/", NULL }, "cat", "11", false, false },
+  { { "/\\bcat/", "/cat\\b/", NULL }, "cat", "01", true, false },
+  { { "/\\bcat/", "/cat\\b/", NULL }, "cat", "10", false, true },
+  { { "/\\Bcat/", "/cat\\B/", NULL }, "cat", "11", true, true },
+  { { "/\\Bcat/", "/cat\\B/", NULL }, "cat", "00", false, false },
+  { { "/\\bcat\\b/", "t\xc3\xa9", NULL }, "CAT T\xc3\x89", "11", false, true },
+};
+
+static uint32_t sFailures;
+
+static void check(const Case* aCase, bool aPadded) {
+  const char* keywords[kMaxKeywords + kPaddingCount];
+  uint32_t count = 0;
+  while (aCase->keywords[count]) {
+    keywords[count] = aCase->keywords[count];
+    count++;
+  }
+  const uint32_t caseCount = count;
+  uint32_t i;
+  for (i = 0; aPadded && i < kPaddingCount; i++)
+    keywords[count++] = kPadding[i];
+
+  gfd::Matcher* matcher = gfd::Matcher::compile(keywords, count);
+  if (!matcher) {
+    fprintf(stderr, "%s: out of memory\n", kProductName);
+    sFailures++;
+    return;
+  }
+
+  gfd::FoldBuffer buffer = { NULL, 0 };
+  size_t length;
+  const char* text =
+    gfd::foldText(&buffer, aCase->text, strlen(aCase->text), &length);
+  uint8_t hits[kMaxKeywords + kPaddingCount];
+  memset(hits, 0, sizeof(hits));
+  matcher->scan(text, length, hits, aCase->wordBefore, aCase->wordAfter);
+
+  char found[kMaxKeywords + 1];
+  for (i = 0; i < caseCount; i++)
+    found[i] = hits[i]? '1' : '0';
+  found[caseCount] = '\0';
+  if (strcmp(found, aCase->expected)) {
+    fprintf(stderr, "%s: \"%s\" in \"%s\"%s: found %s, expected %s\n",
+            kProductName, aCase->keywords[0], aCase->text,
+            aPadded? " (automaton)" : "", found, aCase->expected);
+    sFailures++;
+  }
+
+  gfd::clearFoldBuffer(&buffer);
+  delete matcher;
+}
+
+int main() {
+  const uint32_t caseCount = sizeof(kCases) / sizeof(kCases[0]);
+  uint32_t i;
+  for (i = 0; i < caseCount; i++) {
+    check(&kCases[i], false);
+    check(&kCases[i], true);
+  }
+  printf("%u cases\n", caseCount);
+
+  if (sFailures) {
+    fprintf(stderr, "%s: %u scans found other keywords\n", kProductName,
+            sFailures);
+    return 1;
+  }
+  return 0;
+}
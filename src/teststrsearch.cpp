@@ -0,0 +1,296 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Differential test of the case-insensitive search kernels:
+ *
+ * $ ./gfd-test-strsearch [-s seed] [-n rounds]
+ *
+ * Each implementation of findCaseInsensitive() (scalar, sse2 and avx2, if
+ * the CPU has them, and whichever findCaseInsensitive() itself picked) must
+ * return what strcasestr() returns in the "C" locale:
+ *
+ *   - for every haystack of 0 to 80 bytes, every needle of 0 to 80 bytes
+ *     taken from it at every offset, its case changed at random, and as
+ *     many needles made up;
+ *   - for rounds (20000) random haystacks of up to 4 KiB, with needles
+ *     of up to 80 bytes planted in them or not.
+ *
+ * Haystacks and needles are drawn from a few letters in both cases, the
+ * bytes next to 'A'..'Z' and 'a'..'z', and bytes >= 0x80, so that partial
+ * matches are many. Each search is run twice, with the haystack and the
+ * needle right after and right before an inaccessible page, so that a
+ * kernel that reads a byte too many crashes. The exit status is 1 if any
+ * implementation disagrees; the first disagreements are said on stderr.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "strsearch.h"
+
+static const char kProductName[] = "gfd-test-strsearch";
+
+static const size_t kShortMax = 80;
+static const size_t kLongMax = 4096;
+
+/* Letters in both cases and the bytes around them. */
+static const char kAlphabet[] =
+  "aAbBzZ@[`{1 \x80\xc3\xa9\xff";
+
+typedef struct _Kernel {
+  const char* name;
+  gfd::SearchFunction search;
+  uint64_t searches;
+} Kernel;
+
+/* A readable area between two inaccessible pages. */
+typedef struct _GuardedBuffer {
+  char* base;
+  char* data;
+  size_t size;
+} GuardedBuffer;
+
+static uint64_t sState;
+static uint32_t sFailures;
+
+static uint32_t nextRandom() {
+  /* xorshift64* */
+  sState ^= sState >> 12;
+  sState ^= sState << 25;
+  sState ^= sState >> 27;
+  return uint32_t((sState * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static char randomByte() {
+  return kAlphabet[nextRandom() % (sizeof(kAlphabet) - 1)];
+}
+
+static char flipCase(char aByte) {
+  if ((aByte >= 'a' && aByte <= 'z') || (aByte >= 'A' && aByte <= 'Z'))
+    return (nextRandom() & 1)? char(aByte ^ 0x20) : aByte;
+  return aByte;
+}
+
+static bool newGuardedBuffer(GuardedBuffer* aBuffer, size_t aSize) {
+  const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  aBuffer->size = (aSize + page - 1) / page * page;
+  void* base = mmap(NULL, aBuffer->size + 2 * page, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    perror("mmap");
+    return false;
+  }
+  aBuffer->base = static_cast<char*>(base);
+  aBuffer->data = aBuffer->base + page;
+  if (mprotect(aBuffer->data, aBuffer->size, PROT_READ | PROT_WRITE) < 0) {
+    perror("mprotect");
+    return false;
+  }
+  return true;
+}
+
+static void freeGuardedBuffer(GuardedBuffer* aBuffer) {
+  const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  munmap(aBuffer->base, aBuffer->size + 2 * page);
+}
+
+/* Copies aLength bytes of aText right after the first guard page, or right
+ * before the second one. */
+static const char* place(GuardedBuffer* aBuffer, const char* aText,
+                         size_t aLength, bool aAtEnd) {
+  char* data = aAtEnd? aBuffer->data + aBuffer->size - aLength
+                     : aBuffer->data;
+  memcpy(data, aText, aLength);
+  return data;
+}
+
+static void report(const Kernel* aKernel, const char* aHaystack,
+                   size_t aHaystackLength, const char* aNeedle,
+                   size_t aNeedleLength, long aExpected, long aFound) {
+  if (++sFailures > 10)
+    return;
+  fprintf(stderr, "%s: %s: needle \"%.*s\" (%zu bytes) in \"%.*s\" "
+          "(%zu bytes): found at %ld instead of %ld\n",
+          kProductName, aKernel->name, int(aNeedleLength), aNeedle,
+          aNeedleLength, int(aHaystackLength), aHaystack, aHaystackLength,
+          aFound, aExpected);
+}
+
+/* Searches aNeedle in aHaystack with every kernel, both placements. */
+static void check(Kernel* aKernels, uint32_t aKernelCount,
+                  GuardedBuffer* aHaystacks, GuardedBuffer* aNeedles,
+                  const char* aHaystack, size_t aHaystackLength,
+                  const char* aNeedle, size_t aNeedleLength) {
+  /* The reference works on C strings; no byte of the alphabet is NUL. */
+  char haystack[kLongMax + 1];
+  char needle[kShortMax + 1];
+  memcpy(haystack, aHaystack, aHaystackLength);
+  haystack[aHaystackLength] = '\0';
+  memcpy(needle, aNeedle, aNeedleLength);
+  needle[aNeedleLength] = '\0';
+
+  const char* match = strcasestr(haystack, needle);
+  const long expected = match? long(match - haystack) : -1;
+
+  int atEnd;
+  for (atEnd = 0; atEnd < 2; atEnd++) {
+    const char* h = place(aHaystacks, aHaystack, aHaystackLength, atEnd);
+    const char* n = place(aNeedles, aNeedle, aNeedleLength, atEnd);
+    uint32_t i;
+    for (i = 0; i < aKernelCount; i++) {
+      const char* found =
+        aKernels[i].search(h, aHaystackLength, n, aNeedleLength);
+      const long at = found? long(found - h) : -1;
+      aKernels[i].searches++;
+      if (at != expected) {
+        report(&aKernels[i], aHaystack, aHaystackLength, aNeedle,
+               aNeedleLength, expected, at);
+      }
+    }
+  }
+}
+
+static bool parseNumber(const char* aText, uint64_t* aValue) {
+  char* end;
+  unsigned long long value = strtoull(aText, &end, 10);
+  if (end == aText || *end)
+    return false;
+  *aValue = value;
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: %s [-s seed] [-n rounds]\n", kProductName);
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t seed = 1;
+  uint64_t rounds = 20000;
+
+  int option;
+  while (-1 != (option = getopt(argc, argv, "s:n:"))) {
+    switch (option) {
+    case 's':
+      if (!parseNumber(optarg, &seed)) {
+        usage();
+        return 2;
+      }
+      break;
+    case 'n':
+      if (!parseNumber(optarg, &rounds)) {
+        usage();
+        return 2;
+      }
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  sState = seed? seed : 1;
+
+  Kernel kernels[4];
+  uint32_t kernelCount = 0;
+  static const char* const kNames[] = { "scalar", "sse2", "avx2" };
+  uint32_t i;
+  for (i = 0; i < sizeof(kNames) / sizeof(kNames[0]); i++) {
+    gfd::SearchFunction search = gfd::searchFunction(kNames[i]);
+    if (!search) {
+      printf("%-8s not supported here, left out\n", kNames[i]);
+      continue;
+    }
+    kernels[kernelCount].name = kNames[i];
+    kernels[kernelCount].search = search;
+    kernels[kernelCount].searches = 0;
+    kernelCount++;
+  }
+  kernels[kernelCount].name = "default";
+  kernels[kernelCount].search = gfd::findCaseInsensitive;
+  kernels[kernelCount].searches = 0;
+  kernelCount++;
+
+  GuardedBuffer haystacks;
+  GuardedBuffer needles;
+  if (!newGuardedBuffer(&haystacks, kLongMax) ||
+      !newGuardedBuffer(&needles, kShortMax))
+    return 1;
+
+  char haystack[kLongMax];
+  char needle[kShortMax];
+
+  /* Every length, every offset. */
+  size_t length;
+  for (length = 0; length <= kShortMax; length++) {
+    size_t j;
+    for (j = 0; j < length; j++)
+      haystack[j] = randomByte();
+
+    size_t needleLength;
+    for (needleLength = 0; needleLength <= kShortMax; needleLength++) {
+      size_t offset;
+      for (offset = 0; offset + needleLength <= length; offset++) {
+        for (j = 0; j < needleLength; j++)
+          needle[j] = flipCase(haystack[offset + j]);
+        check(kernels, kernelCount, &haystacks, &needles,
+              haystack, length, needle, needleLength);
+      }
+
+      for (j = 0; j < needleLength; j++)
+        needle[j] = randomByte();
+      check(kernels, kernelCount, &haystacks, &needles,
+            haystack, length, needle, needleLength);
+    }
+  }
+
+  /* Long haystacks, through the vector loops. */
+  uint64_t round;
+  for (round = 0; round < rounds; round++) {
+    length = nextRandom() % (kLongMax + 1);
+    size_t j;
+    for (j = 0; j < length; j++)
+      haystack[j] = randomByte();
+
+    size_t needleLength = nextRandom() % (kShortMax + 1);
+    if (needleLength <= length && (nextRandom() & 1)) {
+      size_t offset = nextRandom() % (length - needleLength + 1);
+      for (j = 0; j < needleLength; j++)
+        needle[j] = flipCase(haystack[offset + j]);
+    }
+    else {
+      for (j = 0; j < needleLength; j++)
+        needle[j] = randomByte();
+    }
+    check(kernels, kernelCount, &haystacks, &needles,
+          haystack, length, needle, needleLength);
+  }
+
+  for (i = 0; i < kernelCount; i++)
+    printf("%-8s %llu searches\n", kernels[i].name,
+           static_cast<unsigned long long>(kernels[i].searches));
+
+  freeGuardedBuffer(&haystacks);
+  freeGuardedBuffer(&needles);
+
+  if (sFailures) {
+    fprintf(stderr, "%s: %u searches disagree with strcasestr()\n",
+            kProductName, sFailures);
+    return 1;
+  }
+  return 0;
+}
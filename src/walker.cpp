@@ -0,0 +1,1401 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Accessible tree walker.
+ *
+ * Asking GetInterfaces, CharacterCount, GetText, ChildCount and every
+ * GetChildAtIndex one after another costs one round trip each, so a big
+ * document used to take tens of thousands of sequential round trips.
+ * Instead, every request is sent as a DBusPendingCall and up to
+ * GFD_WALK_WINDOW of them are kept in flight at once. Replies are consumed
+ * in the order the requests were sent, and each reply queues the requests
+ * it makes possible (the text of a text node, the children of a node, the
+ * properties of a child), so the time a walk takes depends on the depth of
+ * the tree rather than on the number of nodes.
+ *
+ * Replies are taken with dbus_pending_call_block(), which does not dispatch
+ * anything else: signals that arrive meanwhile stay queued for main().
+ *
+ * Nothing is allocated per node or per request: the nodes of a walk are
+ * one growing array of (bus name, path) offsets into a string table of the
+ * walk (see strtable.h), requests refer to them by index, and the queues
+ * are ring buffers of requests; all of it is freed when the walk ends.
+ *
+ * With GFD_WALK_BATCHED, a node costs Properties.GetAll on the Text
+ * interface (which also tells whether the node is a text node at all) plus
+ * one Accessible.GetChildren, and then GetText, instead of 4 + N calls.
+ * Applications without GetChildren get GetAll on the Accessible interface
+ * and GetChildAtIndex for each child instead.
+ *
+ * When the application exports org.a11y.atspi.Cache, the structure of the
+ * tree (paths, parents, child counts and interfaces) is first taken from a
+ * single GetItems reply, and only GetText is asked for the text nodes of the
+ * document. Subtrees the cache doesn't fully cover, and applications
+ * without a cache, are walked node by node as above.
+ *
+ * A walk keeps to the budgets of greatfd.h: past GFD_WALK_MAX_NODES nodes,
+ * no new node is asked for; the text that would go past GFD_WALK_MAX_BYTES
+ * stops the walk; nodes deeper than GFD_WALK_MAX_DEPTH are left out; and
+ * once the deadline of the event has passed, what is still in flight is
+ * cancelled (each call times out at the deadline at the latest). Each of
+ * them sets its flag in WalkStatistics::truncated. So does the first call
+ * that times out at GFD_CALL_TIMEOUT, before the deadline: the application
+ * is taken to be hung, and the walk stops there rather than wait as long
+ * again for each of the requests in flight.
+ *
+ * A text longer than GFD_WALK_TEXT_WINDOW characters is asked for one
+ * window at a time, each one starting again aOverlap characters before the
+ * end of the previous one, so that a keyword no longer than that is whole
+ * in one of them; the next window is only asked for once the previous one
+ * has been handled, so a node never holds more than one window in the
+ * connection. Each window is a transient fragment of its own, dropped from
+ * the arena as soon as the handler has seen it, so neither does it hold
+ * more than one window of the arena. A window is asked for with one more
+ * character on each side, which is taken off again: the fragment only
+ * records whether they are word characters, for \b in patterns.
+ *
+ * The requests about nodes that aren't showing wait in a queue of their own
+ * that is only sent from when nothing else is waiting. The state of a node
+ * comes with its cache item; with GFD_WALK_VISIBLE_FIRST, a node walked one
+ * by one is also asked for GetState. A node inherits the state of its
+ * parent until its own is known; since replies are handled in the order the
+ * requests were sent, that is before the reply of its GetChildren, so its
+ * children are queued accordingly.
+ */
+
+#include "greatfd.h"
+#include "metrics.h"
+#include "pattern.h"
+#include "strtable.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+typedef enum {
+  eGetInterfaces,
+  eGetCharacterCount,
+  eGetText,
+  eGetChildCount,
+  eGetChildAtIndex,
+  eGetAllText,
+  eGetAllAccessible,
+  eGetChildren,
+  eGetState
+} WalkRequestKind;
+
+/* by WalkRequestKind */
+const gfd::MetricHistogram kLatencyHistograms[] = {
+  gfd::eHistogramGetInterfaces,
+  gfd::eHistogramGetCharacterCount,
+  gfd::eHistogramGetText,
+  gfd::eHistogramGetChildCount,
+  gfd::eHistogramGetChildAtIndex,
+  gfd::eHistogramGetAllText,
+  gfd::eHistogramGetAllAccessible,
+  gfd::eHistogramGetChildren,
+  gfd::eHistogramGetState
+};
+
+/* ATSPI_STATE_SHOWING, in the first word of a state set. */
+static const uint32_t kStateShowing = 1 << 25;
+
+static const uint32_t kNoNode = 0xffffffff;
+static const uint32_t kMinimumNodes = 256;
+static const uint32_t kMinimumRequests = 64;
+
+/* An accessible object. The requests about it refer to it by its index in
+ * Walk::nodes. */
+typedef struct _WalkNode {
+  uint32_t destination; /* in Walk::strings */
+  uint32_t path;
+  uint32_t depth;       /* below the root of the walk */
+  bool visible;         /* showing, as far as is known */
+} WalkNode;
+
+typedef struct _WalkRequest {
+  WalkRequestKind kind;
+  uint32_t node;
+  int32_t argument; /* character count (-1: all) or child index */
+  int32_t start;    /* of the GetText window */
+  DBusPendingCall* pending;
+  uint64_t sent;    /* metricsClock() */
+} WalkRequest;
+
+/* FIFO: a ring buffer, grown as needed. */
+typedef struct _WalkQueue {
+  WalkRequest* requests;
+  uint32_t head;
+  uint32_t count;
+  uint32_t capacity; /* a power of 2 */
+} WalkQueue;
+
+typedef struct _Walk {
+  DBusConnection* connection;
+  gfd::StringTable strings; /* bus names and paths */
+  WalkNode* nodes;          /* every node asked about, in order */
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  WalkQueue waiting;  /* not sent yet */
+  WalkQueue hidden;   /* not sent yet, about nodes that aren't showing */
+  WalkQueue inFlight; /* sent, in order */
+  gfd::TextArena* texts;
+  TextHandler handler;
+  void* closure;
+  bool stopped;
+  uint32_t visited;   /* nodes, counted against the budgets */
+  uint32_t bytes;
+  uint64_t deadline;  /* monotonicMilliseconds(); 0 if none */
+  int32_t window;     /* characters a GetText asks for at most; 0: all */
+  int32_t overlap;    /* between two windows */
+  WalkStatistics* statistics;
+} Walk;
+
+bool isPastDeadline(const Walk* aWalk) {
+  return aWalk->deadline && monotonicMilliseconds() >= aWalk->deadline;
+}
+
+void setTruncated(Walk* aWalk, WalkTruncation aReason) {
+  aWalk->statistics->truncated |= aReason;
+}
+
+/* A call got no reply in GFD_CALL_TIMEOUT: the application is taken to be
+ * hung. */
+void stopAtTimeout(Walk* aWalk) {
+  aWalk->statistics->timeouts++;
+  setTruncated(aWalk, eTruncatedTimeout);
+  aWalk->stopped = true;
+}
+
+/* The walk couldn't grow: the rest of the page is never asked for. */
+void stopOutOfMemory(Walk* aWalk) {
+  setTruncated(aWalk, eTruncatedMemory);
+  aWalk->stopped = true;
+}
+
+/* Returns the index of a new node, visible and at the root, or kNoNode on
+ * allocation failure, which stops the walk. aDestination and aPath are in
+ * Walk::strings (kNoString if they couldn't be added). */
+uint32_t addNode(Walk* aWalk, uint32_t aDestination, uint32_t aPath) {
+  if (aDestination == gfd::kNoString || aPath == gfd::kNoString) {
+    stopOutOfMemory(aWalk);
+    return kNoNode;
+  }
+
+  if (aWalk->nodeCount == aWalk->nodeCapacity) {
+    uint32_t capacity =
+      aWalk->nodeCapacity? aWalk->nodeCapacity * 2 : kMinimumNodes;
+    WalkNode* nodes = static_cast<WalkNode*>(
+      realloc(aWalk->nodes, sizeof(WalkNode) * capacity));
+    if (!nodes) {
+      stopOutOfMemory(aWalk);
+      return kNoNode;
+    }
+    aWalk->nodes = nodes;
+    aWalk->nodeCapacity = capacity;
+  }
+
+  WalkNode* node = &aWalk->nodes[aWalk->nodeCount];
+  node->destination = aDestination;
+  node->path = aPath;
+  node->depth = 0;
+  node->visible = true;
+  return aWalk->nodeCount++;
+}
+
+uint32_t newNode(Walk* aWalk, const char* aDestination, const char* aPath) {
+  uint32_t destination = gfd::internString(&aWalk->strings, aDestination);
+  uint32_t path = gfd::internString(&aWalk->strings, aPath);
+  return addNode(aWalk, destination, path);
+}
+
+inline const char* destinationOf(const Walk* aWalk, uint32_t aNode) {
+  return gfd::stringAt(&aWalk->strings, aWalk->nodes[aNode].destination);
+}
+
+inline const char* pathOf(const Walk* aWalk, uint32_t aNode) {
+  return gfd::stringAt(&aWalk->strings, aWalk->nodes[aNode].path);
+}
+
+bool push(WalkQueue* aQueue, const WalkRequest* aRequest) {
+  if (aQueue->count == aQueue->capacity) {
+    uint32_t capacity =
+      aQueue->capacity? aQueue->capacity * 2 : kMinimumRequests;
+    WalkRequest* requests =
+      static_cast<WalkRequest*>(malloc(sizeof(WalkRequest) * capacity));
+    if (!requests)
+      return false;
+    uint32_t i;
+    for (i = 0; i < aQueue->count; i++) {
+      requests[i] =
+        aQueue->requests[(aQueue->head + i) & (aQueue->capacity - 1)];
+    }
+    free(aQueue->requests);
+    aQueue->requests = requests;
+    aQueue->head = 0;
+    aQueue->capacity = capacity;
+  }
+
+  aQueue->requests[(aQueue->head + aQueue->count) & (aQueue->capacity - 1)] =
+    *aRequest;
+  aQueue->count++;
+  return true;
+}
+
+bool pop(WalkQueue* aQueue, WalkRequest* aRequest) {
+  if (!aQueue->count)
+    return false;
+
+  *aRequest = aQueue->requests[aQueue->head];
+  aQueue->head = (aQueue->head + 1) & (aQueue->capacity - 1);
+  aQueue->count--;
+  return true;
+}
+
+/* Queues a request about aNode. Returns false if it couldn't be, which
+ * stops the walk. */
+bool enqueue(Walk* aWalk, WalkRequestKind aKind, uint32_t aNode,
+             int32_t aArgument, int32_t aStart = 0) {
+  WalkRequest request;
+  request.kind = aKind;
+  request.node = aNode;
+  request.argument = aArgument;
+  request.start = aStart;
+  request.pending = NULL;
+  request.sent = 0;
+  if (!push(aWalk->nodes[aNode].visible? &aWalk->waiting : &aWalk->hidden,
+            &request)) {
+    stopOutOfMemory(aWalk);
+    return false;
+  }
+  return true;
+}
+
+void releaseRequest(WalkRequest* aRequest) {
+  if (aRequest->pending)
+    dbus_pending_call_unref(aRequest->pending);
+}
+
+/* Where the GetText window of aRequest ends; -1 for the end of the text. */
+int32_t windowEnd(const Walk* aWalk, const WalkRequest* aRequest) {
+  if (aRequest->argument < 0 || !aWalk->window ||
+      aRequest->argument - aRequest->start <= aWalk->window)
+    return aRequest->argument;
+  return aRequest->start + aWalk->window;
+}
+
+/* Whether the GetText window of aRequest is preceded, and followed, by more
+ * of the text. */
+bool hasTextBefore(const WalkRequest* aRequest) {
+  return aRequest->start > 0;
+}
+
+bool hasTextAfter(const Walk* aWalk, const WalkRequest* aRequest) {
+  const int32_t end = windowEnd(aWalk, aRequest);
+  return end >= 0 && end < aRequest->argument;
+}
+
+/* Asks for the text of aNode, whose length isn't known yet. */
+void enqueueText(Walk* aWalk, uint32_t aNode) {
+#if GFD_WALK_TEXT_WINDOW > 0
+  enqueue(aWalk, eGetCharacterCount, aNode, 0);
+#else
+  enqueue(aWalk, eGetText, aNode, -1);
+#endif
+}
+
+/* Asks for the children of aNode; each of them will be enqueueNode()d. */
+void enqueueChildren(Walk* aWalk, uint32_t aNode) {
+#if GFD_WALK_BATCHED
+  enqueue(aWalk, eGetChildren, aNode, 0);
+#else
+  enqueue(aWalk, eGetChildCount, aNode, 0);
+#endif
+}
+
+/* The requests every node starts with; they don't depend on each other. */
+void enqueueNode(Walk* aWalk, uint32_t aNode) {
+  if (GFD_WALK_MAX_NODES > 0 && aWalk->visited >= GFD_WALK_MAX_NODES) {
+    setTruncated(aWalk, eTruncatedNodes);
+    return;
+  }
+  aWalk->visited++;
+  aWalk->statistics->nodes++;
+#if GFD_WALK_VISIBLE_FIRST
+  enqueue(aWalk, eGetState, aNode, 0);
+#endif
+#if GFD_WALK_BATCHED
+  enqueue(aWalk, eGetAllText, aNode, 0);
+#else
+  enqueue(aWalk, eGetInterfaces, aNode, 0);
+#endif
+  enqueueChildren(aWalk, aNode);
+}
+
+/* Building a message anew costs less than dbus_message_copy() of one
+ * prepared per kind and setting its path and destination, so there are no
+ * templates; the constant arguments are static. */
+DBusMessage* newMethodCall(const Walk* aWalk, const WalkRequest* aRequest) {
+  const char* destination = destinationOf(aWalk, aRequest->node);
+  const char* path = pathOf(aWalk, aRequest->node);
+  DBusMessage* method(NULL);
+  bool succeeded(true);
+
+  switch (aRequest->kind) {
+  case eGetInterfaces:
+    method = dbus_message_new_method_call(destination, path,
+                                          gfd::atspi::interface::kAccessible,
+                                          "GetInterfaces");
+    break;
+
+  case eGetCharacterCount:
+    {
+      method = dbus_message_new_method_call(destination, path,
+                                            DBUS_INTERFACE_PROPERTIES,
+                                            "Get");
+      static const char* const attribute = "CharacterCount";
+      succeeded = method &&
+        dbus_message_append_args(method,
+                                 DBUS_TYPE_STRING,
+                                 &gfd::atspi::interface::kText,
+                                 DBUS_TYPE_STRING, &attribute,
+                                 DBUS_TYPE_INVALID);
+    }
+    break;
+
+  case eGetText:
+    {
+      method = dbus_message_new_method_call(destination, path,
+                                            gfd::atspi::interface::kText,
+                                            "GetText");
+      /* With the characters around the window; see takeContext(). */
+      const int32_t start =
+        aRequest->start - (hasTextBefore(aRequest)? 1 : 0);
+      const int32_t end =
+        windowEnd(aWalk, aRequest) + (hasTextAfter(aWalk, aRequest)? 1 : 0);
+      succeeded = method &&
+        dbus_message_append_args(method,
+                                 DBUS_TYPE_INT32, &start,
+                                 DBUS_TYPE_INT32, &end,
+                                 DBUS_TYPE_INVALID);
+    }
+    break;
+
+  case eGetChildCount:
+    {
+      method = dbus_message_new_method_call(destination, path,
+                                            DBUS_INTERFACE_PROPERTIES,
+                                            "Get");
+      static const char* const attribute = "ChildCount";
+      succeeded = method &&
+        dbus_message_append_args(method,
+                                 DBUS_TYPE_STRING,
+                                 &gfd::atspi::interface::kAccessible,
+                                 DBUS_TYPE_STRING, &attribute,
+                                 DBUS_TYPE_INVALID);
+    }
+    break;
+
+  case eGetChildAtIndex:
+    method = dbus_message_new_method_call(destination, path,
+                                          gfd::atspi::interface::kAccessible,
+                                          "GetChildAtIndex");
+    succeeded = method &&
+      dbus_message_append_args(method,
+                               DBUS_TYPE_INT32, &aRequest->argument,
+                               DBUS_TYPE_INVALID);
+    break;
+
+  case eGetAllText:
+  case eGetAllAccessible:
+    method = dbus_message_new_method_call(destination, path,
+                                          DBUS_INTERFACE_PROPERTIES,
+                                          "GetAll");
+    succeeded = method &&
+      dbus_message_append_args(method,
+                               DBUS_TYPE_STRING,
+                               (aRequest->kind == eGetAllText)?
+                                 &gfd::atspi::interface::kText :
+                                 &gfd::atspi::interface::kAccessible,
+                               DBUS_TYPE_INVALID);
+    break;
+
+  case eGetChildren:
+    method = dbus_message_new_method_call(destination, path,
+                                          gfd::atspi::interface::kAccessible,
+                                          "GetChildren");
+    break;
+
+  case eGetState:
+    method = dbus_message_new_method_call(destination, path,
+                                          gfd::atspi::interface::kAccessible,
+                                          "GetState");
+    break;
+  }
+
+  if (!succeeded && method) {
+    dbus_message_unref(method);
+    method = NULL;
+  }
+  return method;
+}
+
+bool sendRequest(Walk* aWalk, WalkRequest* aRequest) {
+  DBusMessage* method = newMethodCall(aWalk, aRequest);
+  if (!method)
+    return false;
+
+  bool succeeded =
+    dbus_connection_send_with_reply(aWalk->connection, method,
+                                    &aRequest->pending,
+                                    callTimeout(aWalk->deadline));
+  dbus_message_unref(method);
+
+  /* pending is NULL when the connection is already closed. */
+  if (!succeeded || !aRequest->pending)
+    return false;
+
+  aRequest->sent = gfd::metricsClock();
+  aWalk->statistics->roundTrips++;
+  return true;
+}
+
+/* Reads the int32 wrapped in the variant of a Properties.Get reply. */
+bool getVariantInt32(DBusMessage* aReply, int32_t* aValue) {
+  DBusMessageIter viter;
+  dbus_message_iter_init(aReply, &viter);
+  int type = dbus_message_iter_get_arg_type(&viter);
+
+  while (type != DBUS_TYPE_INVALID) {
+    if (DBUS_TYPE_VARIANT == type) {
+      DBusMessageIter iiter;
+      dbus_message_iter_recurse(&viter, &iiter);
+      type = dbus_message_iter_get_arg_type(&iiter);
+
+      if (DBUS_TYPE_INT32 == type) {
+        dbus_message_iter_get_basic(&iiter, aValue);
+        return true;
+      }
+    }
+
+    dbus_message_iter_next(&viter);
+    type = dbus_message_iter_get_arg_type(&viter);
+  }
+  return false;
+}
+
+/* Reads the int32 property aName out of a Properties.GetAll reply. */
+bool getPropertyInt32(DBusMessage* aReply, const char* aName,
+                      int32_t* aValue) {
+  DBusMessageIter aiter;
+  dbus_message_iter_init(aReply, &aiter);
+  if (DBUS_TYPE_ARRAY != dbus_message_iter_get_arg_type(&aiter))
+    return false;
+
+  DBusMessageIter eiter;
+  dbus_message_iter_recurse(&aiter, &eiter);
+  while (DBUS_TYPE_DICT_ENTRY == dbus_message_iter_get_arg_type(&eiter)) {
+    DBusMessageIter kiter;
+    dbus_message_iter_recurse(&eiter, &kiter);
+
+    const char* name(NULL);
+    dbus_message_iter_get_basic(&kiter, &name);
+    if (0 == strcmp(name, aName)) {
+      dbus_message_iter_next(&kiter);
+      DBusMessageIter viter;
+      dbus_message_iter_recurse(&kiter, &viter);
+      if (DBUS_TYPE_INT32 != dbus_message_iter_get_arg_type(&viter))
+        return false;
+      dbus_message_iter_get_basic(&viter, aValue);
+      return true;
+    }
+    dbus_message_iter_next(&eiter);
+  }
+  return false;
+}
+
+void handleInterfaces(Walk* aWalk, uint32_t aNode, DBusMessage* aReply) {
+  DBusMessageIter aiter;
+  dbus_message_iter_init(aReply, &aiter);
+  int type = dbus_message_iter_get_arg_type(&aiter);
+  if (DBUS_TYPE_ARRAY != type)
+    return;
+
+  DBusMessageIter siter;
+  dbus_message_iter_recurse(&aiter, &siter);
+  type = dbus_message_iter_get_arg_type(&siter);
+  while (DBUS_TYPE_STRING == type) {
+    const char* interface;
+    dbus_message_iter_get_basic(&siter, &interface);
+    if (0 == strncmp(gfd::atspi::interface::kText, interface,
+                     sizeof(GFD_ATSPI_INTERFACE_TEXT))) {
+      enqueue(aWalk, eGetCharacterCount, aNode, 0);
+      return;
+    }
+    dbus_message_iter_next(&siter);
+    type = dbus_message_iter_get_arg_type(&siter);
+  }
+}
+
+/* The number of UTF-8 characters of aText, up to aLimit. */
+int32_t countCharacters(const char* aText, int32_t aLimit) {
+  int32_t count = 0;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(aText);
+  for (; *p && count < aLimit; p++) {
+    if ((*p & 0xc0) != 0x80)
+      count++;
+  }
+  return count;
+}
+
+/* Takes the characters around the window of aRequest off the text of its
+ * GetText reply (*aData, *aLength), telling whether they are word
+ * characters. The one after is only there if the text wasn't shorter than
+ * asked for. */
+void takeContext(const Walk* aWalk, const WalkRequest* aRequest,
+                 const char** aData, size_t* aLength, bool* aWordBefore,
+                 bool* aWordAfter) {
+  const char* data = *aData;
+  const char* end = data + *aLength;
+  *aWordBefore = false;
+  *aWordAfter = false;
+
+  if (hasTextBefore(aRequest) && data < end) {
+    *aWordBefore = gfd::isWordByte(uint8_t(*data));
+    data++;
+    while (data < end && (*data & 0xc0) == 0x80)
+      data++;
+  }
+  if (hasTextAfter(aWalk, aRequest)) {
+    const int32_t characters =
+      windowEnd(aWalk, aRequest) - aRequest->start + 1;
+    if (countCharacters(data, characters + 1) == characters) {
+      do
+        end--;
+      while (end > data && (*end & 0xc0) == 0x80);
+      *aWordAfter = gfd::isWordByte(uint8_t(*end));
+    }
+  }
+
+  *aData = data;
+  *aLength = end - data;
+}
+
+void handleText(Walk* aWalk, const WalkRequest* aRequest,
+                DBusMessage* aReply) {
+  DBusError error;
+  dbus_error_init(&error);
+
+  const char* data(NULL);
+  bool succeeded = dbus_message_get_args(aReply, &error,
+                                         DBUS_TYPE_STRING, &data,
+                                         DBUS_TYPE_INVALID);
+  GFD_CHECK_DBUS_ERROR(&error);
+  if (!succeeded || !data)
+    return;
+
+  /* Without CharacterCount, apply the same "more than 2 characters" rule
+   * to the text itself. */
+  if (aRequest->argument < 0 && countCharacters(data, 3) <= 2)
+    return;
+
+  size_t length = strlen(data);
+  bool wordBefore = false;
+  bool wordAfter = false;
+  takeContext(aWalk, aRequest, &data, &length, &wordBefore, &wordAfter);
+  if (GFD_WALK_MAX_BYTES > 0 &&
+      length > size_t(GFD_WALK_MAX_BYTES) - aWalk->bytes) {
+    setTruncated(aWalk, eTruncatedBytes);
+    aWalk->stopped = true;
+    return;
+  }
+  /* The windows of a long text are dropped once they have been handled. */
+  const int32_t end = windowEnd(aWalk, aRequest);
+  const bool window = aRequest->start > 0 ||
+                      (end >= 0 && end < aRequest->argument);
+  if (!gfd::appendText(aWalk->texts, data, length, window)) {
+    stopOutOfMemory(aWalk);
+    return;
+  }
+  gfd::TextFragment* fragment =
+    &aWalk->texts->fragments[aWalk->texts->count - 1];
+  fragment->wordBefore = wordBefore;
+  fragment->wordAfter = wordAfter;
+  aWalk->bytes += length;
+  aWalk->statistics->texts++;
+  aWalk->statistics->bytes += length;
+  if (aWalk->handler &&
+      !aWalk->handler(aWalk->texts, aWalk->texts->count - 1,
+                      pathOf(aWalk, aRequest->node), aWalk->closure))
+    aWalk->stopped = true;
+  if (window)
+    gfd::dropLastText(aWalk->texts);
+
+  /* The next window starts again overlap characters before the end of
+     this one. */
+  if (!aWalk->stopped && end >= 0 && end < aRequest->argument) {
+    enqueue(aWalk, eGetText, aRequest->node, aRequest->argument,
+            end - aWalk->overlap);
+  }
+}
+
+/* Reads the state set of a GetState reply; only whether the node is showing
+ * matters. */
+void handleState(Walk* aWalk, uint32_t aNode, DBusMessage* aReply) {
+  DBusMessageIter arrayIter;
+  dbus_message_iter_init(aReply, &arrayIter);
+  if (DBUS_TYPE_ARRAY != dbus_message_iter_get_arg_type(&arrayIter))
+    return;
+
+  DBusMessageIter stateIter;
+  dbus_message_iter_recurse(&arrayIter, &stateIter);
+  if (DBUS_TYPE_UINT32 == dbus_message_iter_get_arg_type(&stateIter)) {
+    dbus_uint32_t states(0);
+    dbus_message_iter_get_basic(&stateIter, &states);
+    aWalk->nodes[aNode].visible = (states & kStateShowing) != 0;
+  }
+}
+
+/* Starts walking the child of aParent referenced by the (so) struct at
+ * aIter. */
+void enqueueReference(Walk* aWalk, uint32_t aParent, DBusMessageIter* aIter) {
+  /* A copy: adding the child may move the nodes. */
+  const WalkNode parent = aWalk->nodes[aParent];
+  if (GFD_WALK_MAX_DEPTH > 0 && parent.depth >= GFD_WALK_MAX_DEPTH) {
+    setTruncated(aWalk, eTruncatedDepth);
+    return;
+  }
+
+  DBusMessageIter childIter;
+  dbus_message_iter_recurse(aIter, &childIter);
+
+  const char* destination(NULL);
+  dbus_message_iter_get_basic(&childIter, &destination);
+  dbus_message_iter_next(&childIter);
+
+  const char* path(NULL);
+  dbus_message_iter_get_basic(&childIter, &path);
+
+  if (path && destination) {
+    uint32_t child = newNode(aWalk, destination, path);
+    if (child != kNoNode) {
+      aWalk->nodes[child].depth = parent.depth + 1;
+      aWalk->nodes[child].visible = parent.visible;
+      enqueueNode(aWalk, child);
+    }
+  }
+}
+
+void handleChild(Walk* aWalk, uint32_t aParent, DBusMessage* aReply) {
+  DBusMessageIter parentIter;
+  dbus_message_iter_init(aReply, &parentIter);
+  int type = dbus_message_iter_get_arg_type(&parentIter);
+  char* signature = dbus_message_iter_get_signature(&parentIter);
+
+  if (DBUS_TYPE_STRUCT == type &&
+      0 == strncmp("(so)", signature, sizeof("(so)"))) {
+    enqueueReference(aWalk, aParent, &parentIter);
+  }
+  dbus_free(signature);
+}
+
+void handleChildren(Walk* aWalk, uint32_t aParent, DBusMessage* aReply) {
+  DBusMessageIter arrayIter;
+  dbus_message_iter_init(aReply, &arrayIter);
+  char* signature = dbus_message_iter_get_signature(&arrayIter);
+
+  if (0 == strncmp("a(so)", signature, sizeof("a(so)"))) {
+    DBusMessageIter childIter;
+    dbus_message_iter_recurse(&arrayIter, &childIter);
+    while (DBUS_TYPE_STRUCT == dbus_message_iter_get_arg_type(&childIter)) {
+      enqueueReference(aWalk, aParent, &childIter);
+      dbus_message_iter_next(&childIter);
+    }
+  }
+  dbus_free(signature);
+}
+
+#if GFD_WALK_USE_CACHE
+/* One element of a Cache.GetItems reply. The strings point into the
+ * reply. */
+typedef struct _CacheItem {
+  const char* path;
+  const char* parent;
+  int32_t childCount;
+  bool isText;
+  bool visible;
+  uint32_t firstChild;
+  uint32_t nextSibling;
+  int32_t cachedChildren;
+  uint32_t depth;
+  bool visited;
+} CacheItem;
+
+static const uint32_t kNoItem = 0xffffffff;
+
+/* Item signatures of at-spi2 >= 2.34 (index in parent, child count) and of
+ * older versions (list of children). */
+static const char kCacheItemSignature[] = "((so)(so)(so)iiassusau)";
+static const char kOldCacheItemSignature[] = "((so)(so)(so)a(so)assusau)";
+
+int compareItemPaths(const void* aLeft, const void* aRight, void* aItems) {
+  const CacheItem* items = static_cast<const CacheItem*>(aItems);
+  return strcmp(items[*static_cast<const uint32_t*>(aLeft)].path,
+                items[*static_cast<const uint32_t*>(aRight)].path);
+}
+
+/* Index of the item at aPath, looked up in aSorted. */
+uint32_t findItem(const CacheItem* aItems, const uint32_t* aSorted,
+                  uint32_t aCount, const char* aPath) {
+  uint32_t low = 0;
+  uint32_t high = aCount;
+  while (low < high) {
+    uint32_t middle = (low + high) / 2;
+    int order = strcmp(aItems[aSorted[middle]].path, aPath);
+    if (order == 0)
+      return aSorted[middle];
+    if (order < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return kNoItem;
+}
+
+/* Reads the object path of a (so) reference. */
+const char* getReferencePath(DBusMessageIter* aIter) {
+  DBusMessageIter referenceIter;
+  dbus_message_iter_recurse(aIter, &referenceIter);
+  dbus_message_iter_next(&referenceIter);
+
+  const char* path(NULL);
+  dbus_message_iter_get_basic(&referenceIter, &path);
+  return path;
+}
+
+bool readCacheItem(DBusMessageIter* aItemIter, bool aOldLayout,
+                   CacheItem* aItem) {
+  DBusMessageIter fieldIter;
+  dbus_message_iter_recurse(aItemIter, &fieldIter);
+
+  aItem->path = getReferencePath(&fieldIter);
+  dbus_message_iter_next(&fieldIter); /* application */
+  dbus_message_iter_next(&fieldIter);
+  aItem->parent = getReferencePath(&fieldIter);
+  dbus_message_iter_next(&fieldIter);
+
+  if (aOldLayout) {
+    DBusMessageIter childIter;
+    dbus_message_iter_recurse(&fieldIter, &childIter);
+    aItem->childCount = 0;
+    while (DBUS_TYPE_STRUCT == dbus_message_iter_get_arg_type(&childIter)) {
+      aItem->childCount++;
+      dbus_message_iter_next(&childIter);
+    }
+  }
+  else {
+    dbus_message_iter_next(&fieldIter); /* index in parent */
+    dbus_message_iter_get_basic(&fieldIter, &aItem->childCount);
+  }
+  dbus_message_iter_next(&fieldIter);
+
+  aItem->isText = false;
+  DBusMessageIter interfaceIter;
+  dbus_message_iter_recurse(&fieldIter, &interfaceIter);
+  while (DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&interfaceIter)) {
+    const char* interface;
+    dbus_message_iter_get_basic(&interfaceIter, &interface);
+    if (0 == strncmp(gfd::atspi::interface::kText, interface,
+                     sizeof(GFD_ATSPI_INTERFACE_TEXT))) {
+      aItem->isText = true;
+      break;
+    }
+    dbus_message_iter_next(&interfaceIter);
+  }
+  dbus_message_iter_next(&fieldIter); /* name */
+  dbus_message_iter_next(&fieldIter); /* role */
+  dbus_message_iter_next(&fieldIter); /* description */
+
+  aItem->visible = true;
+  DBusMessageIter stateIter;
+  dbus_message_iter_next(&fieldIter);
+  dbus_message_iter_recurse(&fieldIter, &stateIter);
+  if (DBUS_TYPE_UINT32 == dbus_message_iter_get_arg_type(&stateIter)) {
+    dbus_uint32_t states(0);
+    dbus_message_iter_get_basic(&stateIter, &states);
+    aItem->visible = (states & kStateShowing) != 0;
+  }
+
+  aItem->firstChild = kNoItem;
+  aItem->nextSibling = kNoItem;
+  aItem->cachedChildren = 0;
+  aItem->depth = 0;
+  aItem->visited = false;
+  return aItem->path && aItem->parent;
+}
+
+/* Queues GetText for every text node under aRoot, as far as the cache of
+ * the application knows the tree, showing subtrees first. Returns false if
+ * the cache can't be used at all, in which case nothing has been
+ * queued. */
+bool walkCache(Walk* aWalk, uint32_t aRoot) {
+  DBusMessage* method =
+    dbus_message_new_method_call(destinationOf(aWalk, aRoot),
+                                 GFD_ATSPI_CACHE_PATH,
+                                 gfd::atspi::interface::kCache,
+                                 "GetItems");
+  if (!method)
+    return false;
+
+  DBusError error;
+  dbus_error_init(&error);
+
+  aWalk->statistics->roundTrips++;
+  uint64_t sent = gfd::metricsClock();
+  DBusMessage* response =
+    dbus_connection_send_with_reply_and_block(aWalk->connection,
+                                              method,
+                                              callTimeout(aWalk->deadline),
+                                              &error);
+  gfd::recordValue(gfd::eHistogramGetItems, gfd::metricsClock() - sent);
+  dbus_message_unref(method);
+
+  /* No Cache interface is not an error worth reporting. */
+  if (dbus_error_is_set(&error)) {
+    if (isCallTimeout(&error, aWalk->deadline))
+      stopAtTimeout(aWalk);
+    dbus_error_free(&error);
+  }
+
+  if (!response)
+    return false;
+
+  DBusMessageIter arrayIter;
+  dbus_message_iter_init(response, &arrayIter);
+  if (DBUS_TYPE_ARRAY != dbus_message_iter_get_arg_type(&arrayIter)) {
+    dbus_message_unref(response);
+    return false;
+  }
+
+  DBusMessageIter itemIter;
+  dbus_message_iter_recurse(&arrayIter, &itemIter);
+
+  bool oldLayout(false);
+  {
+    char* signature = dbus_message_iter_get_signature(&itemIter);
+    if (0 == strcmp(signature, kOldCacheItemSignature))
+      oldLayout = true;
+    else if (0 != strcmp(signature, kCacheItemSignature) &&
+             DBUS_TYPE_INVALID != dbus_message_iter_get_arg_type(&itemIter)) {
+      dbus_free(signature);
+      dbus_message_unref(response);
+      return false;
+    }
+    dbus_free(signature);
+  }
+
+  CacheItem* items(NULL);
+  uint32_t count = 0;
+  uint32_t capacity = 0;
+  bool succeeded(true);
+  while (DBUS_TYPE_STRUCT == dbus_message_iter_get_arg_type(&itemIter)) {
+    if (count == capacity) {
+      capacity = capacity? capacity * 2 : 256;
+      CacheItem* grown =
+        static_cast<CacheItem*>(realloc(items, sizeof(CacheItem) * capacity));
+      if (!grown) {
+        succeeded = false;
+        break;
+      }
+      items = grown;
+    }
+    if (readCacheItem(&itemIter, oldLayout, &items[count]))
+      count++;
+    dbus_message_iter_next(&itemIter);
+  }
+
+  uint32_t* sorted(NULL);
+  uint32_t* hidden(NULL);
+  if (succeeded && count) {
+    sorted = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * count));
+    hidden = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * count));
+    succeeded = sorted && hidden;
+  }
+
+  uint32_t root = kNoItem;
+  if (succeeded && count) {
+    uint32_t i;
+    for (i = 0; i < count; i++)
+      sorted[i] = i;
+    qsort_r(sorted, count, sizeof(uint32_t), compareItemPaths, items);
+
+    /* Link children to parents. Going backwards keeps sibling order. */
+    for (i = count; i-- > 0;) {
+      uint32_t parent = findItem(items, sorted, count, items[i].parent);
+      if (parent != kNoItem && parent != i) {
+        items[i].nextSibling = items[parent].firstChild;
+        items[parent].firstChild = i;
+        items[parent].cachedChildren++;
+      }
+    }
+
+    root = findItem(items, sorted, count, pathOf(aWalk, aRoot));
+  }
+
+  if (root == kNoItem) {
+    free(hidden);
+    free(sorted);
+    free(items);
+    dbus_message_unref(response);
+    return false;
+  }
+
+  /* Depth first, reusing the sorted index array as the stack. Subtrees
+   * that aren't showing are set aside in hidden, and walked once the stack
+   * is empty. */
+  uint32_t* stack = sorted;
+  uint32_t depth = 0;
+  uint32_t hiddenCount = 0;
+  stack[depth++] = root;
+  while (depth || hiddenCount) {
+    if (!depth) {
+      while (hiddenCount)
+        stack[depth++] = hidden[--hiddenCount];
+    }
+
+    CacheItem* item = &items[stack[--depth]];
+    /* A broken cache could contain cycles. */
+    if (item->visited)
+      continue;
+    item->visited = true;
+
+    if (GFD_WALK_MAX_NODES > 0 && aWalk->visited >= GFD_WALK_MAX_NODES) {
+      setTruncated(aWalk, eTruncatedNodes);
+      break;
+    }
+    /* Paths are unique within an application, so aRoot's bus name
+     * applies. */
+    aWalk->visited++;
+    aWalk->statistics->nodes++;
+
+    bool partial = item->cachedChildren < item->childCount;
+    bool deepest = GFD_WALK_MAX_DEPTH > 0 && item->depth >= GFD_WALK_MAX_DEPTH;
+    if (deepest && item->childCount > 0) {
+      setTruncated(aWalk, eTruncatedDepth);
+      partial = false;
+    }
+    if (item->isText || partial) {
+      uint32_t node =
+        addNode(aWalk, aWalk->nodes[aRoot].destination,
+                gfd::internString(&aWalk->strings, item->path));
+      if (node == kNoNode)
+        continue;
+      aWalk->nodes[node].depth = item->depth;
+      aWalk->nodes[node].visible = item->visible;
+      if (item->isText)
+        enqueueText(aWalk, node);
+      if (partial)
+        enqueueChildren(aWalk, node);
+      if (partial)
+        continue;
+    }
+    if (deepest)
+      continue;
+
+    uint32_t child;
+    for (child = item->firstChild; child != kNoItem;
+         child = items[child].nextSibling) {
+      items[child].depth = item->depth + 1;
+      if (!items[child].visible) {
+        if (hiddenCount < count)
+          hidden[hiddenCount++] = child;
+      }
+      else if (depth < count) {
+        stack[depth++] = child;
+      }
+    }
+  }
+
+  free(hidden);
+  free(sorted);
+  free(items);
+  dbus_message_unref(response);
+  return true;
+}
+#endif
+
+void handle(Walk* aWalk, WalkRequest* aRequest, DBusMessage* aReply) {
+  if (DBUS_MESSAGE_TYPE_ERROR == dbus_message_get_type(aReply)) {
+    /* Timed out at the deadline; run() reports that. */
+    if (isPastDeadline(aWalk))
+      return;
+
+    if (dbus_message_is_error(aReply, DBUS_ERROR_NO_REPLY)) {
+      stopAtTimeout(aWalk);
+      return;
+    }
+
+    switch (aRequest->kind) {
+    case eGetAllText:
+      /* Not a text node. */
+      return;
+
+    case eGetChildren:
+      /* No GetChildren; fall back to one call per child. */
+      enqueue(aWalk, eGetAllAccessible, aRequest->node, 0);
+      return;
+
+    case eGetState:
+      /* Not known: walk it as if it were showing. */
+      return;
+
+    case eGetCharacterCount:
+      /* Ask for the whole text, as if there were no windows. */
+      enqueue(aWalk, eGetText, aRequest->node, -1);
+      return;
+
+    default:
+      break;
+    }
+
+    DBusError error;
+    dbus_error_init(&error);
+    dbus_set_error_from_message(&error, aReply);
+    GFD_CHECK_DBUS_ERROR(&error);
+    return;
+  }
+
+  switch (aRequest->kind) {
+  case eGetInterfaces:
+    handleInterfaces(aWalk, aRequest->node, aReply);
+    break;
+
+  case eGetCharacterCount:
+    {
+      int32_t characterCount(0);
+      if (getVariantInt32(aReply, &characterCount) && characterCount > 2)
+        enqueue(aWalk, eGetText, aRequest->node, characterCount);
+    }
+    break;
+
+  case eGetText:
+    handleText(aWalk, aRequest, aReply);
+    break;
+
+  case eGetChildCount:
+    {
+      int32_t childCount(0);
+      getVariantInt32(aReply, &childCount);
+      int32_t i;
+      for (i = 0; i < childCount; i++) {
+        if (!enqueue(aWalk, eGetChildAtIndex, aRequest->node, i))
+          break;
+      }
+    }
+    break;
+
+  case eGetChildAtIndex:
+    handleChild(aWalk, aRequest->node, aReply);
+    break;
+
+  case eGetAllText:
+    {
+      int32_t characterCount(0);
+      if (getPropertyInt32(aReply, "CharacterCount", &characterCount) &&
+          characterCount > 2)
+        enqueue(aWalk, eGetText, aRequest->node, characterCount);
+    }
+    break;
+
+  case eGetAllAccessible:
+    {
+      int32_t childCount(0);
+      getPropertyInt32(aReply, "ChildCount", &childCount);
+      int32_t i;
+      for (i = 0; i < childCount; i++) {
+        if (!enqueue(aWalk, eGetChildAtIndex, aRequest->node, i))
+          break;
+      }
+    }
+    break;
+
+  case eGetChildren:
+    handleChildren(aWalk, aRequest->node, aReply);
+    break;
+
+  case eGetState:
+    handleState(aWalk, aRequest->node, aReply);
+    break;
+  }
+}
+
+
+void initWalk(Walk* aWalk, DBusConnection* aConnection,
+              gfd::TextArena* aTexts, uint32_t aOverlap, uint64_t aDeadline,
+              TextHandler aHandler, void* aClosure,
+              WalkStatistics* aStatistics) {
+  memset(aWalk, 0, sizeof(Walk));
+  aWalk->connection = aConnection;
+  aWalk->texts = aTexts;
+  aWalk->handler = aHandler;
+  aWalk->closure = aClosure;
+  aWalk->statistics = aStatistics;
+  aWalk->deadline = aDeadline;
+
+  /* Windows advance by at least half their size. */
+  aWalk->overlap =
+    int32_t((aOverlap < INT32_MAX / 2)? aOverlap : INT32_MAX / 2);
+  aWalk->window = GFD_WALK_TEXT_WINDOW;
+  if (aWalk->window > 0 && aWalk->window < 2 * aWalk->overlap)
+    aWalk->window = 2 * aWalk->overlap;
+}
+
+void finishWalk(Walk* aWalk) {
+  gfd::clearStrings(&aWalk->strings);
+  free(aWalk->nodes);
+  free(aWalk->waiting.requests);
+  free(aWalk->hidden.requests);
+  free(aWalk->inFlight.requests);
+}
+
+void run(Walk* aWalk) {
+  while (!aWalk->stopped && (aWalk->waiting.count || aWalk->hidden.count ||
+                             aWalk->inFlight.count)) {
+    if (isPastDeadline(aWalk)) {
+      setTruncated(aWalk, eTruncatedDeadline);
+      break;
+    }
+
+    WalkRequest request;
+    while (aWalk->inFlight.count < GFD_WALK_WINDOW &&
+           pop(aWalk->waiting.count? &aWalk->waiting : &aWalk->hidden,
+               &request)) {
+      if (!sendRequest(aWalk, &request)) {
+        releaseRequest(&request);
+      }
+      else if (!push(&aWalk->inFlight, &request)) {
+        dbus_pending_call_cancel(request.pending);
+        releaseRequest(&request);
+      }
+    }
+
+    if (!pop(&aWalk->inFlight, &request))
+      continue;
+
+    /* Replies are taken in order, so a latency includes the wait for the
+       replies before it. */
+    dbus_pending_call_block(request.pending);
+    gfd::recordValue(kLatencyHistograms[request.kind],
+                     gfd::metricsClock() - request.sent);
+    DBusMessage* reply = dbus_pending_call_steal_reply(request.pending);
+    if (reply) {
+      handle(aWalk, &request, reply);
+      dbus_message_unref(reply);
+    }
+    releaseRequest(&request);
+  }
+
+  /* Stopped early: the replies still on their way will be dispatched as
+   * ordinary messages. */
+  WalkRequest request;
+  while (pop(&aWalk->inFlight, &request)) {
+    dbus_pending_call_cancel(request.pending);
+    aWalk->statistics->cancelled++;
+    releaseRequest(&request);
+  }
+  while (pop(&aWalk->waiting, &request) || pop(&aWalk->hidden, &request)) {
+    aWalk->statistics->cancelled++;
+    releaseRequest(&request);
+  }
+}
+}
+
+uint64_t monotonicMilliseconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return uint64_t(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+uint64_t eventDeadline() {
+  if (GFD_WALK_DEADLINE <= 0)
+    return 0;
+  return monotonicMilliseconds() + GFD_WALK_DEADLINE;
+}
+
+int callTimeout(uint64_t aDeadline) {
+  const int timeout =
+    (GFD_CALL_TIMEOUT > 0)? GFD_CALL_TIMEOUT : DBUS_TIMEOUT_USE_DEFAULT;
+  if (!aDeadline)
+    return timeout;
+
+  uint64_t now = monotonicMilliseconds();
+  /* 0 would mean the default timeout. */
+  if (now >= aDeadline)
+    return 1;
+  if (timeout == DBUS_TIMEOUT_USE_DEFAULT ||
+      aDeadline - now < uint64_t(timeout))
+    return int(aDeadline - now);
+  return timeout;
+}
+
+bool isCallTimeout(const DBusError* aError, uint64_t aDeadline) {
+  return dbus_error_has_name(aError, DBUS_ERROR_NO_REPLY) &&
+         !(aDeadline && monotonicMilliseconds() >= aDeadline);
+}
+
+void copyTexts(DBusConnection* aConnection,
+               const char* aDestination,
+               const char* aPath,
+               gfd::TextArena* aTexts,
+               uint32_t aOverlap,
+               uint64_t aDeadline,
+               TextHandler aHandler,
+               void* aClosure,
+               WalkStatistics* aStatistics) {
+  WalkStatistics statistics;
+  memset(&statistics, 0, sizeof(statistics));
+
+  Walk walk;
+  initWalk(&walk, aConnection, aTexts, aOverlap, aDeadline, aHandler,
+           aClosure, aStatistics? aStatistics : &statistics);
+
+  uint32_t root = newNode(&walk, aDestination, aPath);
+  if (root != kNoNode) {
+#if GFD_WALK_USE_CACHE
+    if (!walkCache(&walk, root) && !walk.stopped)
+#endif
+      enqueueNode(&walk, root);
+    run(&walk);
+  }
+  finishWalk(&walk);
+}
+
+void copyText(DBusConnection* aConnection,
+              const char* aDestination,
+              const char* aPath,
+              gfd::TextArena* aTexts,
+              uint32_t aOverlap,
+              uint64_t aDeadline,
+              TextHandler aHandler,
+              void* aClosure,
+              WalkStatistics* aStatistics) {
+  WalkStatistics statistics;
+  memset(&statistics, 0, sizeof(statistics));
+
+  Walk walk;
+  initWalk(&walk, aConnection, aTexts, aOverlap, aDeadline, aHandler,
+           aClosure, aStatistics? aStatistics : &statistics);
+
+  uint32_t node = newNode(&walk, aDestination, aPath);
+  if (node != kNoNode) {
+    enqueueText(&walk, node);
+    run(&walk);
+  }
+  finishWalk(&walk);
+}
+
+DBusMessage* newGetParent(const char* aDestination, const char* aPath) {
+  DBusMessage* method =
+    dbus_message_new_method_call(aDestination, aPath,
+                                 DBUS_INTERFACE_PROPERTIES, "Get");
+  static const char* const attribute = "Parent";
+  if (method &&
+      !dbus_message_append_args(method,
+                                DBUS_TYPE_STRING,
+                                &gfd::atspi::interface::kAccessible,
+                                DBUS_TYPE_STRING, &attribute,
+                                DBUS_TYPE_INVALID)) {
+    dbus_message_unref(method);
+    method = NULL;
+  }
+  return method;
+}
+
+bool readParent(DBusMessage* aReply, char** aParentDestination,
+                char** aParentPath) {
+  if (DBUS_MESSAGE_TYPE_METHOD_RETURN != dbus_message_get_type(aReply))
+    return false;
+
+  /* v containing (so) */
+  const char* destination(NULL);
+  const char* path(NULL);
+  DBusMessageIter variantIter;
+  dbus_message_iter_init(aReply, &variantIter);
+  if (DBUS_TYPE_VARIANT == dbus_message_iter_get_arg_type(&variantIter)) {
+    DBusMessageIter structIter;
+    dbus_message_iter_recurse(&variantIter, &structIter);
+    if (DBUS_TYPE_STRUCT == dbus_message_iter_get_arg_type(&structIter)) {
+      DBusMessageIter iter;
+      dbus_message_iter_recurse(&structIter, &iter);
+      if (DBUS_TYPE_STRING == dbus_message_iter_get_arg_type(&iter)) {
+        dbus_message_iter_get_basic(&iter, &destination);
+        dbus_message_iter_next(&iter);
+        if (DBUS_TYPE_OBJECT_PATH == dbus_message_iter_get_arg_type(&iter))
+          dbus_message_iter_get_basic(&iter, &path);
+      }
+    }
+  }
+
+  bool found = destination && path && *destination &&
+               0 != strcmp(path, GFD_ATSPI_NULL_PATH);
+  if (found) {
+    *aParentDestination = strdup(destination);
+    *aParentPath = strdup(path);
+    if (!*aParentDestination || !*aParentPath) {
+      free(*aParentDestination);
+      free(*aParentPath);
+      found = false;
+    }
+  }
+  return found;
+}
+
+bool getParent(DBusConnection* aConnection,
+               const char* aDestination,
+               const char* aPath,
+               uint64_t aDeadline,
+               char** aParentDestination,
+               char** aParentPath,
+               WalkStatistics* aStatistics) {
+  DBusMessage* method = newGetParent(aDestination, aPath);
+  if (!method)
+    return false;
+
+  DBusError error;
+  dbus_error_init(&error);
+  uint64_t sent = gfd::metricsClock();
+  DBusMessage* reply =
+    dbus_connection_send_with_reply_and_block(aConnection, method,
+                                              callTimeout(aDeadline),
+                                              &error);
+  gfd::recordValue(gfd::eHistogramGetParent, gfd::metricsClock() - sent);
+  dbus_message_unref(method);
+  if (aStatistics)
+    aStatistics->roundTrips++;
+  if (!reply) {
+    if (aStatistics && isCallTimeout(&error, aDeadline)) {
+      aStatistics->timeouts++;
+      aStatistics->truncated |= eTruncatedTimeout;
+    }
+    dbus_error_free(&error);
+    return false;
+  }
+
+  bool found = readParent(reply, aParentDestination, aParentPath);
+  dbus_message_unref(reply);
+  return found;
+}
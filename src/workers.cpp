@@ -0,0 +1,206 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+#include "workers.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace gfd {
+
+/* FIFO */
+typedef struct _EventEntry {
+  DBusMessage* event;
+  _EventEntry* next;
+} EventEntry;
+
+typedef struct _Worker {
+  WorkerPool* pool;
+  uint32_t index;
+  DBusConnection* connection;
+  pthread_t thread;
+  bool started;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  EventEntry* head;
+  EventEntry* tail;
+  bool stopping;
+} Worker;
+
+struct _WorkerPool {
+  Worker* workers;
+  uint32_t count;
+  EventHandler handler;
+  void* closure;
+};
+
+static DBusConnection* openConnection(const char* aAddress) {
+  DBusError error;
+  dbus_error_init(&error);
+
+  DBusConnection* connection = dbus_connection_open_private(aAddress, &error);
+  if (connection && !dbus_bus_register(connection, &error)) {
+    dbus_connection_close(connection);
+    dbus_connection_unref(connection);
+    connection = NULL;
+  }
+
+  if (dbus_error_is_set(&error)) {
+    fprintf(stderr, "%s: %s\n", aAddress, error.message);
+    dbus_error_free(&error);
+  }
+  return connection;
+}
+
+/* FNV-1a */
+static uint32_t hashSender(const char* aSender) {
+  uint32_t hash = 2166136261u;
+  const unsigned char* p;
+  for (p = reinterpret_cast<const unsigned char*>(aSender); *p; p++) {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void* workerMain(void* aWorker) {
+  Worker* worker = static_cast<Worker*>(aWorker);
+  WorkerPool* pool = worker->pool;
+
+  for (;;) {
+    pthread_mutex_lock(&worker->lock);
+    while (!worker->head && !worker->stopping)
+      pthread_cond_wait(&worker->wake, &worker->lock);
+    if (worker->stopping) {
+      pthread_mutex_unlock(&worker->lock);
+      break;
+    }
+
+    EventEntry* entry = worker->head;
+    worker->head = entry->next;
+    if (!worker->head)
+      worker->tail = NULL;
+    pthread_mutex_unlock(&worker->lock);
+
+    pool->handler(worker->connection, entry->event, worker->index,
+                  pool->closure);
+    dbus_message_unref(entry->event);
+    delete entry;
+
+    /* Nothing is dispatched on this connection; drop what arrived anyway
+     * (NameAcquired, late replies to cancelled requests). */
+    DBusMessage* message;
+    while ((message = dbus_connection_pop_message(worker->connection)))
+      dbus_message_unref(message);
+  }
+  return NULL;
+}
+
+WorkerPool* startWorkers(const char* aAddress, uint32_t aCount,
+                         EventHandler aHandler, void* aClosure) {
+  if (!aCount) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    aCount = (cpus > 0)? uint32_t(cpus) : 1;
+  }
+  if (aCount > GFD_WORKER_COUNT_MAX)
+    aCount = GFD_WORKER_COUNT_MAX;
+
+  WorkerPool* pool = new WorkerPool();
+  pool->workers = new Worker[aCount];
+  memset(pool->workers, 0, sizeof(Worker) * aCount);
+  pool->count = 0;
+  pool->handler = aHandler;
+  pool->closure = aClosure;
+
+  while (pool->count < aCount) {
+    Worker* worker = &pool->workers[pool->count];
+    worker->pool = pool;
+    worker->index = pool->count;
+    worker->connection = openConnection(aAddress);
+    if (!worker->connection)
+      break;
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->wake, NULL);
+    pool->count++;
+
+    if (0 != pthread_create(&worker->thread, NULL, workerMain, worker))
+      break;
+    worker->started = true;
+  }
+
+  if (!pool->count || !pool->workers[pool->count - 1].started) {
+    stopWorkers(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+uint32_t workerCount(const WorkerPool* aPool) {
+  return aPool->count;
+}
+
+void submitEvent(WorkerPool* aPool, DBusMessage* aEvent) {
+  const char* sender = dbus_message_get_sender(aEvent);
+  Worker* worker =
+    &aPool->workers[sender? hashSender(sender) % aPool->count : 0];
+
+  EventEntry* entry = new EventEntry();
+  entry->event = dbus_message_ref(aEvent);
+  entry->next = NULL;
+
+  pthread_mutex_lock(&worker->lock);
+  if (worker->tail)
+    worker->tail->next = entry;
+  else
+    worker->head = entry;
+  worker->tail = entry;
+  pthread_cond_signal(&worker->wake);
+  pthread_mutex_unlock(&worker->lock);
+}
+
+void stopWorkers(WorkerPool* aPool) {
+  uint32_t i;
+  for (i = 0; i < aPool->count; i++) {
+    Worker* worker = &aPool->workers[i];
+    pthread_mutex_lock(&worker->lock);
+    worker->stopping = true;
+    pthread_cond_signal(&worker->wake);
+    pthread_mutex_unlock(&worker->lock);
+  }
+
+  for (i = 0; i < aPool->count; i++) {
+    Worker* worker = &aPool->workers[i];
+    if (worker->started)
+      pthread_join(worker->thread, NULL);
+
+    while (worker->head) {
+      EventEntry* entry = worker->head;
+      worker->head = entry->next;
+      dbus_message_unref(entry->event);
+      delete entry;
+    }
+
+    dbus_connection_close(worker->connection);
+    dbus_connection_unref(worker->connection);
+    pthread_mutex_destroy(&worker->lock);
+    pthread_cond_destroy(&worker->wake);
+  }
+
+  delete[] aPool->workers;
+  delete aPool;
+}
+
+}
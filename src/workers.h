@@ -0,0 +1,68 @@
+/****************************************************************************
+ * The Golden Panopticon Project                                            *
+ *                                                                          +
+ *                    Great Firedaemon (ver. 2.0)                           *
+ *                                                                          *
+ *                                                                          *
+ ****************************************************************************/
+
+/*
+ * This is proprietary software. Do not redistribute, modify, build, nor run it
+ * without author's permission.
+ */
+
+/* Worker threads that scan documents concurrently.
+ *
+ * Every worker has its own private connection to the AT-SPI bus and its own
+ * queue of events. An event goes to the worker chosen by a hash of its
+ * sender, so the events of one application are handled one after another,
+ * in the order they arrived, while different applications are scanned in
+ * parallel.
+ */
+
+#ifndef GFD_WORKERS_H
+#define GFD_WORKERS_H
+
+#include <stdint.h>
+
+extern "C" {
+#include <dbus/dbus.h>
+}
+
+/* The number of worker threads; 0 means one per online CPU. */
+#ifndef GFD_WORKER_COUNT
+#define GFD_WORKER_COUNT 0
+#endif
+
+#ifndef GFD_WORKER_COUNT_MAX
+#define GFD_WORKER_COUNT_MAX 32
+#endif
+
+namespace gfd {
+
+typedef struct _WorkerPool WorkerPool;
+
+/* Runs on worker aWorker (0 <= aWorker < workerCount()); aConnection is the
+ * worker's own connection. */
+typedef void (*EventHandler)(DBusConnection* aConnection,
+                             DBusMessage* aEvent,
+                             uint32_t aWorker,
+                             void* aClosure);
+
+/* Opens aCount (see GFD_WORKER_COUNT) connections to aAddress and starts a
+ * thread for each. Returns NULL on failure. */
+WorkerPool* startWorkers(const char* aAddress, uint32_t aCount,
+                         EventHandler aHandler, void* aClosure);
+
+uint32_t workerCount(const WorkerPool* aPool);
+
+/* Queues aEvent (a reference is taken) for the worker of its sender. */
+void submitEvent(WorkerPool* aPool, DBusMessage* aEvent);
+
+/* Lets every worker finish the event it is handling, drops the queued ones
+ * and joins the threads. */
+void stopWorkers(WorkerPool* aPool);
+
+}
+
+#endif /* GFD_WORKERS_H */